@@ -0,0 +1,74 @@
+# Headless playback benchmark of the subtitle engine, built apart from the
+# application with: qmake benchmark/benchmark.pro && make
+
+TARGET = subsail-benchmark
+
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+QT = core dbus network
+
+LIBS += -lz
+
+# Built-in parser engines are static Qt plugins of the application
+DEFINES += QT_STATICPLUGIN
+
+INCLUDEPATH += ../src
+
+SOURCES += \
+    enginebenchmark.cpp \
+    main.cpp \
+    ../src/cueeditor.cpp \
+    ../src/cuetable.cpp \
+    ../src/densitytimeline.cpp \
+    ../src/fingerprintindex.cpp \
+    ../src/fpsestimator.cpp \
+    ../src/inflatedevice.cpp \
+    ../src/linereader.cpp \
+    ../src/memorybudget.cpp \
+    ../src/mkvparser.cpp \
+    ../src/mp4parser.cpp \
+    ../src/mprisclock.cpp \
+    ../src/parser.cpp \
+    ../src/parserenginefactory.cpp \
+    ../src/playbackcursor.cpp \
+    ../src/singlebytedecoder.cpp \
+    ../src/srtparserqt.cpp \
+    ../src/subparserqt.cpp \
+    ../src/subtitlealigner.cpp \
+    ../src/subtitlecache.cpp \
+    ../src/subtitleengine.cpp \
+    ../src/subtitlestream.cpp \
+    ../src/subtitlewriter.cpp \
+    ../src/ziparchive.cpp
+
+HEADERS += \
+    enginebenchmark.h \
+    ../src/cueeditor.h \
+    ../src/cuetable.h \
+    ../src/densitytimeline.h \
+    ../src/fingerprintindex.h \
+    ../src/fpsestimator.h \
+    ../src/inflatedevice.h \
+    ../src/linereader.h \
+    ../src/memorybudget.h \
+    ../src/mkvparser.h \
+    ../src/mp4parser.h \
+    ../src/mprisclock.h \
+    ../src/parser.h \
+    ../src/parserenginefactory.h \
+    ../src/parserplugin.h \
+    ../src/playbackcursor.h \
+    ../src/singlebytedecoder.h \
+    ../src/srtparserqt.h \
+    ../src/subparserqt.h \
+    ../src/subtitlealigner.h \
+    ../src/subtitleclock.h \
+    ../src/subtitlecache.h \
+    ../src/subtitleengine.h \
+    ../src/subtitlestream.h \
+    ../src/subtitlewriter.h \
+    ../src/types.h \
+    ../src/ziparchive.h
@@ -0,0 +1,430 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "enginebenchmark.h"
+#include "subtitleengine.h"
+#include "parserenginefactory.h"
+#include "playbackcursor.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtDebug>
+
+#define BENCHMARK_TICK 20
+#define BENCHMARK_SEEKS 100000
+#define BENCHMARK_OFFSET_INTERVAL 250
+#define BENCHMARK_MAX_MISMATCH_LOG 10
+// Offset written to the saved file, times read back are expected moved by it
+#define BENCHMARK_SAVE_OFFSET 1500
+
+// Frame based files are played at this rate
+#define BENCHMARK_FPS 25.0
+
+EngineBenchmark::EngineBenchmark()
+{
+    iEngine = new SubtitleEngine();
+    iEngine->setClock(&iClock);
+    iReferenceEnd = 0;
+    iMismatches = 0;
+    iUnchecked = 0;
+
+    // Reproducible runs
+    qsrand(1);
+}
+
+EngineBenchmark::~EngineBenchmark()
+{
+    delete iEngine;
+}
+
+QString EngineBenchmark::tick(unsigned int time, QVector<qint64> &latencies)
+{
+    QElapsedTimer timer;
+    QString subtitle;
+
+    iClock.advance(time);
+
+    timer.start();
+    subtitle = iEngine->tick();
+    latencies.append(timer.nsecsElapsed());
+
+    return subtitle;
+}
+
+/*
+ * Parse the file again with a parser of its own, apart from the engine and
+ * the cue table. Reversed times are taken as zero length. A subtitle is clean
+ * when it neither starts before an earlier one has ended nor ends after the
+ * next one has started.
+ */
+bool EngineBenchmark::readReference(const QString &file)
+{
+    ParsedSubtitle parsed;
+    Parser *parser;
+    unsigned int maxEnd = 0;
+    int size;
+
+    parser = ParserEngineFactory::instance().getEngine(Parser::subtitleSuffix(file));
+    if (!parser)
+        parser = ParserEngineFactory::instance().detectEngine(file);
+    if (!parser)
+        return false;
+
+    switch (SubtitleEngine::parseFile(parser, file, iEngine->getFallbackCodec(), parsed)) {
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        break;
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+        parser->setFps(BENCHMARK_FPS);
+        parser->updateFPS(parsed.subtitles);
+        break;
+    default:
+        delete parser;
+        return false;
+    }
+
+    delete parser;
+
+    iReference = parsed.subtitles;
+    std::stable_sort(iReference.begin(), iReference.end(),
+                     [](const Subtitle &a, const Subtitle &b) {
+        return a.start_time < b.start_time;
+    });
+
+    size = iReference.size();
+    iClean.fill(true, size);
+
+    for (int i = 0; i < size; i++) {
+        Subtitle &subtitle = iReference[i];
+
+        subtitle.end_time = qMax(subtitle.end_time, subtitle.start_time);
+
+        if (i > 0 && subtitle.start_time <= maxEnd)
+            iClean[i] = false;
+        if (i + 1 < size && subtitle.end_time >= iReference.at(i + 1).start_time)
+            iClean[i] = false;
+
+        maxEnd = qMax(maxEnd, subtitle.end_time);
+    }
+
+    iReferenceEnd = maxEnd;
+
+    return true;
+}
+
+/*
+ * Straightforward linear lookup of what should be shown at the time. False
+ * when the time is covered by overlapping subtitles, shown as the table has
+ * resolved them.
+ */
+bool EngineBenchmark::referenceSubtitle(unsigned int time, int offset,
+                                        QString &expected)
+{
+    expected = QString("");
+
+    if (offset < 0 && time <= static_cast<unsigned int>(INT_MAX) &&
+                static_cast<int>(time) + offset < 0)
+        return true;
+
+    if (PlaybackCursor::applyOffset(iReferenceEnd, offset) < time) {
+        expected = QString("<subtitles end>");
+        return true;
+    }
+
+    for (int i = 0; i < iReference.size(); i++) {
+        const Subtitle &subtitle = iReference.at(i);
+
+        if (PlaybackCursor::applyOffset(subtitle.start_time, offset) > time)
+            break;
+
+        if (PlaybackCursor::applyOffset(subtitle.end_time, offset) < time)
+            continue;
+
+        if (!iClean.at(i))
+            return false;
+
+        expected = subtitle.text;
+    }
+
+    return true;
+}
+
+bool EngineBenchmark::check(const QString &subtitle, unsigned int time,
+                            int offset)
+{
+    QString expected;
+
+    if (!referenceSubtitle(time, offset, expected)) {
+        iUnchecked++;
+        return true;
+    }
+
+    if (subtitle == expected && iEngine->getCurrentTime() == time)
+        return true;
+
+    if (iMismatches++ < BENCHMARK_MAX_MISMATCH_LOG)
+        qWarning() << "mismatch at" << time << "engine time" <<
+                      iEngine->getCurrentTime() << "offset" << offset <<
+                      "got" << subtitle << "expected" << expected;
+
+    return false;
+}
+
+void EngineBenchmark::replayTicks(const QString &name, bool jitter)
+{
+    QVector<qint64> latencies;
+    unsigned int time = 0;
+    unsigned int end = iTable->totalTime() + 1000;
+
+    iEngine->setOffset(0);
+    iEngine->setTime(0);
+    iEngine->resetClock();
+
+    while (time < end) {
+        unsigned int step = BENCHMARK_TICK;
+
+        if (jitter) {
+            // Timer jitter and now and then a stall of up to 30 seconds
+            step = static_cast<unsigned int>(qrand() % (2 * BENCHMARK_TICK + 1));
+            if (qrand() % 500 == 0)
+                step = static_cast<unsigned int>(1000 + qrand() % 29000);
+        }
+
+        QString subtitle = tick(step, latencies);
+        time += step;
+
+        check(subtitle, time, 0);
+    }
+
+    report(name, latencies);
+}
+
+void EngineBenchmark::replaySeeks(const QString &name)
+{
+    QVector<qint64> latencies;
+    QElapsedTimer timer;
+    unsigned int range = iTable->totalTime() + 1000;
+
+    iEngine->setOffset(0);
+
+    for (int i = 0; i < BENCHMARK_SEEKS; i++) {
+        unsigned int time = static_cast<unsigned int>(qrand()) % range;
+
+        timer.start();
+        iEngine->setTime(time);
+        QString subtitle = iEngine->getSubtitle(0);
+        latencies.append(timer.nsecsElapsed());
+
+        check(subtitle, time, 0);
+    }
+
+    report(name, latencies);
+}
+
+void EngineBenchmark::replayOffsets(const QString &name)
+{
+    QVector<qint64> latencies;
+    QVector<qint64> tickLatencies;
+    QElapsedTimer timer;
+    unsigned int time = 0;
+    unsigned int end = iTable->totalTime() + 1000;
+    int offset = 0;
+    int ticks = 0;
+
+    iEngine->setOffset(0);
+    iEngine->setTime(0);
+    iEngine->resetClock();
+
+    while (time < end) {
+        if (++ticks % BENCHMARK_OFFSET_INTERVAL == 0) {
+            // Offset steps as from the UI, within +-10 seconds
+            offset = (qrand() % 201 - 100) * 100;
+
+            timer.start();
+            iEngine->setOffset(offset);
+            latencies.append(timer.nsecsElapsed());
+        }
+
+        QString subtitle = tick(BENCHMARK_TICK, tickLatencies);
+        time += BENCHMARK_TICK;
+
+        check(subtitle, time, offset);
+    }
+
+    report(name + QStringLiteral(" setOffset"), latencies);
+    report(name + QStringLiteral(" tick"), tickLatencies);
+
+    iEngine->setOffset(0);
+}
+
+// Tags are dropped by formats without them, compare only the text itself
+static QString plainText(const QString &text)
+{
+    static const QRegularExpression tag(QStringLiteral("<[^>]*>"));
+    QString plain = text;
+
+    return plain.replace(tag, QStringLiteral(" ")).simplified();
+}
+
+/*
+ * Save the file as from the UI and load the result with a new engine using
+ * the default fallback codec, as when it is opened again later.
+ */
+void EngineBenchmark::checkSaveReload()
+{
+    QTextStream out(stdout);
+    QTemporaryDir dir;
+    SubtitleEngine *reloaded;
+    CueTableRef table;
+    QString path;
+    unsigned int resolution;
+    int mismatches = 0;
+    int err;
+
+    if (!iEngine->canSaveSubtitle()) {
+        out << "save: format cannot be written, skipped" << endl;
+        return;
+    }
+
+    // MicroDVD times are rounded to the nearest frame, less than a frame of
+    // 25 FPS off, and SubViewer keeps hundredths of a second
+    if (iEngine->getFormat() == QStringLiteral("microdvd"))
+        resolution = 1000 / 25;
+    else if (iEngine->getFormat() == QStringLiteral("subviewer"))
+        resolution = 10;
+    else
+        resolution = 1;
+
+    path = dir.path() + QStringLiteral("/adjusted.") + iEngine->getSubtitleSuffix();
+
+    iEngine->setOffset(BENCHMARK_SAVE_OFFSET);
+    err = iEngine->saveSubtitle(path);
+    iEngine->setOffset(0);
+    if (err) {
+        out << "save: failed to write " << path << " error " << err << endl;
+        iMismatches++;
+        return;
+    }
+
+    reloaded = new SubtitleEngine();
+    if (reloaded->loadSubtitle(path) == SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_NEED_FPS)
+        reloaded->updateFps(BENCHMARK_FPS);
+
+    table = reloaded->getTable();
+
+    if (table->size() != iTable->size()) {
+        out << "save: " << table->size() << " subtitles read back, expected " <<
+               iTable->size() << endl;
+        mismatches++;
+    } else {
+        for (int i = 0; i < table->size(); i++) {
+            const Subtitle &subtitle = table->at(i);
+            const Subtitle &original = iTable->at(i);
+            QString text = plainText(subtitle.text);
+            QString expected = plainText(original.text);
+            unsigned int start = PlaybackCursor::applyOffset(original.start_time,
+                                                             BENCHMARK_SAVE_OFFSET);
+            unsigned int end = PlaybackCursor::applyOffset(original.end_time,
+                                                           BENCHMARK_SAVE_OFFSET);
+
+            if (text != expected) {
+                if (mismatches++ < BENCHMARK_MAX_MISMATCH_LOG)
+                    qWarning() << "save: text of" << i << "read back as" << text <<
+                                  "expected" << expected;
+                continue;
+            }
+
+            if (qAbs(static_cast<qint64>(subtitle.start_time) - start) < resolution &&
+                    qAbs(static_cast<qint64>(subtitle.end_time) - end) < resolution)
+                continue;
+
+            if (mismatches++ < BENCHMARK_MAX_MISMATCH_LOG)
+                qWarning() << "save: times of" << i << "read back as" <<
+                              subtitle.start_time << subtitle.end_time <<
+                              "expected" << start << end;
+        }
+    }
+
+    delete reloaded;
+
+    out << "save: " << mismatches << " mismatches" << endl;
+    iMismatches += mismatches;
+}
+
+void EngineBenchmark::report(const QString &name, QVector<qint64> &latencies)
+{
+    QTextStream out(stdout);
+    int size = latencies.size();
+
+    if (!size)
+        return;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    out << name << ": " << size << " calls, latency us p50 " <<
+           latencies.at(size / 2) / 1000.0 << " p90 " <<
+           latencies.at(size * 9 / 10) / 1000.0 << " p99 " <<
+           latencies.at(size * 99 / 100) / 1000.0 << " max " <<
+           latencies.last() / 1000.0 << endl;
+}
+
+int EngineBenchmark::run(const QString &file)
+{
+    QTextStream out(stdout);
+    SubtitleEngine::SubtitleLoadStatus status;
+
+    status = iEngine->loadSubtitle(file);
+    switch (status) {
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        break;
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+        iEngine->updateFps(BENCHMARK_FPS);
+        break;
+    default:
+        out << "cannot load " << file << " status " << status << endl;
+        return 1;
+    }
+
+    if (!readReference(file)) {
+        out << "cannot read " << file << " for reference" << endl;
+        return 1;
+    }
+
+    iTable = iEngine->getTable();
+
+    out << file << ": " << iTable->size() << " subtitles, " <<
+           iTable->totalTime() << " ms" << endl;
+
+    replayTicks(QStringLiteral("ticks"), false);
+    replayTicks(QStringLiteral("jittered ticks"), true);
+    replaySeeks(QStringLiteral("seeks"));
+    replayOffsets(QStringLiteral("offsets"));
+    checkSaveReload();
+
+    out << iMismatches << " mismatches, " << iUnchecked <<
+           " steps within overlapping subtitles unchecked" << endl;
+
+    return iMismatches ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENGINEBENCHMARK_H
+#define ENGINEBENCHMARK_H
+
+#include <QString>
+#include <QVector>
+#include "subtitleclock.h"
+#include "cuetable.h"
+
+class SubtitleEngine;
+
+/*
+ * Headless replay of a subtitle file through the engine with a simulated
+ * clock. Each step is checked against a linear lookup in the file as parsed,
+ * without the normalization of the cue table, and the latencies of the
+ * engine calls are reported as percentiles. Times where cues of the file
+ * overlap are left unchecked, the table resolves them. The file is
+ * also saved with an offset and read back to check that the text and the
+ * times, within the resolution of the format, survive the round trip.
+ */
+class EngineBenchmark
+{
+public:
+    EngineBenchmark();
+    ~EngineBenchmark();
+
+    int run(const QString &file);
+
+private:
+    void replayTicks(const QString &name, bool jitter);
+    void replaySeeks(const QString &name);
+    void replayOffsets(const QString &name);
+    void checkSaveReload();
+    bool readReference(const QString &file);
+    QString tick(unsigned int time, QVector<qint64> &latencies);
+    bool referenceSubtitle(unsigned int time, int offset, QString &expected);
+    bool check(const QString &subtitle, unsigned int time, int offset);
+    void report(const QString &name, QVector<qint64> &latencies);
+
+    SubtitleEngine *iEngine;
+    SimulatedClock iClock;
+    CueTableRef iTable;
+    // Subtitles of the file as parsed, by start time
+    SubtitleList iReference;
+    // Subtitle of the file does not overlap any other
+    QVector<bool> iClean;
+    unsigned int iReferenceEnd;
+    int iMismatches;
+    int iUnchecked;
+};
+
+#endif // ENGINEBENCHMARK_H
@@ -14,13 +14,41 @@ TARGET = harbour-subsail
 
 CONFIG += sailfishapp
 
+QT += dbus network
+
+LIBS += -lz
+
+# Built-in parser engines are static Qt plugins of the application
+DEFINES += QT_STATICPLUGIN
+
 SOURCES += \
+    src/cueeditor.cpp \
+    src/cuetable.cpp \
+    src/densityimageprovider.cpp \
+    src/densitytimeline.cpp \
+    src/fingerprintindex.cpp \
+    src/fpsestimator.cpp \
+    src/inflatedevice.cpp \
+    src/linereader.cpp \
     src/main.cpp \
+    src/memorybudget.cpp \
+    src/mkvparser.cpp \
+    src/mp4parser.cpp \
+    src/mprisclock.cpp \
     src/parser.cpp \
     src/parserenginefactory.cpp \
+    src/playbackcursor.cpp \
+    src/singlebytedecoder.cpp \
     src/srtparserqt.cpp \
     src/subparserqt.cpp \
-    src/subtitleengine.cpp
+    src/subtitlealigner.cpp \
+    src/subtitlecache.cpp \
+    src/subtitlecatalogue.cpp \
+    src/subtitleengine.cpp \
+    src/subtitlestream.cpp \
+    src/subtitlewriter.cpp \
+    src/transcriptmodel.cpp \
+    src/ziparchive.cpp
 
 DISTFILES += \
     harbour-subsail.desktop \
@@ -31,8 +59,16 @@ DISTFILES += \
     qml/MainPage.qml \
     qml/cover/CoverPage.qml \
     qml/pages/AboutPage.qml \
+    qml/pages/CataloguePage.qml \
+    qml/pages/CueTextDialog.qml \
     qml/pages/SettingsPage.qml \
     qml/pages/SubtitleView.qml \
+    qml/pages/TrackPage.qml \
+    qml/pages/TranscriptPage.qml \
+    src/mkvparser.json \
+    src/mp4parser.json \
+    src/srtparserqt.json \
+    src/subparserqt.json \
     rpm/SubSail.changes.in \
     rpm/SubSail.spec \
     rpm/ViewSRT.changes.in \
@@ -52,9 +88,32 @@ CONFIG += sailfishapp_i18n
 #TRANSLATIONS += translations/
 
 HEADERS += \
+    src/cueeditor.h \
+    src/cuetable.h \
+    src/densityimageprovider.h \
+    src/densitytimeline.h \
+    src/fingerprintindex.h \
+    src/fpsestimator.h \
+    src/inflatedevice.h \
+    src/linereader.h \
+    src/memorybudget.h \
+    src/mkvparser.h \
+    src/mp4parser.h \
+    src/mprisclock.h \
     src/parser.h \
     src/parserenginefactory.h \
+    src/parserplugin.h \
+    src/playbackcursor.h \
+    src/singlebytedecoder.h \
     src/srtparserqt.h \
     src/subparserqt.h \
+    src/subtitlealigner.h \
+    src/subtitleclock.h \
+    src/subtitlecache.h \
+    src/subtitlecatalogue.h \
     src/subtitleengine.h \
-    src/types.h
+    src/subtitlestream.h \
+    src/subtitlewriter.h \
+    src/transcriptmodel.h \
+    src/types.h \
+    src/ziparchive.h
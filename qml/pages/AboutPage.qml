@@ -61,7 +61,7 @@ Page {
                 wrapMode: Text.WordWrap
                 font.pixelSize: Theme.fontSizeSmall
 
-                text: qsTr("The files that are supported are .srt and .sub subtitle files.\n\nThe most common encodings are supported, and if the encoding cannot be detected from the subtitle file the fallback codec is used. The fallback codec can be changed in the settings.\n\nFor .sub files FPS may be detected automatically but otherwise the FPS is prompted to be selected.\n\nAny other than italic, bold or underline text decorations are ignored.")
+                text: qsTr("The files that are supported are .srt and .sub subtitle files, also when gzipped or inside a zip archive. Text subtitle tracks of .mkv and .mp4 files can be read as well.\n\nThe most common encodings are supported, and if the encoding cannot be detected from the subtitle file the fallback codec is used. The fallback codec can be changed in the settings.\n\nFor .sub files FPS may be detected automatically but otherwise the FPS is prompted to be selected.\n\nAny other than italic, bold or underline text decorations are ignored.")
             }
 
             SectionHeader {
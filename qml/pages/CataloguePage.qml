@@ -0,0 +1,93 @@
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+
+Page {
+    id: cataloguePage
+    allowedOrientations: Orientation.All
+
+    signal fileSelected(string path)
+
+    function padWithZero(value) {
+        return value < 10 ? "0" + value : value.toString();
+    }
+
+    function formatTime(value)
+    {
+        return padWithZero(Math.floor(value / 3600000)) + ":" +
+                padWithZero(Math.floor((value % 3600000) / 60000)) + ":" +
+                padWithZero(Math.floor((value % 60000) / 1000))
+    }
+
+    SilicaListView {
+        id: catalogueView
+        anchors.fill: parent
+        model: SubtitleCatalogue
+        cacheBuffer: 0
+
+        header: Column {
+            width: parent.width
+
+            PageHeader {
+                title: qsTr("Subtitle catalogue")
+            }
+
+            SearchField {
+                width: parent.width
+                placeholderText: qsTr("Search")
+                text: SubtitleCatalogue.filter
+                onTextChanged: SubtitleCatalogue.filter = text
+                EnterKey.iconSource: "image://theme/icon-m-enter-close"
+                EnterKey.onClicked: focus = false
+            }
+        }
+
+        PullDownMenu {
+            busy: SubtitleCatalogue.crawling
+
+            MenuItem {
+                text: qsTr("Refresh")
+                onClicked: SubtitleCatalogue.refresh()
+            }
+        }
+
+        ViewPlaceholder {
+            enabled: !SubtitleCatalogue.crawling && catalogueView.count === 0
+            text: qsTr("No subtitles found")
+            hintText: SubtitleCatalogue.filter === "" ?
+                          qsTr("Downloads, documents, videos and memory cards are searched") :
+                          qsTr("No file name matches the search")
+        }
+
+        delegate: ListItem {
+            contentHeight: Theme.itemSizeMedium
+
+            Column {
+                x: Theme.horizontalPageMargin
+                width: parent.width - 2 * Theme.horizontalPageMargin
+                anchors.verticalCenter: parent.verticalCenter
+
+                Label {
+                    width: parent.width
+                    text: name
+                    truncationMode: TruncationMode.Fade
+                }
+
+                Label {
+                    width: parent.width
+                    text: format + (codec !== "" ? " · " + codec : "") + " · " +
+                          qsTr("%n cues", "", cues) + " · " + formatTime(duration)
+                    truncationMode: TruncationMode.Fade
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: Theme.secondaryColor
+                }
+            }
+
+            onClicked: {
+                fileSelected(path)
+                pageStack.pop()
+            }
+        }
+
+        VerticalScrollDecorator { }
+    }
+}
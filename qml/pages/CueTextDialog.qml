@@ -0,0 +1,32 @@
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+
+Dialog {
+    id: cueTextDialog
+    property string text
+    allowedOrientations: Orientation.All
+
+    canAccept: textArea.text.length > 0
+
+    Column {
+        width: parent.width
+
+        DialogHeader {
+            acceptText: qsTr("Save")
+        }
+
+        TextArea {
+            id: textArea
+            width: parent.width
+            label: qsTr("Subtitle text")
+            placeholderText: label
+            text: cueTextDialog.text.replace(/<br>/g, "\n")
+            focus: true
+        }
+    }
+
+    onDone: {
+        if (result == DialogResult.Accepted)
+            text = textArea.text.replace(/\n/g, "<br>")
+    }
+}
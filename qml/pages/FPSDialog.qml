@@ -3,7 +3,8 @@ import Sailfish.Silica 1.0
 
 Dialog {
     property double fps: 0
-    property bool selected: false
+    // Preselected value, e.g. a suggestion, can be accepted as is
+    property bool selected: fps > 0
     allowedOrientations: Orientation.All
 
     function itemTextToIndex(text) {
@@ -110,6 +110,20 @@ Page {
                 }
             }
 
+            TextSwitch {
+                text: qsTr("Follow media player")
+                description: qsTr("Sync playback to a running media player")
+                automaticCheck: false
+                checked: followMediaPlayer.value
+                onClicked: followMediaPlayer.value = !checked
+
+                ConfigurationValue {
+                    id: followMediaPlayer
+                    key: appRootPath + "followMediaPlayer"
+                    defaultValue: false
+                }
+            }
+
             SectionHeader {
                 text: qsTr("Time options")
             }
@@ -176,6 +190,26 @@ Page {
                 }
             }
 
+            Slider {
+                visible: opacity > 0
+                opacity: 1.0
+                width: parent.width
+                minimumValue: 8
+                maximumValue: 128
+                value: memoryBudget.value ? memoryBudget.value : 32
+                stepSize: 8
+                label: qsTr("Memory for cached subtitles")
+                valueText: value + " MB"
+                onReleased: memoryBudget.value = value
+                FadeAnimation on opacity { }
+
+                ConfigurationValue {
+                    id: memoryBudget
+                    key: appRootPath + "memoryBudget"
+                    defaultValue: 32
+                }
+            }
+
             ComboBox {
                 width: parent.width
                 label: qsTr("Default fallback codec")
@@ -10,10 +10,14 @@ Page {
     allowedOrientations: Orientation.All
 
     readonly property string appRootPath: "/apps/harbour-subsail/"
+    // Alignments correlating less than this are not applied
+    readonly property double alignMinConfidence: 0.3
     property string subtitleFilePath: ""
 
     property bool playing: subSailMain.playing
     property bool showFPSSelector: false
+    property int trackCount: 0
+    property bool canSave: false
 
     property int time: 0
     property int oldTime: 0
@@ -25,7 +29,6 @@ Page {
     property int fontsizeMin: 20
     property int loadStatus: -1
 
-    property var lastUpdate
     property int applicationState: Qt.application.state
     property double fps: 0.0
     property double oldFps: 0.0
@@ -105,12 +108,37 @@ Page {
         onValueChanged: fontsize = value
     }
 
+    ConfigurationValue {
+        id: memoryBudgetSetting
+        key: appRootPath + "memoryBudget"
+        defaultValue: 32
+        onValueChanged: SubtitleEngine.setMemoryBudget(value)
+    }
+
     ConfigurationValue {
         id: pauseWhenMinimizedSetting
         key: appRootPath + "pauseWhenMinimized"
         defaultValue: true
     }
 
+    ConfigurationValue {
+        id: followMediaPlayerSetting
+        key: appRootPath + "followMediaPlayer"
+        defaultValue: false
+        onValueChanged: setMediaPlayerSync(value)
+    }
+
+    function setMediaPlayerSync(enabled)
+    {
+        if (!SubtitleEngine.setMediaPlayerSync(enabled)) {
+            errorNotify(qsTr("No media player found"), qsTr("Using own clock"))
+            return
+        }
+
+        if (enabled)
+            subSailMain.playing = SubtitleEngine.isMediaPlayerPlaying()
+    }
+
     function padWithZero(value) {
         return value < 10 ? "0" + value : value.toString();
     }
@@ -118,8 +146,27 @@ Page {
     function updateSubtitle()
     {
         SubtitleEngine.setTime(time)
+        showSubtitle(SubtitleEngine.getSubtitle(0))
+    }
+
+    function showSubtitle(text)
+    {
+        if (text === subtitleTimer.prevSub)
+            return
+
+        subtitleTimer.prevSub = text
         subtitlesModel.clear()
-        subtitlesModel.append({ modelText: SubtitleEngine.getSubtitle(0) })
+        subtitlesModel.append({ modelText: text })
+    }
+
+    function scrubTime(value)
+    {
+        if (playing && hideSliderOnPlay)
+            return
+
+        // Playback position is committed only when the slider is released
+        time = value * 1000
+        SubtitleEngine.scrubTo(time)
     }
 
     function updateTime(value)
@@ -128,7 +175,8 @@ Page {
             return
 
         time = value * 1000
-        updateSubtitle()
+        SubtitleEngine.endScrub(time)
+        showSubtitle(SubtitleEngine.getSubtitle(0))
     }
 
     function updateOffset(offsetChange)
@@ -230,6 +278,7 @@ Page {
     {
         subSailMain.loaded = true
         totalTime = SubtitleEngine.getTotalTime()
+        trackCount = SubtitleEngine.getTracks().length
         DisplayBlanking.preventBlanking = true
         KeepAlive.enabled = true
     }
@@ -243,9 +292,10 @@ Page {
         totalTime = SubtitleEngine.getTotalTime()
         slider.value = 0
         subtitlesModel.clear()
+        subtitleTimer.prevSub = ""
     }
 
-    function showFPSDialog()
+    function showFPSDialog(suggestedFps)
     {
         var playstate = subSailMain.playing
 
@@ -255,7 +305,7 @@ Page {
             subSailMain.playing = false
 
         var dialogObj = pageStack.animatorPush(Qt.resolvedUrl("FPSDialog.qml"),
-                {"fps": fps})
+                {"fps": fps > 0 ? fps : suggestedFps})
         dialogObj.pageCompleted.connect(function(dialog) {
             dialog.onAccepted.connect(function() {
                 clearSubtitles()
@@ -280,6 +330,27 @@ Page {
         })
     }
 
+    // Use the guessed FPS when it is certain, otherwise ask with it preselected
+    function selectSuggestedFps()
+    {
+        var suggestion = SubtitleEngine.suggestFps(0)
+
+        if (!suggestion.certain) {
+            showFPSDialog(suggestion.fps)
+            return
+        }
+
+        setupSubtitles()
+        oldFps = fps
+        fps = suggestion.fps
+
+        pageStack.completeAnimation()
+        errorNotification.summary = qsTr("Subtitle FPS detected")
+        errorNotification.body = qsTr("Using %1 FPS, change with Select FPS").arg(fps)
+        errorNotification.publish()
+        errorNotification.expireTimeout = 5000
+    }
+
     function showSubtitleSelect()
     {
         currentPlaying = subSailMain.playing
@@ -288,7 +359,7 @@ Page {
         fps = 0.0
 
         var pickerObj = pageStack.animatorPush("Sailfish.Pickers.FilePickerPage", {
-            nameFilters: ["*.srt", "*.sub"],
+            nameFilters: SubtitleEngine.getNameFilters(),
             popOnSelection: true
         })
 
@@ -299,6 +370,22 @@ Page {
         })
     }
 
+    function showCatalogue()
+    {
+        pageStack.completeAnimation()
+
+        var pageObj = pageStack.animatorPush(Qt.resolvedUrl("CataloguePage.qml"))
+        pageObj.pageCompleted.connect(function(page) {
+            page.fileSelected.connect(function(path) {
+                currentPlaying = subSailMain.playing
+                subSailMain.playing = false
+                subtitleFilePath = ""
+                fps = 0.0
+                subtitleFilePath = path
+            })
+        })
+    }
+
     function showPage(pageUrl)
     {
         var playstate = subSailMain.playing
@@ -314,7 +401,7 @@ Page {
         pageObj.Component.destruction.connect(function() {
             if (autoResumePlayback && playstate) {
                 console.log("autoresume playback")
-                lastUpdate = new Date()
+                SubtitleEngine.resetClock()
                 subSailMain.playing = playstate
             }
 
@@ -332,6 +419,39 @@ Page {
         showPage("AboutPage.qml")
     }
 
+    function selectTrack(number)
+    {
+        loadStatus = SubtitleEngine.selectTrack(number)
+
+        switch (loadStatus) {
+        case SubtitleEngine.SUBTITLE_LOAD_STATUS_OK:
+        case SubtitleEngine.SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+            totalTime = SubtitleEngine.getTotalTime()
+            updateSubtitle()
+            break
+        default:
+            checkSubtitleLoadResult()
+            break
+        }
+    }
+
+    function showTracks()
+    {
+        pageStack.completeAnimation()
+
+        var pageObj = pageStack.animatorPush(Qt.resolvedUrl("TrackPage.qml"))
+        pageObj.pageCompleted.connect(function(page) {
+            page.trackSelected.connect(selectTrack)
+        })
+    }
+
+    function showTranscript()
+    {
+        // Playback continues while the transcript is shown
+        pageStack.completeAnimation()
+        pageStack.animatorPush(Qt.resolvedUrl("TranscriptPage.qml"))
+    }
+
     function errorNotify(message, summary) {
         pageStack.completeAnimation()
         errorNotification.body = message
@@ -341,11 +461,150 @@ Page {
         clearSubtitles()
     }
 
+    function saveSubtitle()
+    {
+        // Compressed subtitles are saved uncompressed next to the archive
+        var suffix = SubtitleEngine.getSubtitleSuffix()
+        var basePath = subtitleFilePath.replace(/\.(gz|zip)$/i, "")
+                .replace(new RegExp("\\." + suffix + "$", "i"), "")
+        var savePath = basePath + "-adjusted." + suffix
+
+        pageStack.completeAnimation()
+
+        if (SubtitleEngine.saveSubtitle(savePath) === 0) {
+            errorNotification.summary = qsTr("Subtitle saved")
+            errorNotification.body = savePath
+        } else {
+            errorNotification.summary = qsTr("Subtitle save failure")
+            errorNotification.body = qsTr("Failed to write file")
+        }
+
+        errorNotification.publish()
+        errorNotification.expireTimeout = 5000
+    }
+
+    function applyCorrection(offset, scale)
+    {
+        // Scale is applied to the subtitle times, offset on top of it
+        if (scale !== 1.0)
+            SubtitleEngine.scaleTime(scale)
+
+        timeOffset = offset
+        SubtitleEngine.setOffset(timeOffset)
+        totalTime = SubtitleEngine.getTotalTime()
+        updateSubtitle()
+        resetDelayoffsetTimer()
+    }
+
+    // Correction remembered earlier for the same subtitle file, when the file
+    // needs an FPS only a correction made at a known FPS is applied
+    function applyKnownCorrection(needFps)
+    {
+        var correction = SubtitleEngine.getKnownCorrection()
+
+        if (correction.offset === undefined)
+            return false
+
+        if (needFps && !(correction.fps > 0))
+            return false
+
+        // Scale and offset were made at this FPS, set it first
+        if (correction.fps > 0 && correction.fps !== fps) {
+            setupSubtitles()
+            oldFps = fps
+            fps = correction.fps
+        }
+
+        applyCorrection(correction.offset, correction.scale)
+
+        pageStack.completeAnimation()
+        errorNotification.summary = qsTr("Known sync correction applied")
+        if (correction.fps > 0)
+            errorNotification.body = qsTr("Offset %1 ms at %2 FPS").arg(correction.offset).arg(fps)
+        else
+            errorNotification.body = qsTr("Offset %1 ms").arg(correction.offset)
+        errorNotification.publish()
+        errorNotification.expireTimeout = 5000
+
+        return true
+    }
+
+    function rememberCorrection()
+    {
+        pageStack.completeAnimation()
+
+        if (SubtitleEngine.rememberCorrection(timeOffset) === 0) {
+            errorNotification.summary = qsTr("Sync correction remembered")
+            errorNotification.body = qsTr("Applied when the file is loaded again")
+        } else {
+            errorNotification.summary = qsTr("Sync correction not remembered")
+            errorNotification.body = qsTr("Failed to write the index")
+        }
+
+        errorNotification.publish()
+        errorNotification.expireTimeout = 5000
+    }
+
+    function alignTo(referencePath)
+    {
+        var result = SubtitleEngine.alignTo(referencePath, true)
+
+        pageStack.completeAnimation()
+
+        if (result.offset === undefined) {
+            errorNotification.summary = qsTr("Alignment failure")
+            errorNotification.body = qsTr("Failed to read reference subtitle")
+        } else if (result.confidence < alignMinConfidence) {
+            errorNotification.summary = qsTr("Alignment rejected")
+            errorNotification.body = qsTr("Reference does not match, confidence %1 %")
+                .arg(Math.round(result.confidence * 100))
+        } else {
+            applyCorrection(result.offset, result.scale)
+
+            errorNotification.summary = qsTr("Subtitles aligned")
+            errorNotification.body = qsTr("Offset %1 ms, scale %2, confidence %3 %")
+                .arg(result.offset).arg(result.scale.toFixed(4))
+                .arg(Math.round(result.confidence * 100))
+        }
+
+        errorNotification.publish()
+        errorNotification.expireTimeout = 5000
+    }
+
+    function showAlignSelect()
+    {
+        currentPlaying = subSailMain.playing
+        subSailMain.playing = false
+
+        var pickerObj = pageStack.animatorPush("Sailfish.Pickers.FilePickerPage", {
+            nameFilters: SubtitleEngine.getNameFilters(),
+            popOnSelection: true
+        })
+
+        pickerObj.pageCompleted.connect(function(picker) {
+            picker.selectedContentPropertiesChanged.connect(function() {
+                alignTo(picker.selectedContentProperties['filePath'])
+            })
+        })
+    }
+
     function errorNotifyLoadFailure(message)
     {
         errorNotify(message, qsTr("Subtitle load failure"))
     }
 
+    function notifyDiagnostics()
+    {
+        var diagnostics = SubtitleEngine.getDiagnostics()
+
+        if (!diagnostics.length)
+            return
+
+        errorNotify(qsTr("Broken subtitles skipped, first on line %1: %2")
+                    .arg(diagnostics[0].line).arg(diagnostics[0].error),
+                    qsTr("Subtitle partially loaded"))
+    }
+
     function checkSubtitleLoadResult()
     {
         switch (loadStatus) {
@@ -373,9 +632,10 @@ Page {
         case 1:
             clearSubtitles()
             oldTime = 0
-            showFPSDialog()
             showFPSSelector = true
             resetOffset()
+            if (!applyKnownCorrection(true))
+                selectSuggestedFps()
             break
         case SubtitleEngine.SUBTITLE_LOAD_STATUS_OK:
         case 0:
@@ -383,6 +643,16 @@ Page {
             clearSubtitles()
             setupSubtitles()
             resetOffset()
+            applyKnownCorrection(false)
+            break
+        case SubtitleEngine.SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        case 7:
+            showFPSSelector = false
+            clearSubtitles()
+            setupSubtitles()
+            resetOffset()
+            applyKnownCorrection(false)
+            notifyDiagnostics()
             break
         default:
             console.log("subtitle load status out of bounds:", loadStatus)
@@ -446,6 +716,27 @@ Page {
         }
     }
 
+    Connections {
+        target: SubtitleEngine
+        onScrubTextChanged: showSubtitle(text)
+        onTableChanged: totalTime = SubtitleEngine.getTotalTime()
+        onMediaPlayerPlayingChanged: subSailMain.playing = playing
+        onMediaPlayerDetached: errorNotify(qsTr("Media player closed"), qsTr("Using own clock"))
+        onDensityChanged: densityTimeline.source = "image://density/" + generation
+    }
+
+    Component.onCompleted: {
+        if (followMediaPlayerSetting.value)
+            setMediaPlayerSync(true)
+
+        SubtitleEngine.setMemoryBudget(memoryBudgetSetting.value)
+
+        if (StreamSource !== "") {
+            loadStatus = SubtitleEngine.openStream(StreamSource, StreamFormat)
+            loadStatusChangedTimer.start()
+        }
+    }
+
     onTimeChanged: {
         slider.value = time ? time / 1000 : 0
         subSailMain.currentTime = time
@@ -462,7 +753,7 @@ Page {
     onPlayingChanged: {
         subtitleTimer.running = playing
         if (playing)
-            lastUpdate = new Date()
+            SubtitleEngine.resetClock()
     }
 
     onFallbackCodecChanged: {
@@ -528,6 +819,12 @@ Page {
         }
 
         PullDownMenu {
+            // Format of a stream is known only after it has started
+            onActiveChanged: {
+                if (active)
+                    canSave = SubtitleEngine.canSaveSubtitle()
+            }
+
             MenuItem {
                 text: qsTr("About")
                 onClicked: showAbout()
@@ -542,10 +839,39 @@ Page {
                 text: qsTr("Select Subtitle")
                 onClicked: showSubtitleSelect()
             }
+            MenuItem {
+                text: qsTr("Browse catalogue")
+                onClicked: showCatalogue()
+            }
+            MenuItem {
+                text: qsTr("Select track")
+                visible: subSailMain.loaded && trackCount > 1
+                onClicked: showTracks()
+            }
+            MenuItem {
+                text: qsTr("Transcript")
+                visible: subSailMain.loaded
+                onClicked: showTranscript()
+            }
+            MenuItem {
+                text: qsTr("Align to reference subtitle")
+                visible: subSailMain.loaded
+                onClicked: showAlignSelect()
+            }
+            MenuItem {
+                text: qsTr("Remember sync correction")
+                visible: subSailMain.loaded && !showFPSSelector
+                onClicked: rememberCorrection()
+            }
+            MenuItem {
+                text: qsTr("Save adjusted subtitle")
+                visible: subSailMain.loaded && canSave
+                onClicked: saveSubtitle()
+            }
             MenuItem {
                 text: qsTr("Select FPS")
                 visible: showFPSSelector
-                onClicked: showFPSDialog()
+                onClicked: showFPSDialog(0)
             }
         }
 
@@ -569,17 +895,8 @@ Page {
             property string prevSub
 
             onTriggered: {
-                var now = new Date()
-                var expired = now - lastUpdate
-                lastUpdate = now
-
-                var nextSub = SubtitleEngine.getSubtitle(expired)
-                if (nextSub !== prevSub) {
-                    prevSub = nextSub
-                    subtitlesModel.clear()
-                    subtitlesModel.append({ modelText: nextSub})
-                }
-                time += expired
+                showSubtitle(SubtitleEngine.tick())
+                time = SubtitleEngine.getCurrentTime()
 
                 if (time >= totalTime) {
                     subSailMain.playing = false
@@ -690,6 +1007,21 @@ Page {
                     width: parent.width + Theme.horizontalPageMargin * 2
                     anchors.horizontalCenter: parent.horizontalCenter
 
+                    // Where the subtitles are, drawn once per change of the timeline
+                    Image {
+                        id: densityTimeline
+                        x: slider.leftMargin
+                        width: slider.width - slider.leftMargin - slider.rightMargin
+                        height: Theme.paddingSmall
+                        anchors.top: slider.top
+                        source: ""
+                        cache: false
+                        smooth: false
+                        fillMode: Image.Stretch
+                        opacity: slider.opacity * 0.6
+                        visible: subSailMain.loaded
+                    }
+
                     Slider {
                         id: slider
                         value: time ? time / 1000 : 0
@@ -698,9 +1030,9 @@ Page {
                         stepSize: 1
                         width: parent.width
                         label: formatTime(time) + " / " + formatTime(totalTime)
-                        onPositionChanged: updateTime(value)
+                        onPositionChanged: scrubTime(value)
                         onReleased: updateTime(value)
-                        onPressed: updateTime(value)
+                        onPressed: scrubTime(value)
                         enabled: timeSliderVisible()
                         opacity: subSailMain.playing && hideSliderOnPlay ? 0.5 : 1
                     }
@@ -0,0 +1,51 @@
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+
+Page {
+    id: trackPage
+    allowedOrientations: Orientation.All
+
+    signal trackSelected(int number)
+
+    SilicaListView {
+        anchors.fill: parent
+        model: SubtitleEngine.getTracks()
+
+        header: PageHeader {
+            title: qsTr("Subtitle tracks")
+        }
+
+        delegate: ListItem {
+            contentHeight: Theme.itemSizeMedium
+            highlighted: down || modelData.selected
+
+            Column {
+                x: Theme.horizontalPageMargin
+                width: parent.width - 2 * Theme.horizontalPageMargin
+                anchors.verticalCenter: parent.verticalCenter
+
+                Label {
+                    width: parent.width
+                    text: modelData.name !== "" ? modelData.name :
+                                                  qsTr("Track %1").arg(modelData.number)
+                    truncationMode: TruncationMode.Fade
+                    color: modelData.selected ? Theme.highlightColor : Theme.primaryColor
+                }
+
+                Label {
+                    width: parent.width
+                    text: modelData.language + " · " + modelData.codec
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: Theme.secondaryColor
+                }
+            }
+
+            onClicked: {
+                trackSelected(modelData.number)
+                pageStack.pop()
+            }
+        }
+
+        VerticalScrollDecorator { }
+    }
+}
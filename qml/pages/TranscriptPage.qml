@@ -0,0 +1,145 @@
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+
+Page {
+    id: transcriptPage
+    allowedOrientations: Orientation.All
+
+    property bool followCurrent: true
+    property bool canUndo: false
+
+    // Edits are published later, rows and times are updated then
+    function editDone(done)
+    {
+        if (done)
+            canUndo = true
+    }
+
+    function padWithZero(value) {
+        return value < 10 ? "0" + value : value.toString();
+    }
+
+    function formatTime(value)
+    {
+        return padWithZero(Math.floor(value / 3600000)) + ":" +
+                padWithZero(Math.floor((value % 3600000) / 60000)) + ":" +
+                padWithZero(Math.floor((value % 60000) / 1000))
+    }
+
+    function showCurrent()
+    {
+        if (followCurrent && TranscriptModel.currentIndex >= 0)
+            transcriptView.positionViewAtIndex(TranscriptModel.currentIndex, ListView.Center)
+    }
+
+    Connections {
+        target: TranscriptModel
+        onCurrentIndexChanged: showCurrent()
+    }
+
+    Component.onCompleted: {
+        canUndo = SubtitleEngine.canUndoEdit()
+        showCurrent()
+    }
+
+    SilicaListView {
+        id: transcriptView
+        anchors.fill: parent
+        model: TranscriptModel
+        // Delegates are created only for the visible rows
+        cacheBuffer: 0
+
+        header: PageHeader {
+            title: qsTr("Transcript")
+        }
+
+        onMovementStarted: followCurrent = false
+
+        PullDownMenu {
+            MenuItem {
+                text: qsTr("Undo edit")
+                visible: canUndo
+                onClicked: canUndo = SubtitleEngine.undoEdit() && SubtitleEngine.canUndoEdit()
+            }
+            MenuItem {
+                text: qsTr("Follow current")
+                onClicked: {
+                    followCurrent = true
+                    showCurrent()
+                }
+            }
+        }
+
+        delegate: ListItem {
+            id: cueItem
+            contentHeight: textLabel.height + Theme.paddingMedium * 2
+            highlighted: current || down || menuOpen
+
+            menu: ContextMenu {
+                MenuItem {
+                    text: qsTr("Show 0.1 s earlier")
+                    onClicked: editDone(SubtitleEngine.shiftCues(index, index, -100))
+                }
+                MenuItem {
+                    text: qsTr("Show 0.1 s later")
+                    onClicked: editDone(SubtitleEngine.shiftCues(index, index, 100))
+                }
+                MenuItem {
+                    text: qsTr("Shift this and the rest by 1 s earlier")
+                    onClicked: editDone(SubtitleEngine.shiftCues(index, transcriptView.count - 1, -1000))
+                }
+                MenuItem {
+                    text: qsTr("Shift this and the rest by 1 s later")
+                    onClicked: editDone(SubtitleEngine.shiftCues(index, transcriptView.count - 1, 1000))
+                }
+                MenuItem {
+                    text: qsTr("Split in half")
+                    visible: endTime - startTime > 1
+                    onClicked: editDone(SubtitleEngine.splitCue(index, Math.floor((startTime + endTime) / 2)))
+                }
+                MenuItem {
+                    text: qsTr("Merge with next")
+                    visible: index + 1 < transcriptView.count
+                    onClicked: editDone(SubtitleEngine.mergeCues(index))
+                }
+                MenuItem {
+                    text: qsTr("Edit text")
+                    onClicked: {
+                        var row = index
+                        var dialog = pageStack.push(Qt.resolvedUrl("CueTextDialog.qml"),
+                                                    { text: model.text })
+                        dialog.accepted.connect(function() {
+                            editDone(SubtitleEngine.setCueText(row, dialog.text))
+                        })
+                    }
+                }
+            }
+
+            Label {
+                id: timeLabel
+                x: Theme.horizontalPageMargin
+                y: Theme.paddingMedium
+                text: formatTime(startTime)
+                font.pixelSize: Theme.fontSizeExtraSmall
+                color: current ? Theme.highlightColor : Theme.secondaryColor
+            }
+
+            Label {
+                id: textLabel
+                anchors {
+                    left: timeLabel.right
+                    leftMargin: Theme.paddingMedium
+                    right: parent.right
+                    rightMargin: Theme.horizontalPageMargin
+                }
+                y: Theme.paddingMedium
+                text: model.text
+                textFormat: Text.RichText
+                wrapMode: Text.Wrap
+                color: current ? Theme.highlightColor : Theme.primaryColor
+            }
+        }
+
+        VerticalScrollDecorator { }
+    }
+}
@@ -0,0 +1,651 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cueeditor.h"
+
+#include <climits>
+#include <cmath>
+#include <QStringList>
+
+struct CueNode {
+    Subtitle cue;          // Text and the fields not edited
+    double start;          // Times before the transform
+    double end;
+    double maxEnd;         // Latest end in the subtree, before the transform
+    double scale;          // Transform of the subtree, this node included
+    double offset;
+    double timeScale;      // Time scale of the editor when cue was read
+    quint64 id;            // Orders cues starting at the same time
+    quint32 priority;
+    int size;
+    CueNodeRef left;
+    CueNodeRef right;
+};
+
+static int sizeOf(const CueNodeRef &node)
+{
+    return node ? node->size : 0;
+}
+
+static double apply(double scale, double offset, double time)
+{
+    return scale * time + offset;
+}
+
+static unsigned int roundClamp(double time)
+{
+    if (time <= 0.0)
+        return 0;
+    if (time >= static_cast<double>(UINT_MAX))
+        return UINT_MAX;
+
+    return static_cast<unsigned int>(std::floor(time + 0.5));
+}
+
+static double maxEndOf(const CueNodeRef &node)
+{
+    return node ? apply(node->scale, node->offset, node->maxEnd) : -HUGE_VAL;
+}
+
+// New node over the subtrees, values are the ones seen from outside
+static CueNodeRef link(const CueNode &values, const CueNodeRef &left,
+                       const CueNodeRef &right)
+{
+    CueNode *node = new CueNode(values);
+
+    node->scale = 1.0;
+    node->offset = 0.0;
+    node->left = left;
+    node->right = right;
+    node->size = sizeOf(left) + sizeOf(right) + 1;
+    node->maxEnd = qMax(node->end, qMax(maxEndOf(left), maxEndOf(right)));
+
+    return CueNodeRef(node);
+}
+
+// Copy of the node with another transform applied after its own
+static CueNodeRef transformed(const CueNodeRef &node, double scale, double offset)
+{
+    CueNode *copy;
+
+    if (!node || (scale == 1.0 && offset == 0.0))
+        return node;
+
+    copy = new CueNode(*node);
+    copy->scale = scale * node->scale;
+    copy->offset = scale * node->offset + offset;
+
+    return CueNodeRef(copy);
+}
+
+// Values of the node as seen from outside, transform moved to the children
+static void open(const CueNodeRef &node, CueNode &values, CueNodeRef &left,
+                 CueNodeRef &right)
+{
+    values = *node;
+    values.start = apply(node->scale, node->offset, node->start);
+    values.end = apply(node->scale, node->offset, node->end);
+    left = transformed(node->left, node->scale, node->offset);
+    right = transformed(node->right, node->scale, node->offset);
+}
+
+static bool keyLess(double start, quint64 id, const CueNode &node)
+{
+    return start < node.start || (start == node.start && id < node.id);
+}
+
+// First count cues to left, the rest to right
+static void splitAt(const CueNodeRef &node, int count, CueNodeRef &left,
+                    CueNodeRef &right)
+{
+    CueNode values;
+    CueNodeRef nodeLeft;
+    CueNodeRef nodeRight;
+    CueNodeRef middle;
+
+    if (!node) {
+        left.clear();
+        right.clear();
+        return;
+    }
+
+    open(node, values, nodeLeft, nodeRight);
+
+    if (sizeOf(nodeLeft) >= count) {
+        splitAt(nodeLeft, count, left, middle);
+        right = link(values, middle, nodeRight);
+    } else {
+        splitAt(nodeRight, count - sizeOf(nodeLeft) - 1, middle, right);
+        left = link(values, nodeLeft, middle);
+    }
+}
+
+// Cues ordered before the key to left, the rest to right
+static void splitKey(const CueNodeRef &node, double start, quint64 id,
+                     CueNodeRef &left, CueNodeRef &right)
+{
+    CueNode values;
+    CueNodeRef nodeLeft;
+    CueNodeRef nodeRight;
+    CueNodeRef middle;
+
+    if (!node) {
+        left.clear();
+        right.clear();
+        return;
+    }
+
+    open(node, values, nodeLeft, nodeRight);
+
+    if (keyLess(start, id, values)) {
+        splitKey(nodeLeft, start, id, left, middle);
+        right = link(values, middle, nodeRight);
+    } else {
+        splitKey(nodeRight, start, id, middle, right);
+        left = link(values, nodeLeft, middle);
+    }
+}
+
+// All cues of left are ordered before the ones of right
+static CueNodeRef join(const CueNodeRef &left, const CueNodeRef &right)
+{
+    CueNode values;
+    CueNodeRef nodeLeft;
+    CueNodeRef nodeRight;
+
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+
+    if (left->priority > right->priority) {
+        open(left, values, nodeLeft, nodeRight);
+        return link(values, nodeLeft, join(nodeRight, right));
+    }
+
+    open(right, values, nodeLeft, nodeRight);
+    return link(values, join(left, nodeLeft), nodeRight);
+}
+
+// Key of the first or the last cue, with the transforms on the way applied
+static void edgeKey(const CueNodeRef &node, bool last, double &start, quint64 &id)
+{
+    CueNodeRef edge = node;
+    CueNodeRef child;
+    double scale = 1.0;
+    double offset = 0.0;
+
+    for (;;) {
+        offset = scale * edge->offset + offset;
+        scale = scale * edge->scale;
+
+        child = last ? edge->right : edge->left;
+        if (!child)
+            break;
+
+        edge = child;
+    }
+
+    start = apply(scale, offset, edge->start);
+    id = edge->id;
+}
+
+// All cues of left are ordered before the ones of right
+static bool isOrdered(const CueNodeRef &left, const CueNodeRef &right)
+{
+    double leftStart;
+    double rightStart;
+    quint64 leftId;
+    quint64 rightId;
+
+    if (!left || !right)
+        return true;
+
+    edgeKey(left, true, leftStart, leftId);
+    edgeKey(right, false, rightStart, rightId);
+
+    return leftStart < rightStart || (leftStart == rightStart && leftId < rightId);
+}
+
+/*
+ * Cues of both in one treap, for a retimed range that may now interleave
+ * with its neighbours. Only the parts that actually interleave are split.
+ */
+static CueNodeRef unite(const CueNodeRef &a, const CueNodeRef &b)
+{
+    CueNode values;
+    CueNodeRef nodeLeft;
+    CueNodeRef nodeRight;
+    CueNodeRef before;
+    CueNodeRef after;
+
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (a->priority < b->priority)
+        return unite(b, a);
+
+    open(a, values, nodeLeft, nodeRight);
+    splitKey(b, values.start, values.id, before, after);
+
+    return link(values, unite(nodeLeft, before), unite(nodeRight, after));
+}
+
+// Frame moved by as much as the time was, the cue keeps the time it had
+static unsigned int retimeFrame(unsigned int frame, double before,
+                                unsigned int after, double fps)
+{
+    double moved = (after - before) * fps / 1000.0;
+
+    return roundClamp(frame + moved);
+}
+
+// Times the cue was read with are scaled along with the editor by retime()
+static void collect(const CueNodeRef &node, double scale, double offset,
+                    double fps, double timeScale, SubtitleList &subtitles)
+{
+    Subtitle cue;
+    double retimed;
+
+    if (!node)
+        return;
+
+    offset = scale * node->offset + offset;
+    scale = scale * node->scale;
+
+    collect(node->left, scale, offset, fps, timeScale, subtitles);
+
+    cue = node->cue;
+    cue.start_time = roundClamp(apply(scale, offset, node->start));
+    cue.end_time = roundClamp(apply(scale, offset, node->end));
+
+    if (fps > 0.0) {
+        retimed = timeScale / node->timeScale;
+        cue.start_frame = retimeFrame(cue.start_frame,
+                                      node->cue.start_time * retimed,
+                                      cue.start_time, fps);
+        cue.end_frame = retimeFrame(cue.end_frame,
+                                    node->cue.end_time * retimed,
+                                    cue.end_time, fps);
+    }
+
+    subtitles.append(cue);
+
+    collect(node->right, scale, offset, fps, timeScale, subtitles);
+}
+
+CueEditor::CueEditor() :
+    iTimeScale(1.0),
+    iMoved(false),
+    iNextId(0),
+    iSeed(0x9e3779b9)
+{
+}
+
+CueNodeRef CueEditor::newNode(const Subtitle &cue, double start, double end,
+                              double timeScale)
+{
+    CueNode values;
+
+    // xorshift, the priorities only need to be spread
+    iSeed ^= iSeed << 13;
+    iSeed ^= iSeed >> 17;
+    iSeed ^= iSeed << 5;
+
+    values.cue = cue;
+    values.start = start;
+    values.end = end;
+    values.timeScale = timeScale;
+    values.id = iNextId++;
+    values.priority = iSeed;
+
+    return link(values, CueNodeRef(), CueNodeRef());
+}
+
+// Cues are expected in start time order, as in a cue table
+void CueEditor::reset(const SubtitleList &subtitles)
+{
+    iRoot.clear();
+    iUndo.clear();
+    iTimeScale = 1.0;
+    iMoved = false;
+
+    for (const Subtitle &cue : subtitles)
+        iRoot = join(iRoot, newNode(cue, cue.start_time, cue.end_time, iTimeScale));
+}
+
+/*
+ * Cues are added to the versions kept for undo as well, the nodes are shared
+ * by all of them. Each one lands after the cues starting at the same time, as
+ * in a table built from the cues so far followed by these.
+ */
+void CueEditor::append(const SubtitleList &cues)
+{
+    CueNodeRef added;
+
+    for (const Subtitle &cue : cues)
+        added = unite(added, newNode(cue, cue.start_time, cue.end_time, iTimeScale));
+
+    iRoot = unite(iRoot, added);
+    iMoved = true;
+    for (CueNodeRef &root : iUndo)
+        root = unite(root, added);
+}
+
+// A tag on each root, the versions share their nodes as before
+void CueEditor::retime(double scale)
+{
+    if (scale <= 0.0 || scale == 1.0)
+        return;
+
+    iTimeScale *= scale;
+
+    iRoot = transformed(iRoot, scale, 0.0);
+    for (CueNodeRef &root : iUndo)
+        root = transformed(root, scale, 0.0);
+}
+
+int CueEditor::size() const
+{
+    return sizeOf(iRoot);
+}
+
+bool CueEditor::isEmpty() const
+{
+    return !iRoot;
+}
+
+SubtitleList CueEditor::subtitles(double fps) const
+{
+    SubtitleList subtitles;
+
+    subtitles.reserve(size());
+    collect(iRoot, 1.0, 0.0, fps, iTimeScale, subtitles);
+
+    return subtitles;
+}
+
+Subtitle CueEditor::at(int position) const
+{
+    CueNodeRef node = iRoot;
+    double scale = 1.0;
+    double offset = 0.0;
+    Subtitle cue;
+
+    while (node) {
+        offset = scale * node->offset + offset;
+        scale = scale * node->scale;
+
+        if (position < sizeOf(node->left)) {
+            node = node->left;
+        } else if (position == sizeOf(node->left)) {
+            cue = node->cue;
+            cue.start_time = roundClamp(apply(scale, offset, node->start));
+            cue.end_time = roundClamp(apply(scale, offset, node->end));
+            break;
+        } else {
+            position -= sizeOf(node->left) + 1;
+            node = node->right;
+        }
+    }
+
+    return cue;
+}
+
+int CueEditor::findPosition(unsigned int time) const
+{
+    CueNodeRef node = iRoot;
+    double scale = 1.0;
+    double offset = 0.0;
+    int position = 0;
+
+    while (node) {
+        offset = scale * node->offset + offset;
+        scale = scale * node->scale;
+
+        if (node->left && roundClamp(apply(scale, offset,
+                        apply(node->left->scale, node->left->offset,
+                              node->left->maxEnd))) >= time) {
+            node = node->left;
+        } else if (roundClamp(apply(scale, offset, node->end)) >= time) {
+            return position + sizeOf(node->left);
+        } else {
+            position += sizeOf(node->left) + 1;
+            node = node->right;
+        }
+    }
+
+    return position;
+}
+
+int CueEditor::cueAt(unsigned int time) const
+{
+    int position = findPosition(time);
+
+    if (position >= size() || at(position).start_time > time)
+        return -1;
+
+    return position;
+}
+
+QVector<int> CueEditor::cuesInRange(unsigned int from, unsigned int to) const
+{
+    QVector<int> positions;
+    Subtitle cue;
+
+    for (int position = findPosition(from); position < size(); position++) {
+        cue = at(position);
+        if (cue.start_time >= to)
+            break;
+
+        if (cue.end_time >= from)
+            positions.append(position);
+    }
+
+    return positions;
+}
+
+unsigned int CueEditor::nextChangeAfter(unsigned int time) const
+{
+    int position = findPosition(time);
+    Subtitle cue;
+
+    if (position >= size())
+        return UINT_MAX;
+
+    cue = at(position);
+    if (cue.start_time > time)
+        return cue.start_time;
+
+    return cue.end_time < UINT_MAX ? cue.end_time + 1 : UINT_MAX;
+}
+
+void CueEditor::saveUndo()
+{
+    iUndo.append(iRoot);
+
+    if (iUndo.size() > CUEEDITOR_UNDO_MAX)
+        iUndo.remove(0);
+}
+
+/*
+ * The range is cut out, tagged with the transform and merged back. Order
+ * within the range is kept by the transform, so only where it overlaps the
+ * other cues is walked. A range still between its neighbours is joined back
+ * in place and the positions stay.
+ */
+bool CueEditor::transformRange(int from, int to, double scale, double offset)
+{
+    CueNodeRef before;
+    CueNodeRef range;
+    CueNodeRef after;
+
+    if (from < 0 || to < from || to >= size() || scale <= 0.0)
+        return false;
+
+    saveUndo();
+
+    splitAt(iRoot, from, before, range);
+    splitAt(range, to - from + 1, range, after);
+    range = transformed(range, scale, offset);
+
+    if (isOrdered(before, range) && isOrdered(range, after)) {
+        iRoot = join(join(before, range), after);
+    } else {
+        iRoot = unite(join(before, after), range);
+        iMoved = true;
+    }
+
+    return true;
+}
+
+bool CueEditor::shift(int from, int to, int delta)
+{
+    return transformRange(from, to, 1.0, delta);
+}
+
+bool CueEditor::stretch(int from, int to, double scale)
+{
+    double anchor;
+
+    if (from < 0 || from >= size())
+        return false;
+
+    anchor = at(from).start_time;
+
+    return transformRange(from, to, scale, anchor - anchor * scale);
+}
+
+bool CueEditor::split(int position, unsigned int time)
+{
+    CueNodeRef before;
+    CueNodeRef node;
+    CueNodeRef after;
+    CueNode values;
+    CueNodeRef left;
+    CueNodeRef right;
+    Subtitle rest;
+    QStringList lines;
+    double end;
+
+    if (position < 0 || position >= size())
+        return false;
+
+    splitAt(iRoot, position, before, node);
+    splitAt(node, 1, node, after);
+
+    open(node, values, left, right);
+    if (time <= roundClamp(values.start) || time >= roundClamp(values.end))
+        return false;
+
+    // Lines are shared between the two, a single line is kept in both
+    lines = values.cue.text.split(QStringLiteral("<br>"));
+    rest = values.cue;
+    if (lines.size() > 1) {
+        values.cue.text = QStringList(lines.mid(0, (lines.size() + 1) / 2)).join(QStringLiteral("<br>"));
+        rest.text = QStringList(lines.mid((lines.size() + 1) / 2)).join(QStringLiteral("<br>"));
+    }
+
+    saveUndo();
+
+    // First part keeps its place, the rest may land after later cues
+    end = values.end;
+    values.end = time;
+    iRoot = unite(join(join(before, link(values, left, right)), after),
+                  newNode(rest, time, end, values.timeScale));
+    iMoved = true;
+
+    return true;
+}
+
+bool CueEditor::merge(int position)
+{
+    CueNodeRef before;
+    CueNodeRef node;
+    CueNodeRef next;
+    CueNodeRef after;
+    CueNode values;
+    CueNode nextValues;
+    CueNodeRef left;
+    CueNodeRef right;
+
+    if (position < 0 || position + 1 >= size())
+        return false;
+
+    saveUndo();
+
+    splitAt(iRoot, position, before, node);
+    splitAt(node, 1, node, next);
+    splitAt(next, 1, next, after);
+
+    open(next, nextValues, left, right);
+    open(node, values, left, right);
+    values.end = qMax(values.end, nextValues.end);
+    values.cue.text = values.cue.text + QStringLiteral("<br>") + nextValues.cue.text;
+
+    // Keeps the place of the first of the pair, the order stays
+    iRoot = join(join(before, link(values, left, right)), after);
+    iMoved = true;
+
+    return true;
+}
+
+bool CueEditor::setText(int position, const QString &text)
+{
+    CueNodeRef before;
+    CueNodeRef node;
+    CueNodeRef after;
+    CueNode values;
+    CueNodeRef left;
+    CueNodeRef right;
+
+    if (position < 0 || position >= size())
+        return false;
+
+    saveUndo();
+
+    splitAt(iRoot, position, before, node);
+    splitAt(node, 1, node, after);
+
+    open(node, values, left, right);
+    values.cue.text = text;
+
+    iRoot = join(join(before, link(values, left, right)), after);
+
+    return true;
+}
+
+bool CueEditor::undo()
+{
+    if (iUndo.isEmpty())
+        return false;
+
+    iRoot = iUndo.takeLast();
+    // Not known what the undone edit did
+    iMoved = true;
+
+    return true;
+}
+
+bool CueEditor::canUndo() const
+{
+    return !iUndo.isEmpty();
+}
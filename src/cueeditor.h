@@ -0,0 +1,104 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUEEDITOR_H
+#define CUEEDITOR_H
+
+#include <QSharedPointer>
+#include <QVector>
+#include "types.h"
+
+// Earlier versions kept for undo
+#define CUEEDITOR_UNDO_MAX 100
+
+struct CueNode;
+typedef QSharedPointer<const CueNode> CueNodeRef;
+
+/*
+ * Editable copy of the cues for retiming and fixing single lines. Cues are
+ * kept in a persistent treap ordered by start time. Each node carries an
+ * affine transform of the times of its subtree and the latest end time in
+ * it, so a range is shifted or stretched by tagging O(log n) nodes and the
+ * end times needed for seeking stay valid without visiting the range.
+ *
+ * Nodes are never changed once created, an edit copies only the path it
+ * touches. The version before each edit is a root to go back to, which is
+ * the undo log.
+ *
+ * Positions are in start time order like in the cue table, times are in
+ * milliseconds without the playback offset. Until the edits are in a table
+ * the queries below stand in for the ones of the table, on the cues as
+ * edited and not normalized.
+ */
+class CueEditor
+{
+public:
+    CueEditor();
+
+    void reset(const SubtitleList &subtitles);
+    // Cues added to the table meanwhile, e.g. streamed, undo is kept
+    void append(const SubtitleList &cues);
+    // Times of all versions scaled, when the table is timed for another FPS
+    void retime(double scale);
+    int size() const;
+    bool isEmpty() const;
+    /*
+     * All cues in order, for a new cue table. With the frame rate the frames
+     * of retimed cues are moved along, for formats timed in frames.
+     */
+    SubtitleList subtitles(double fps = 0.0) const;
+    Subtitle at(int position) const;
+    // First cue not ended at the time, size when all have ended
+    int findPosition(unsigned int time) const;
+    // Position of the cue shown at the time, -1 when none is
+    int cueAt(unsigned int time) const;
+    // Positions of the cues shown at any time in [from, to)
+    QVector<int> cuesInRange(unsigned int from, unsigned int to) const;
+    // First time after the given one showing something else, UINT_MAX if none
+    unsigned int nextChangeAfter(unsigned int time) const;
+
+    bool shift(int from, int to, int delta);
+    // Times of the range scaled from the start of the first cue
+    bool stretch(int from, int to, double scale);
+    // Cue ends at the time and the rest becomes a new cue
+    bool split(int position, unsigned int time);
+    // Cue and the next one become one
+    bool merge(int position);
+    bool setText(int position, const QString &text);
+    bool undo();
+    bool canUndo() const;
+    // Some cue is at another position than when the flag was cleared
+    bool hasMoved() const { return iMoved; }
+    void clearMoved() { iMoved = false; }
+
+private:
+    CueNodeRef newNode(const Subtitle &cue, double start, double end,
+                       double timeScale);
+    bool transformRange(int from, int to, double scale, double offset);
+    void saveUndo();
+
+    CueNodeRef iRoot;
+    QVector<CueNodeRef> iUndo;
+    double iTimeScale;
+    bool iMoved;
+    quint64 iNextId;
+    quint32 iSeed;
+};
+
+#endif // CUEEDITOR_H
@@ -0,0 +1,363 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cuetable.h"
+
+#include <algorithm>
+#include <climits>
+#include <QPair>
+#include <QtDebug>
+
+#define CUETABLE_BUCKET_SIZE 1000
+// Bogus times far in the future must not blow up the bucket table, 9 hours
+#define CUETABLE_MAX_BUCKETS 32768
+
+CueTable::CueTable(const SubtitleList &subtitles) :
+    iSubtitles(normalize(subtitles))
+{
+    int size = iSubtitles.size();
+    unsigned int maxEnd = 0;
+
+    iMaxEnd.resize(size);
+    iNextStart.resize(size);
+
+    for (int i = 0; i < size; i++) {
+        maxEnd = qMax(maxEnd, iSubtitles.at(i).end_time);
+        iMaxEnd[i] = maxEnd;
+        iNextStart[i] = i + 1 < size ? iSubtitles.at(i + 1).start_time : UINT_MAX;
+    }
+
+    iTotalTime = maxEnd;
+
+    // First position with maximum end at or after the start of each bucket
+    if (size)
+        iBuckets.resize(qMin(iSubtitles.last().start_time / CUETABLE_BUCKET_SIZE + 1,
+                             static_cast<unsigned int>(CUETABLE_MAX_BUCKETS)));
+    for (int bucket = 0, position = 0; bucket < iBuckets.size(); bucket++) {
+        unsigned int bucketStart = static_cast<unsigned int>(bucket) * CUETABLE_BUCKET_SIZE;
+
+        while (position < size && iMaxEnd.at(position) < bucketStart)
+            position++;
+
+        iBuckets[bucket] = position;
+    }
+}
+
+qint64 CueTable::memoryCost() const
+{
+    return iSubtitles.capacity() * sizeof(Subtitle) +
+            (iMaxEnd.capacity() + iNextStart.capacity()) * sizeof(unsigned int) +
+            iBuckets.capacity() * sizeof(int) + textCost();
+}
+
+qint64 CueTable::textCost() const
+{
+    qint64 cost = 0;
+
+    for (const Subtitle &subtitle : iSubtitles)
+        cost += subtitle.text.capacity() * sizeof(QChar);
+
+    return cost;
+}
+
+/*
+ * Find the first subtitle that has not ended at the given time, or size when
+ * all have ended. Starts from the bucket of the time and scans only the
+ * subtitles ending within the same second. Past the buckets the search
+ * gallops from the last one.
+ */
+int CueTable::findPosition(unsigned int time) const
+{
+    unsigned int bucket = time / CUETABLE_BUCKET_SIZE;
+    int size = iSubtitles.size();
+    int position;
+
+    if (bucket >= static_cast<unsigned int>(iBuckets.size())) {
+        position = iBuckets.isEmpty() ? size : iBuckets.last();
+
+        return position < size ? findPosition(time, position) : size;
+    }
+
+    position = iBuckets.at(static_cast<int>(bucket));
+    while (position < size && iMaxEnd.at(position) < time)
+        position++;
+
+    return position;
+}
+
+/*
+ * As above, but gallops from the hint position so that nearby changes cost
+ * only a few comparisons, and any jump O(log n).
+ */
+int CueTable::findPosition(unsigned int time, int hint) const
+{
+    int size = iSubtitles.size();
+    int low = 0;
+    int high = size;
+    int step = 1;
+
+    if (hint < 0 || hint >= size)
+        return findPosition(time);
+
+    if (iMaxEnd.at(hint) < time) {
+        low = hint + 1;
+        while (hint + step < size && iMaxEnd.at(hint + step) < time) {
+            low = hint + step + 1;
+            step *= 2;
+        }
+
+        high = hint + step < size ? hint + step : size;
+    } else {
+        high = hint;
+        while (hint - step >= 0 && iMaxEnd.at(hint - step) >= time) {
+            high = hint - step;
+            step *= 2;
+        }
+
+        low = hint - step >= 0 ? hint - step + 1 : 0;
+    }
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+
+        if (iMaxEnd.at(mid) < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/*
+ * The first subtitle not ended is the one shown, as the ones before it have
+ * all ended. It is shown from its start until the end, inclusive.
+ */
+int CueTable::cueAt(unsigned int time) const
+{
+    int position = findPosition(time);
+
+    if (position >= iSubtitles.size() || iSubtitles.at(position).start_time > time)
+        return -1;
+
+    return position;
+}
+
+QVector<int> CueTable::cuesInRange(unsigned int from, unsigned int to) const
+{
+    QVector<int> positions;
+
+    for (int position = findPosition(from); position < iSubtitles.size() &&
+                iSubtitles.at(position).start_time < to; position++) {
+        if (iSubtitles.at(position).end_time >= from)
+            positions.append(position);
+    }
+
+    return positions;
+}
+
+unsigned int CueTable::nextChangeAfter(unsigned int time) const
+{
+    int position = findPosition(time);
+    unsigned int end;
+
+    if (position >= iSubtitles.size())
+        return UINT_MAX;
+
+    if (iSubtitles.at(position).start_time > time)
+        return iSubtitles.at(position).start_time;
+
+    // Overlapping subtitles are shown after the current one has ended
+    end = iSubtitles.at(position).end_time;
+
+    return end < UINT_MAX ? end + 1 : UINT_MAX;
+}
+
+/*
+ * Stable LSD radix sort of the positions by start time, a byte per pass.
+ * Passes where all keys share the byte are skipped.
+ */
+void CueTable::sortByStart(const SubtitleList &subtitles, QVector<int> &order)
+{
+    int size = subtitles.size();
+    QVector<int> sorted(size);
+
+    order.resize(size);
+    for (int i = 0; i < size; i++)
+        order[i] = i;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        int count[257] = { 0 };
+
+        for (int i = 0; i < size; i++)
+            count[((subtitles.at(order.at(i)).start_time >> shift) & 0xff) + 1]++;
+
+        if (count[((subtitles.at(order.at(0)).start_time >> shift) & 0xff) + 1] == size)
+            continue;
+
+        for (int digit = 0; digit < 256; digit++)
+            count[digit + 1] += count[digit];
+
+        for (int i = 0; i < size; i++) {
+            int position = order.at(i);
+            int digit = (subtitles.at(position).start_time >> shift) & 0xff;
+
+            sorted[count[digit]++] = position;
+        }
+
+        order.swap(sorted);
+    }
+}
+
+SubtitleList CueTable::normalize(const SubtitleList &subtitles)
+{
+    SubtitleList normalized;
+    QVector<int> order;
+    // Ends and positions of the earlier subtitles overlapping the current one
+    // as a heap, the latest end first. Emptied at each gap between subtitles.
+    QVector<QPair<unsigned int, int> > covering;
+    unsigned int maxEnd = 0;
+    int size = subtitles.size();
+    int overlaps = 0;
+    int nested = 0;
+    bool sorted = true;
+
+    for (int i = 1; i < size && sorted; i++)
+        sorted = subtitles.at(i - 1).start_time <= subtitles.at(i).start_time;
+
+    if (sorted) {
+        normalized = subtitles;
+    } else {
+        qDebug() << "subtitles are not in order, sorting";
+
+        sortByStart(subtitles, order);
+
+        normalized.reserve(size);
+        for (int i = 0; i < size; i++)
+            normalized.append(subtitles.at(order.at(i)));
+    }
+
+    for (int i = 0; i < size; i++) {
+        const Subtitle &subtitle = normalized.at(i);
+        unsigned int start = subtitle.start_time;
+        unsigned int end = subtitle.end_time;
+        unsigned int flags = SUB_FLAG_NONE;
+
+        // Reversed times are handled as zero length
+        if (end <= start) {
+            flags |= SUB_FLAG_ZERO_LENGTH;
+            end = start;
+        }
+
+        if (i > 0 && start < maxEnd) {
+            flags |= SUB_FLAG_OVERLAP;
+            overlaps++;
+
+            if (normalized.at(i - 1).end_time > start &&
+                        !(normalized.at(i - 1).flags & SUB_FLAG_OVERLAP))
+                normalized[i - 1].flags |= SUB_FLAG_OVERLAP;
+
+            // Earlier subtitles that would be shown over all of this one
+            while (!(flags & SUB_FLAG_ZERO_LENGTH) && covering.first().first >= end) {
+                QPair<unsigned int, int> outer = covering.first();
+                Subtitle &changed = normalized[outer.second];
+
+                std::pop_heap(covering.begin(), covering.end());
+                nested++;
+
+                if (changed.start_time < start) {
+                    changed.end_time = start - 1;
+                    outer.first = changed.end_time;
+                    covering.last() = outer;
+                    std::push_heap(covering.begin(), covering.end());
+                    continue;
+                }
+
+                // Starting at the same time, show both texts. This one is left
+                // zero length, so normalizing again does not repeat the merge.
+                changed.text += QStringLiteral("<br>") + normalized.at(i).text;
+                covering.last() = outer;
+                std::push_heap(covering.begin(), covering.end());
+
+                normalized[i].end_frame = normalized.at(i).start_frame;
+                flags |= SUB_FLAG_ZERO_LENGTH;
+                end = start;
+                break;
+            }
+        } else {
+            covering.clear();
+        }
+
+        covering.append(qMakePair(end, i));
+        std::push_heap(covering.begin(), covering.end());
+        maxEnd = covering.first().first;
+
+        // Write only when changed to avoid detaching a shared list
+        if (normalized.at(i).index != i + 1 ||
+                    normalized.at(i).flags != flags ||
+                    normalized.at(i).end_time != end) {
+            Subtitle &changed = normalized[i];
+
+            changed.index = i + 1;
+            changed.flags = flags;
+            changed.end_time = end;
+        }
+    }
+
+    if (overlaps)
+        qDebug() << overlaps << "overlapping subtitles," << nested << "nested";
+
+    return normalized;
+}
+
+CueTableMailbox::CueTableMailbox() :
+    iPending(nullptr)
+{
+}
+
+CueTableMailbox::~CueTableMailbox()
+{
+    delete iPending.fetchAndStoreAcquire(nullptr);
+}
+
+void CueTableMailbox::publish(const CueTableRef &table)
+{
+    CueTableRef *pending = new CueTableRef(table);
+
+    // Table that was never picked up is replaced by the newer one
+    delete iPending.fetchAndStoreOrdered(pending);
+}
+
+bool CueTableMailbox::take(CueTableRef &table)
+{
+    CueTableRef *pending;
+
+    // Cheap check for the common case of nothing being published
+    if (!iPending.loadAcquire())
+        return false;
+
+    pending = iPending.fetchAndStoreAcquire(nullptr);
+    if (!pending)
+        return false;
+
+    table = *pending;
+    delete pending;
+
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUETABLE_H
+#define CUETABLE_H
+
+#include <QAtomicPointer>
+#include <QSharedPointer>
+#include <QVector>
+#include "types.h"
+
+/*
+ * Immutable table of subtitles. Once created it is only read, so any number
+ * of readers can use it without synchronization.
+ *
+ * Subtitles are normalized when the table is created: sorted by start time,
+ * numbered from 1 and flagged when zero length or overlapping. A subtitle
+ * nested within an earlier, longer one would never be shown, the longer one
+ * is cut to end before it or takes its text when both start at once, the
+ * nested one left zero length. The running maximum of end times is
+ * monotonic also with overlapping subtitles and is used for the seeks.
+ *
+ * A table of one second buckets gives the first subtitle not ended at the
+ * start of each second for constant time lookups. Buckets cover up to the
+ * start of the last subtitle, at most nine hours of them, and later
+ * times are searched from the last bucket.
+ *
+ * Queries are const and in table time, without an offset. They are what the
+ * playback cursor is built on, and can be used by any number of readers
+ * without disturbing the playback.
+ */
+class CueTable
+{
+public:
+    explicit CueTable(const SubtitleList &subtitles);
+
+    const SubtitleList &subtitles() const { return iSubtitles; }
+    int size() const { return iSubtitles.size(); }
+    bool isEmpty() const { return iSubtitles.isEmpty(); }
+    const Subtitle &at(int position) const { return iSubtitles.at(position); }
+    const Subtitle &first() const { return iSubtitles.first(); }
+    const Subtitle &last() const { return iSubtitles.last(); }
+    unsigned int totalTime() const { return iTotalTime; }
+    // Bytes held by the table and the text of the subtitles
+    qint64 memoryCost() const;
+    // Bytes held by the text of the subtitles only
+    qint64 textCost() const;
+    unsigned int maxEnd(int position) const { return iMaxEnd.at(position); }
+    unsigned int nextStart(int position) const { return iNextStart.at(position); }
+    int findPosition(unsigned int time) const;
+    int findPosition(unsigned int time, int hint) const;
+
+    // Position of the subtitle shown at the time, -1 when none is
+    int cueAt(unsigned int time) const;
+    // Positions of the subtitles shown at any time in [from, to)
+    QVector<int> cuesInRange(unsigned int from, unsigned int to) const;
+    // First time after the given one showing something else, UINT_MAX if none
+    unsigned int nextChangeAfter(unsigned int time) const;
+
+private:
+    static SubtitleList normalize(const SubtitleList &subtitles);
+    static void sortByStart(const SubtitleList &subtitles, QVector<int> &order);
+
+    const SubtitleList iSubtitles;
+    QVector<unsigned int> iMaxEnd;
+    QVector<unsigned int> iNextStart;
+    QVector<int> iBuckets;
+    unsigned int iTotalTime;
+};
+
+typedef QSharedPointer<const CueTable> CueTableRef;
+
+/*
+ * Publication point of cue tables. Any thread can publish a new table and the
+ * single consumer picks the latest one up with an atomic exchange, without
+ * locks. A replaced table is freed when the last reader drops its reference.
+ */
+class CueTableMailbox
+{
+public:
+    CueTableMailbox();
+    ~CueTableMailbox();
+
+    void publish(const CueTableRef &table);
+    bool take(CueTableRef &table);
+
+private:
+    QAtomicPointer<CueTableRef> iPending;
+};
+
+#endif // CUETABLE_H
@@ -0,0 +1,52 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "densityimageprovider.h"
+#include "subtitleengine.h"
+
+DensityImageProvider::DensityImageProvider(SubtitleEngine *engine) :
+    QQuickImageProvider(QQuickImageProvider::Image),
+    iEngine(engine)
+{
+}
+
+QImage DensityImageProvider::requestImage(const QString &id, QSize *size,
+                                          const QSize &requestedSize)
+{
+    const QVector<float> density = iEngine->getDensity();
+    QImage image(qMax(density.size(), 1), 1, QImage::Format_ARGB32_Premultiplied);
+    QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(0));
+
+    Q_UNUSED(id);
+    Q_UNUSED(requestedSize);
+
+    image.fill(Qt::transparent);
+
+    // Premultiplied white, scaled by the item
+    for (int i = 0; i < density.size(); i++) {
+        int alpha = qRound(density.at(i) * 255.0f);
+
+        line[i] = qRgba(alpha, alpha, alpha, alpha);
+    }
+
+    if (size)
+        *size = image.size();
+
+    return image;
+}
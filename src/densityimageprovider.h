@@ -0,0 +1,46 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DENSITYIMAGEPROVIDER_H
+#define DENSITYIMAGEPROVIDER_H
+
+#include <QQuickImageProvider>
+
+class SubtitleEngine;
+
+/*
+ * Draws the subtitle density timeline of the engine as a one pixel high
+ * image, the alpha of each pixel is the density of its bucket. The id of the
+ * image is the generation from SubtitleEngine::densityChanged(), so the
+ * image is only requested again when the timeline changes. Requests must be
+ * synchronous as the engine is not locked.
+ */
+class DensityImageProvider : public QQuickImageProvider
+{
+public:
+    explicit DensityImageProvider(SubtitleEngine *engine);
+
+    QImage requestImage(const QString &id, QSize *size,
+                        const QSize &requestedSize);
+
+private:
+    SubtitleEngine *iEngine;
+};
+
+#endif // DENSITYIMAGEPROVIDER_H
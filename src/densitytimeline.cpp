@@ -0,0 +1,66 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "densitytimeline.h"
+
+/*
+ * Each start and end of a subtitle changes the number of subtitles shown.
+ * The part of its own bucket after the change is added directly and the
+ * change of slope is added to the following buckets with a prefix sum, so
+ * the cost is linear in subtitles and buckets. Overlapping subtitles may
+ * sum over one, that is capped.
+ */
+QVector<float> DensityTimeline::compute(const CueTable &table,
+                                        const PlaybackCursor &cursor,
+                                        unsigned int length, int buckets)
+{
+    QVector<float> density(buckets, 0.0f);
+    QVector<double> partial(buckets + 1, 0.0);
+    QVector<int> slope(buckets + 1, 0);
+    double width;
+    int shown = 0;
+
+    if (table.isEmpty() || !length || buckets <= 0)
+        return density;
+
+    width = static_cast<double>(length) / buckets;
+
+    for (const Subtitle &subtitle : table.subtitles()) {
+        unsigned int times[2] = {
+            qMin(cursor.offsetTime(subtitle.start_time), length),
+            qMin(cursor.offsetTime(subtitle.end_time), length)
+        };
+        int deltas[2] = { 1, -1 };
+
+        for (int i = 0; i < 2; i++) {
+            int bucket = qMin(static_cast<int>(times[i] / width), buckets - 1);
+
+            partial[bucket] += deltas[i] * ((bucket + 1) * width - times[i]);
+            slope[bucket + 1] += deltas[i];
+        }
+    }
+
+    for (int bucket = 0; bucket < buckets; bucket++) {
+        shown += slope.at(bucket);
+        density[bucket] = static_cast<float>(
+                    qBound(0.0, (partial.at(bucket) + shown * width) / width, 1.0));
+    }
+
+    return density;
+}
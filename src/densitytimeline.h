@@ -0,0 +1,43 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DENSITYTIMELINE_H
+#define DENSITYTIMELINE_H
+
+#include <QVector>
+#include "cuetable.h"
+#include "playbackcursor.h"
+
+// Resolution of the timeline drawn behind the time slider
+#define DENSITY_BUCKETS 512
+
+/*
+ * Share of each bucket of the playback time covered by subtitles, from 0.0
+ * to 1.0. Computed once per table or offset change so that drawing it needs
+ * no work per frame.
+ */
+class DensityTimeline
+{
+public:
+    static QVector<float> compute(const CueTable &table,
+                                  const PlaybackCursor &cursor,
+                                  unsigned int length, int buckets);
+};
+
+#endif // DENSITYTIMELINE_H
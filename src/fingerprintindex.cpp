@@ -0,0 +1,335 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fingerprintindex.h"
+
+#include <errno.h>
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+#define FINGERPRINT_INDEX_FILE "fingerprints.json"
+#define FINGERPRINT_INDEX_VERSION 1
+
+// Share of common hashes for the same file
+#define FINGERPRINT_MATCH 0.5
+
+#define FNV_OFFSET Q_UINT64_C(0xcbf29ce484222325)
+#define FNV_PRIME Q_UINT64_C(0x100000001b3)
+#define ROLLING_BASE Q_UINT64_C(0x9e3779b97f4a7c15)
+
+FingerprintIndex::FingerprintIndex() :
+    iLoaded(false)
+{
+}
+
+// Final mixer of splitmix64, rolling hashes are not uniform by themselves
+quint64 FingerprintIndex::mix(quint64 value)
+{
+    value ^= value >> 30;
+    value *= Q_UINT64_C(0xbf58476d1ce4e5b9);
+    value ^= value >> 27;
+    value *= Q_UINT64_C(0x94d049bb133111eb);
+    value ^= value >> 31;
+
+    return value;
+}
+
+/*
+ * FNV-1a of the case folded letters and digits, markup, punctuation and
+ * white space are left out as they differ between releases.
+ */
+quint64 FingerprintIndex::textHash(const QString &text)
+{
+    quint64 hash = FNV_OFFSET;
+    bool tag = false;
+
+    for (const QChar &c : text) {
+        ushort unicode;
+
+        if (c == QLatin1Char('<')) {
+            tag = true;
+            continue;
+        } else if (c == QLatin1Char('>')) {
+            tag = false;
+            continue;
+        }
+
+        if (tag || !c.isLetterOrNumber())
+            continue;
+
+        unicode = c.toCaseFolded().unicode();
+        hash = (hash ^ (unicode & 0xff)) * FNV_PRIME;
+        hash = (hash ^ (unicode >> 8)) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+Fingerprint FingerprintIndex::compute(const CueTable &table)
+{
+    Fingerprint hashes;
+    quint64 power = 1;
+    quint64 rolling = 0;
+    QVector<quint64> window(FINGERPRINT_WINDOW, 0);
+    unsigned int previousStart = 0;
+
+    for (int i = 1; i < FINGERPRINT_WINDOW; i++)
+        power *= ROLLING_BASE;
+
+    hashes.reserve(table.size());
+
+    for (int i = 0; i < table.size(); i++) {
+        const Subtitle &subtitle = table.at(i);
+        unsigned int gap = (subtitle.start_time - previousStart +
+                            FINGERPRINT_GAP_QUANTUM / 2) / FINGERPRINT_GAP_QUANTUM;
+        quint64 cue = mix(textHash(subtitle.text) ^ (gap * FNV_PRIME));
+        quint64 &oldest = window[i % FINGERPRINT_WINDOW];
+
+        previousStart = subtitle.start_time;
+
+        // Drop the cue leaving the window and add the new one
+        rolling = (rolling - oldest * power) * ROLLING_BASE + cue;
+        oldest = cue;
+
+        if (i + 1 >= FINGERPRINT_WINDOW)
+            hashes.append(mix(rolling));
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    return hashes.mid(0, FINGERPRINT_SIZE);
+}
+
+QString FingerprintIndex::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+            QLatin1String("/" FINGERPRINT_INDEX_FILE);
+}
+
+void FingerprintIndex::buildLookup()
+{
+    iLookup.clear();
+
+    for (int i = 0; i < iEntries.size(); i++) {
+        for (quint64 hash : iEntries.at(i).fingerprint)
+            iLookup[hash].append(i);
+    }
+}
+
+void FingerprintIndex::load()
+{
+    QFile file(indexPath());
+    QJsonDocument document;
+
+    iLoaded = true;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    document = QJsonDocument::fromJson(file.readAll());
+    if (document.object().value(QStringLiteral("version")).toInt() !=
+                FINGERPRINT_INDEX_VERSION) {
+        qWarning() << "ignoring fingerprint index of unknown version";
+        return;
+    }
+
+    for (const QJsonValue &value : document.object().value(QStringLiteral("entries")).toArray()) {
+        QJsonObject object = value.toObject();
+        Entry entry;
+
+        for (const QJsonValue &hash : object.value(QStringLiteral("fingerprint")).toArray())
+            entry.fingerprint.append(hash.toString().toULongLong(nullptr, 16));
+
+        entry.correction.offset = object.value(QStringLiteral("offset")).toInt();
+        entry.correction.scale = object.value(QStringLiteral("scale")).toDouble(1.0);
+        entry.correction.fps = object.value(QStringLiteral("fps")).toDouble(0.0);
+        entry.name = object.value(QStringLiteral("name")).toString();
+
+        if (!entry.fingerprint.isEmpty())
+            iEntries.append(entry);
+    }
+
+    buildLookup();
+
+    qDebug() << "read" << iEntries.size() << "sync corrections";
+}
+
+int FingerprintIndex::save()
+{
+    QSaveFile file(indexPath());
+    QJsonArray entries;
+    QJsonObject root;
+
+    if (!QDir().mkpath(QFileInfo(file.fileName()).path()))
+        return -EACCES;
+
+    for (const Entry &entry : iEntries) {
+        QJsonObject object;
+        QJsonArray fingerprint;
+
+        // 64 bit values do not fit JSON numbers
+        for (quint64 hash : entry.fingerprint)
+            fingerprint.append(QString::number(hash, 16));
+
+        object.insert(QStringLiteral("fingerprint"), fingerprint);
+        object.insert(QStringLiteral("offset"), entry.correction.offset);
+        object.insert(QStringLiteral("scale"), entry.correction.scale);
+        object.insert(QStringLiteral("fps"), entry.correction.fps);
+        object.insert(QStringLiteral("name"), entry.name);
+        entries.append(object);
+    }
+
+    root.insert(QStringLiteral("version"), FINGERPRINT_INDEX_VERSION);
+    root.insert(QStringLiteral("entries"), entries);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return -EACCES;
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+
+    return file.commit() ? 0 : -EIO;
+}
+
+/*
+ * Entry sharing most hashes with the fingerprint, -1 when none shares
+ * enough. Only the entries having some of the hashes are counted.
+ */
+int FingerprintIndex::findEntry(const Fingerprint &fingerprint)
+{
+    QHash<int, int> common;
+    int best = -1;
+    int bestCommon = 0;
+
+    for (quint64 hash : fingerprint) {
+        for (int entry : iLookup.value(hash))
+            common[entry]++;
+    }
+
+    for (QHash<int, int>::const_iterator i = common.constBegin();
+                i != common.constEnd(); ++i) {
+        if (i.value() > bestCommon) {
+            best = i.key();
+            bestCommon = i.value();
+        }
+    }
+
+    if (best < 0)
+        return -1;
+
+    // Jaccard index of the two sets of hashes
+    if (static_cast<double>(bestCommon) / (fingerprint.size() +
+                iEntries.at(best).fingerprint.size() - bestCommon) < FINGERPRINT_MATCH)
+        return -1;
+
+    return best;
+}
+
+bool FingerprintIndex::lookup(const Fingerprint &fingerprint,
+                              SyncCorrection &correction)
+{
+    int entry;
+
+    if (fingerprint.isEmpty())
+        return false;
+
+    if (!iLoaded)
+        load();
+
+    entry = findEntry(fingerprint);
+    if (entry < 0)
+        return false;
+
+    correction = iEntries.at(entry).correction;
+    qDebug() << "known sync correction of" << iEntries.at(entry).name;
+
+    return true;
+}
+
+qint64 FingerprintIndex::memoryCost()
+{
+    qint64 cost = iEntries.capacity() * sizeof(Entry);
+
+    for (const Entry &entry : iEntries) {
+        cost += entry.fingerprint.capacity() * sizeof(quint64) +
+                entry.name.capacity() * sizeof(QChar);
+        // Lookup node and the entry number of each hash
+        cost += entry.fingerprint.size() * (sizeof(quint64) +
+                sizeof(QVector<int>) + sizeof(int));
+    }
+
+    return cost;
+}
+
+// Everything is read back from the file on the next use
+qint64 FingerprintIndex::releaseMemory(qint64 bytes)
+{
+    qint64 cost;
+
+    Q_UNUSED(bytes);
+
+    if (!iLoaded)
+        return 0;
+
+    cost = memoryCost();
+    iEntries = QVector<Entry>();
+    iLookup = QHash<quint64, QVector<int> >();
+    iLoaded = false;
+
+    return cost;
+}
+
+// Store the correction, replacing the one of a matching file
+int FingerprintIndex::remember(const Fingerprint &fingerprint,
+                               const QString &name,
+                               const SyncCorrection &correction)
+{
+    Entry entry;
+    int existing;
+
+    if (fingerprint.isEmpty())
+        return -EINVAL;
+
+    if (!iLoaded)
+        load();
+
+    entry.fingerprint = fingerprint;
+    entry.correction = correction;
+    entry.name = name;
+
+    existing = findEntry(fingerprint);
+    if (existing >= 0)
+        iEntries.remove(existing);
+
+    iEntries.append(entry);
+    if (iEntries.size() > FINGERPRINT_MAX_ENTRIES)
+        iEntries.remove(0, iEntries.size() - FINGERPRINT_MAX_ENTRIES);
+
+    buildLookup();
+
+    return save();
+}
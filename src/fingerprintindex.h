@@ -0,0 +1,93 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FINGERPRINTINDEX_H
+#define FINGERPRINTINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "cuetable.h"
+#include "memorybudget.h"
+
+// Cues hashed together, each window is one feature of the fingerprint
+#define FINGERPRINT_WINDOW 4
+// Smallest window hashes kept as the fingerprint
+#define FINGERPRINT_SIZE 64
+// Gaps between cue starts are compared at this resolution in milliseconds
+#define FINGERPRINT_GAP_QUANTUM 100
+// Oldest corrections are dropped after this many
+#define FINGERPRINT_MAX_ENTRIES 1000
+
+typedef QVector<quint64> Fingerprint;
+
+typedef struct _SyncCorrection {
+    int offset;   // In milliseconds, applied after the scale
+    double scale; // Multiplier of the subtitle times
+    double fps;   // Frame rate the correction was made at, 0.0 if not frame based
+} SyncCorrection;
+
+/*
+ * Local index of sync corrections confirmed by the user, keyed by the
+ * fingerprint of the subtitle file. The fingerprint is a bottom-k sketch of
+ * rolling hashes over windows of cues, each cue hashed from its normalized
+ * text and the gap from the previous one. Re-encoded files give the same
+ * fingerprint and small edits change only a few of its hashes, so files
+ * are matched by the share of common hashes.
+ *
+ * The index is a JSON file in the application data location, read on the
+ * first lookup and again after the memory has been released.
+ */
+class FingerprintIndex : public MemoryConsumer
+{
+public:
+    FingerprintIndex();
+
+    static Fingerprint compute(const CueTable &table);
+
+    bool lookup(const Fingerprint &fingerprint, SyncCorrection &correction);
+    int remember(const Fingerprint &fingerprint, const QString &name,
+                 const SyncCorrection &correction);
+
+    qint64 memoryCost();
+    qint64 releaseMemory(qint64 bytes);
+
+private:
+    typedef struct _Entry {
+        Fingerprint fingerprint;
+        SyncCorrection correction;
+        QString name;
+    } Entry;
+
+    static quint64 textHash(const QString &text);
+    static quint64 mix(quint64 value);
+    static QString indexPath();
+
+    int findEntry(const Fingerprint &fingerprint);
+    void buildLookup();
+    void load();
+    int save();
+
+    QVector<Entry> iEntries;
+    // Entries having each hash
+    QHash<quint64, QVector<int> > iLookup;
+    bool iLoaded;
+};
+
+#endif // FINGERPRINTINDEX_H
@@ -0,0 +1,171 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fpsestimator.h"
+
+#include <math.h>
+#include <QtDebug>
+
+typedef struct _FpsCandidate {
+    double fps;
+    double prior; // Share of frame based subtitles made for the rate
+} FpsCandidate;
+
+static const FpsCandidate fpsCandidates[] = {
+    { 23.976, 0.35 },
+    { 24.0, 0.10 },
+    { 25.0, 0.30 },
+    { 29.97, 0.15 },
+    { 30.0, 0.04 },
+    { 50.0, 0.03 },
+    { 59.94, 0.03 }
+};
+
+// Log-normal models of cue duration and reading speed of typical subtitles
+#define FPS_DURATION_MEDIAN 2.5  // Seconds
+#define FPS_DURATION_SIGMA 0.4
+#define FPS_SPEED_MEDIAN 14.0    // Characters per second
+#define FPS_SPEED_SIGMA 0.35
+
+// Time between the last subtitle and the end of the video, e.g. credits
+#define FPS_TAIL_MEAN 120000.0   // Milliseconds
+#define FPS_TAIL_TOLERANCE 5000  // Milliseconds the last one may run over
+
+// Score difference needed to use the estimate without asking
+#define FPS_CERTAIN_MARGIN 0.5
+
+// Characters shown, markup is not read
+int FpsEstimator::textLength(const QString &text)
+{
+    bool tag = false;
+    int length = 0;
+
+    for (const QChar &c : text) {
+        if (c == QLatin1Char('<'))
+            tag = true;
+        else if (c == QLatin1Char('>'))
+            tag = false;
+        else if (!tag && !c.isSpace())
+            length++;
+    }
+
+    return length;
+}
+
+/*
+ * Only sums of the logarithms of frame counts are collected in one pass, as
+ * for rate f the log of a duration in seconds is log(frames) - log(f) and the
+ * log of the speed is log(chars / frames) + log(f). Each candidate is then
+ * scored from the sums without going over the cues again. The average log
+ * likelihood per cue is used so that a long file doesn't make the typical
+ * ranges override the video length and the prior.
+ */
+FpsEstimate FpsEstimator::estimate(const SubtitleList &subtitles,
+                                   qint64 videoLength)
+{
+    FpsEstimate estimate;
+    double best = -INFINITY;
+    double second = -INFINITY;
+    double sumDuration = 0.0;
+    double sumDuration2 = 0.0;
+    double sumSpeed = 0.0;
+    double sumSpeed2 = 0.0;
+    unsigned int lastFrame = 0;
+    int count = 0;
+    int speedCount = 0;
+
+    estimate.fps = 0.0;
+    estimate.margin = 0.0;
+    estimate.certain = false;
+
+    for (const Subtitle &subtitle : subtitles) {
+        double frames;
+        int length;
+
+        if (subtitle.end_frame <= subtitle.start_frame)
+            continue;
+
+        frames = log(static_cast<double>(subtitle.end_frame - subtitle.start_frame));
+        sumDuration += frames;
+        sumDuration2 += frames * frames;
+        count++;
+
+        length = textLength(subtitle.text);
+        if (length) {
+            double speed = log(static_cast<double>(length)) - frames;
+
+            sumSpeed += speed;
+            sumSpeed2 += speed * speed;
+            speedCount++;
+        }
+
+        lastFrame = qMax(lastFrame, subtitle.end_frame);
+    }
+
+    if (!count)
+        return estimate;
+
+    for (const FpsCandidate &candidate : fpsCandidates) {
+        double shift = log(candidate.fps);
+        // Prior is weighed down to mostly break near ties
+        double score = 0.5 * log(candidate.prior);
+        double mean;
+
+        // Mean of (x - m)^2 is E[x^2] - 2 m E[x] + m^2
+        mean = log(FPS_DURATION_MEDIAN) + shift;
+        score -= (sumDuration2 / count - 2.0 * mean * sumDuration / count +
+                  mean * mean) / (2.0 * FPS_DURATION_SIGMA * FPS_DURATION_SIGMA);
+
+        if (speedCount) {
+            mean = log(FPS_SPEED_MEDIAN) - shift;
+            score -= (sumSpeed2 / speedCount - 2.0 * mean * sumSpeed / speedCount +
+                      mean * mean) / (2.0 * FPS_SPEED_SIGMA * FPS_SPEED_SIGMA);
+        }
+
+        if (videoLength > 0) {
+            qint64 end = static_cast<qint64>(lastFrame / candidate.fps * 1000.0);
+
+            if (end > videoLength + FPS_TAIL_TOLERANCE)
+                score = -INFINITY;
+            else
+                score -= qMax<qint64>(videoLength - end, 0) / FPS_TAIL_MEAN;
+        }
+
+        qDebug() << "FPS" << candidate.fps << "score" << score;
+
+        if (score > best) {
+            second = best;
+            best = score;
+            estimate.fps = candidate.fps;
+        } else if (score > second) {
+            second = score;
+        }
+    }
+
+    if (best == -INFINITY)
+        estimate.fps = 0.0;
+    else
+        estimate.margin = second == -INFINITY ? INFINITY : best - second;
+
+    // Typical ranges alone can't tell the rates close to each other apart
+    estimate.certain = estimate.fps > 0.0 && videoLength > 0 &&
+            estimate.margin >= FPS_CERTAIN_MARGIN;
+
+    return estimate;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FPSESTIMATOR_H
+#define FPSESTIMATOR_H
+
+#include "types.h"
+
+typedef struct _FpsEstimate {
+    double fps;       // Best candidate, 0.0 when nothing to estimate from
+    double margin;    // Score difference to the second best candidate
+    bool certain;     // Safe to use without asking the user
+} FpsEstimate;
+
+/*
+ * Guesses the frame rate of frame based subtitles without a FPS header.
+ * Durations and reading speeds of the cues are scored against typical
+ * ranges for each standard rate, which separates e.g. 25 from 50 fps well.
+ * Rates close to each other are told apart by the video length when known,
+ * as the last subtitle must end before the video does, and otherwise by
+ * how common they are.
+ */
+class FpsEstimator
+{
+public:
+    static FpsEstimate estimate(const SubtitleList &subtitles,
+                                qint64 videoLength);
+
+private:
+    static int textLength(const QString &text);
+};
+
+#endif // FPSESTIMATOR_H
@@ -0,0 +1,181 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "inflatedevice.h"
+
+#include <climits>
+#include <cstring>
+#include <QtDebug>
+
+// Compressed bytes read from the source at a time
+#define INFLATE_INPUT_SIZE 16384
+
+InflateDevice::InflateDevice(QIODevice *source, Format format, qint64 length,
+                             QObject *parent) :
+    QIODevice(parent),
+    iSource(source),
+    iFormat(format),
+    iRemaining(length),
+    iInflating(false),
+    iEnd(false)
+{
+    memset(&iStream, 0, sizeof(iStream));
+}
+
+InflateDevice::~InflateDevice()
+{
+    close();
+}
+
+bool InflateDevice::open(OpenMode mode)
+{
+    int windowBits;
+
+    if ((mode & ReadWrite) != ReadOnly || !iSource || !iSource->isReadable())
+        return false;
+
+    if (iFormat != FORMAT_STORED) {
+        // 16 adds gzip header handling, negative is raw deflate of zip
+        windowBits = iFormat == FORMAT_GZIP ? 16 + MAX_WBITS : -MAX_WBITS;
+
+        if (inflateInit2(&iStream, windowBits) != Z_OK) {
+            qWarning() << "cannot initialize inflate" << iStream.msg;
+            return false;
+        }
+
+        iInflating = true;
+    }
+
+    iEnd = false;
+
+    return QIODevice::open(mode);
+}
+
+void InflateDevice::close()
+{
+    if (iInflating) {
+        inflateEnd(&iStream);
+        iInflating = false;
+    }
+
+    iInput.clear();
+
+    if (isOpen())
+        QIODevice::close();
+}
+
+bool InflateDevice::atEnd() const
+{
+    return iEnd && QIODevice::bytesAvailable() == 0;
+}
+
+bool InflateDevice::fill()
+{
+    qint64 size = INFLATE_INPUT_SIZE;
+
+    if (iRemaining >= 0 && iRemaining < size)
+        size = iRemaining;
+
+    if (!size)
+        return false;
+
+    iInput = iSource->read(size);
+    if (iInput.isEmpty())
+        return false;
+
+    if (iRemaining > 0)
+        iRemaining -= iInput.size();
+
+    iStream.next_in = reinterpret_cast<Bytef*>(iInput.data());
+    iStream.avail_in = static_cast<uInt>(iInput.size());
+
+    return true;
+}
+
+qint64 InflateDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 size;
+    int ret;
+
+    if (iEnd)
+        return -1;
+
+    if (iFormat == FORMAT_STORED) {
+        if (iRemaining >= 0 && maxSize > iRemaining)
+            maxSize = iRemaining;
+
+        size = maxSize ? iSource->read(data, maxSize) : 0;
+        if (size <= 0) {
+            iEnd = true;
+            return -1;
+        }
+
+        if (iRemaining > 0)
+            iRemaining -= size;
+
+        return size;
+    }
+
+    if (maxSize > UINT_MAX)
+        maxSize = UINT_MAX;
+
+    iStream.next_out = reinterpret_cast<Bytef*>(data);
+    iStream.avail_out = static_cast<uInt>(maxSize);
+
+    while (iStream.avail_out) {
+        if (!iStream.avail_in && !fill()) {
+            // Source ended before the end of the compressed stream
+            iEnd = true;
+            break;
+        }
+
+        ret = inflate(&iStream, Z_NO_FLUSH);
+
+        if (ret == Z_STREAM_END) {
+            // Gzip files can have several members one after another
+            if (iFormat == FORMAT_GZIP && (iStream.avail_in || fill())) {
+                inflateReset(&iStream);
+                continue;
+            }
+
+            iEnd = true;
+            break;
+        }
+
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            qWarning() << "inflate failed" << ret << iStream.msg;
+            setErrorString(QString::fromLatin1(iStream.msg ? iStream.msg :
+                                                             "inflate failed"));
+            iEnd = true;
+            break;
+        }
+    }
+
+    size = maxSize - iStream.avail_out;
+
+    return size || !iEnd ? size : -1;
+}
+
+qint64 InflateDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+
+    return -1;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INFLATEDEVICE_H
+#define INFLATEDEVICE_H
+
+#include <QIODevice>
+#include <zlib.h>
+
+/*
+ * Read only sequential device decompressing another device while it is read,
+ * only a small block of the compressed input is kept in memory. Gzip reads
+ * to the end of the source, entries of zip archives are bounded by their
+ * compressed length from the current position of the source.
+ */
+class InflateDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Format {
+        FORMAT_GZIP = 0,
+        FORMAT_RAW_DEFLATE,
+        FORMAT_STORED
+    };
+
+    // Source is not owned, length -1 reads to the end of it
+    InflateDevice(QIODevice *source, Format format, qint64 length = -1,
+                  QObject *parent = nullptr);
+    ~InflateDevice();
+
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const { return true; }
+    bool atEnd() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    bool fill();
+
+    QIODevice *iSource;
+    Format iFormat;
+    qint64 iRemaining;
+    QByteArray iInput;
+    z_stream iStream;
+    bool iInflating;
+    bool iEnd;
+};
+
+#endif // INFLATEDEVICE_H
@@ -0,0 +1,178 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "linereader.h"
+#include "singlebytedecoder.h"
+
+#include <QTextCodec>
+#include <QTextDecoder>
+
+LineReader::LineReader(QTextCodec *codec) :
+    iDecoder(nullptr),
+    iSingleByte(nullptr)
+{
+    reset(codec);
+}
+
+LineReader::~LineReader()
+{
+    delete iDecoder;
+}
+
+void LineReader::reset(QTextCodec *codec)
+{
+    if (!codec)
+        codec = QTextCodec::codecForLocale();
+
+    delete iDecoder;
+    iDecoder = nullptr;
+
+    iSingleByte = SingleByteDecoder::forMib(codec->mibEnum());
+    if (!iSingleByte)
+        iDecoder = codec->makeDecoder();
+
+    iBuffer.clear();
+    iBufferOffset = 0;
+    iLineOffset = 0;
+    iRead = 0;
+    iScanned = 0;
+    iFinished = false;
+    iLineNumber = 0;
+
+    switch (codec->mibEnum()) {
+    case 1013: // UTF-16BE
+        iUnitSize = 2;
+        iBigEndian = true;
+        break;
+    case 1014: // UTF-16LE
+    case 1015: // UTF-16
+        iUnitSize = 2;
+        iBigEndian = false;
+        break;
+    case 1018: // UTF-32BE
+        iUnitSize = 4;
+        iBigEndian = true;
+        break;
+    case 1017: // UTF-32
+    case 1019: // UTF-32LE
+        iUnitSize = 4;
+        iBigEndian = false;
+        break;
+    default:
+        iUnitSize = 1;
+        iBigEndian = false;
+        break;
+    }
+}
+
+void LineReader::feed(const QByteArray &bytes)
+{
+    // Only the partial line is kept from the previous chunks
+    if (iRead) {
+        iBuffer.remove(0, iRead);
+        iBufferOffset += iRead;
+        iScanned -= iRead;
+        iRead = 0;
+    }
+
+    iBuffer.append(bytes);
+}
+
+void LineReader::finish()
+{
+    iFinished = true;
+}
+
+bool LineReader::isFinished()
+{
+    return iFinished && iRead >= iBuffer.size();
+}
+
+/*
+ * Position after the next newline code unit starting from an unit boundary,
+ * -1 if the buffer has no complete line.
+ */
+int LineReader::findLineEnd(int from)
+{
+    const char *data = iBuffer.constData();
+    int size = iBuffer.size();
+    int newline = iBigEndian ? iUnitSize - 1 : 0;
+
+    if (iUnitSize == 1) {
+        int pos = iBuffer.indexOf('\n', from);
+        return pos < 0 ? -1 : pos + 1;
+    }
+
+    for (int pos = from; pos + iUnitSize <= size; pos += iUnitSize) {
+        bool found = true;
+
+        for (int i = 0; i < iUnitSize && found; i++)
+            found = data[pos + i] == (i == newline ? '\n' : '\0');
+
+        if (found)
+            return pos + iUnitSize;
+    }
+
+    return -1;
+}
+
+bool LineReader::readLine(QString &line)
+{
+    int end = findLineEnd(iScanned);
+
+    if (end < 0 && iBuffer.size() - iRead >= LINEREADER_MAX_LINE_LENGTH)
+        end = iRead + LINEREADER_MAX_LINE_LENGTH / iUnitSize * iUnitSize;
+
+    if (end < 0) {
+        if (!iFinished || iRead >= iBuffer.size()) {
+            // Continue from the last complete unit when more is fed
+            iScanned = iRead + (iBuffer.size() - iRead) / iUnitSize * iUnitSize;
+            return false;
+        }
+
+        end = iBuffer.size();
+    }
+
+    if (iSingleByte)
+        iSingleByte->toUnicode(iBuffer.constData() + iRead, end - iRead, line);
+    else
+        line = iDecoder->toUnicode(iBuffer.constData() + iRead, end - iRead);
+
+    if (line.endsWith(QLatin1Char('\n')))
+        line.chop(1);
+    if (line.endsWith(QLatin1Char('\r')))
+        line.chop(1);
+
+    iLineOffset = iBufferOffset + iRead;
+    iLineNumber++;
+    iRead = end;
+    iScanned = end;
+
+    return true;
+}
+
+qint64 LineReader::lineOffset()
+{
+    return iLineOffset;
+}
+
+int LineReader::lineNumber()
+{
+    return iLineNumber;
+}
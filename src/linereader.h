@@ -0,0 +1,74 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+// Longer lines are split so a stream without newlines cannot grow the buffer
+#define LINEREADER_MAX_LINE_LENGTH 65536
+
+class QTextCodec;
+class QTextDecoder;
+class SingleByteDecoder;
+
+/*
+ * Splits bytes into decoded lines and keeps the byte offset and the number of
+ * each line. Bytes can be fed in chunks of any size, a line or a multibyte
+ * character split between chunks is completed by the next chunk. Newlines are
+ * searched in the raw bytes so UTF-16 and UTF-32 input is split on code unit
+ * boundaries. Common single byte codecs are decoded with built-in tables.
+ */
+class LineReader
+{
+public:
+    explicit LineReader(QTextCodec *codec = nullptr);
+    ~LineReader();
+
+    // Start over with the given codec, nullptr uses the locale codec
+    void reset(QTextCodec *codec);
+    void feed(const QByteArray &bytes);
+    // No more input, the last line does not need a newline
+    void finish();
+    bool isFinished();
+    bool readLine(QString &line);
+
+    // Of the line returned last
+    qint64 lineOffset();
+    int lineNumber();
+
+private:
+    int findLineEnd(int from);
+
+    QTextDecoder *iDecoder;
+    const SingleByteDecoder *iSingleByte;
+    QByteArray iBuffer;
+    qint64 iBufferOffset;
+    qint64 iLineOffset;
+    int iRead;
+    int iScanned;
+    int iUnitSize;
+    bool iBigEndian;
+    bool iFinished;
+    int iLineNumber;
+};
+
+#endif // LINEREADER_H
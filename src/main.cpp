@@ -33,20 +33,44 @@
 #include <QQmlContext>
 
 #include "subtitleengine.h"
+#include "transcriptmodel.h"
+#include "subtitlecatalogue.h"
+#include "densityimageprovider.h"
 
 int main(int argc, char *argv[])
 {
+    // Subtitles arriving from stdin ("-") or a local socket:
+    // --stream <source> [<format>]
+    QString streamSource;
+    QString streamFormat(QStringLiteral("srt"));
+
+    if (argc >= 3 && QString(argv[1]) == QStringLiteral("--stream")) {
+        streamSource = QString::fromLocal8Bit(argv[2]);
+        if (argc >= 4)
+            streamFormat = QString::fromLocal8Bit(argv[3]);
+    }
+
     QScopedPointer<QGuiApplication> app(SailfishApp::application(argc, argv));
     QScopedPointer<QQuickView> engine(SailfishApp::createView());
     int err;
 
     SubtitleEngine *subEngine = SubtitleEngine::initEngine();
+    TranscriptModel *transcriptModel = new TranscriptModel(subEngine);
+    SubtitleCatalogue *catalogue = new SubtitleCatalogue;
     engine->rootContext()->setContextProperty("SubtitleEngine", subEngine);
+    engine->rootContext()->setContextProperty("TranscriptModel", transcriptModel);
+    engine->rootContext()->setContextProperty("SubtitleCatalogue", catalogue);
+    engine->rootContext()->setContextProperty("StreamSource", streamSource);
+    engine->rootContext()->setContextProperty("StreamFormat", streamFormat);
+    engine->engine()->addImageProvider(QStringLiteral("density"),
+                                       new DensityImageProvider(subEngine));
     engine->setSource(SailfishApp::pathTo("qml/MainPage.qml"));
     engine->show();
 
     err = app->exec();
 
+    delete catalogue;
+    delete transcriptModel;
     delete subEngine;
 
     return err;
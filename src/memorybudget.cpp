@@ -0,0 +1,201 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memorybudget.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QtDebug>
+
+#define MCE_SERVICE "com.nokia.mce"
+#define MCE_SIGNAL_PATH "/com/nokia/mce/signal"
+#define MCE_SIGNAL_INTERFACE "com.nokia.mce.signal"
+#define MCE_REQUEST_PATH "/com/nokia/mce/request"
+#define MCE_REQUEST_INTERFACE "com.nokia.mce.request"
+
+MemoryBudget::MemoryBudget(QObject *parent) :
+    QObject(parent),
+    iBudget(0),
+    iResident(0),
+    iLevel(MEMORY_LEVEL_NORMAL)
+{
+    QDBusConnection bus = QDBusConnection::systemBus();
+    QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral(MCE_SERVICE),
+                                QStringLiteral(MCE_REQUEST_PATH),
+                                QStringLiteral(MCE_REQUEST_INTERFACE),
+                                QStringLiteral("get_memory_level"));
+    QDBusPendingCallWatcher *watcher;
+
+    bus.connect(QStringLiteral(MCE_SERVICE), QStringLiteral(MCE_SIGNAL_PATH),
+                QStringLiteral(MCE_SIGNAL_INTERFACE),
+                QStringLiteral("sig_memory_level_ind"), this,
+                SLOT(memoryLevelChanged(QString)));
+
+    watcher = new QDBusPendingCallWatcher(bus.asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &MemoryBudget::memoryLevelReceived);
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    QDBusConnection::systemBus().disconnect(QStringLiteral(MCE_SERVICE),
+                QStringLiteral(MCE_SIGNAL_PATH),
+                QStringLiteral(MCE_SIGNAL_INTERFACE),
+                QStringLiteral("sig_memory_level_ind"), this,
+                SLOT(memoryLevelChanged(QString)));
+}
+
+void MemoryConsumer::memoryGrown()
+{
+    if (iMemoryBudget)
+        iMemoryBudget->trim();
+}
+
+void MemoryBudget::addConsumer(MemoryConsumer *consumer, MemoryRank rank)
+{
+    Consumer entry;
+    int i = 0;
+
+    consumer->iMemoryBudget = this;
+    entry.consumer = consumer;
+    entry.rank = rank;
+
+    // Stable by rank, equal ranks are released in the order added
+    while (i < iConsumers.size() && iConsumers.at(i).rank <= rank)
+        i++;
+
+    iConsumers.insert(i, entry);
+}
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    iBudget = bytes > 0 ? bytes : 0;
+    trim();
+}
+
+void MemoryBudget::setResident(qint64 bytes)
+{
+    iResident = bytes;
+}
+
+qint64 MemoryBudget::used()
+{
+    qint64 total = iResident;
+
+    for (const Consumer &entry : iConsumers)
+        total += entry.consumer->memoryCost();
+
+    return total;
+}
+
+MemoryBudget::MemoryLevel MemoryBudget::level()
+{
+    return iLevel;
+}
+
+/*
+ * Bytes to stay within, -1 when there is no limit. Below normal level
+ * releasable data is first halved and then dropped entirely.
+ */
+qint64 MemoryBudget::target()
+{
+    qint64 half;
+
+    switch (iLevel) {
+    case MEMORY_LEVEL_CRITICAL:
+        return 0;
+    case MEMORY_LEVEL_WARNING:
+        half = iResident + (used() - iResident) / 2;
+        return iBudget ? qMin(iBudget, half) : half;
+    case MEMORY_LEVEL_NORMAL:
+        break;
+    }
+
+    return iBudget ? iBudget : -1;
+}
+
+void MemoryBudget::trim()
+{
+    qint64 limit = target();
+    qint64 total;
+    qint64 released = 0;
+
+    if (limit < 0)
+        return;
+
+    total = used();
+
+    // Data in use is left for the critical level
+    for (const Consumer &entry : iConsumers) {
+        if (total <= limit || entry.rank == MEMORY_RANK_ACTIVE)
+            break;
+
+        released += entry.consumer->releaseMemory(total - limit);
+        total = used();
+    }
+
+    if (released)
+        qDebug() << "released" << released << "bytes," << total << "in use";
+}
+
+void MemoryBudget::memoryLevelChanged(const QString &level)
+{
+    MemoryLevel newLevel;
+
+    if (level == QStringLiteral("critical"))
+        newLevel = MEMORY_LEVEL_CRITICAL;
+    else if (level == QStringLiteral("warning"))
+        newLevel = MEMORY_LEVEL_WARNING;
+    else
+        newLevel = MEMORY_LEVEL_NORMAL;
+
+    if (newLevel == iLevel)
+        return;
+
+    qDebug() << "memory level" << level;
+
+    iLevel = newLevel;
+    trim();
+
+    if (iLevel != MEMORY_LEVEL_CRITICAL)
+        return;
+
+    // Only once when turning critical, data used again stays until the next
+    for (const Consumer &entry : iConsumers) {
+        if (entry.rank == MEMORY_RANK_ACTIVE)
+            entry.consumer->releaseMemory(entry.consumer->memoryCost());
+    }
+}
+
+void MemoryBudget::memoryLevelReceived(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<QString> reply = *watcher;
+
+    watcher->deleteLater();
+
+    // Without mce only the budget is followed
+    if (reply.isError()) {
+        qDebug() << "memory level not available" << reply.error().message();
+        return;
+    }
+
+    memoryLevelChanged(reply.value());
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QVector>
+
+class QDBusPendingCallWatcher;
+class MemoryBudget;
+
+// Order of release, data that is cheaper to get back goes first
+enum MemoryRank {
+    MEMORY_RANK_SPECULATIVE = 0, // Parsed ahead of use
+    MEMORY_RANK_STORED,          // Read again from a file when needed
+    MEMORY_RANK_ACTIVE           // In use, released only at critical level
+};
+
+/*
+ * Holder of data that can be dropped and built again on demand.
+ */
+class MemoryConsumer
+{
+public:
+    MemoryConsumer() : iMemoryBudget(nullptr) {}
+    virtual ~MemoryConsumer() {}
+    // Bytes held by the releasable data
+    virtual qint64 memoryCost() = 0;
+    // Drop at least the given bytes if possible, returns bytes dropped
+    virtual qint64 releaseMemory(qint64 bytes) = 0;
+
+protected:
+    // To be called after adding data, keeps the budget it was added to
+    void memoryGrown();
+
+private:
+    friend class MemoryBudget;
+    MemoryBudget *iMemoryBudget;
+};
+
+/*
+ * Keeps the memory held by the engine within a budget. Resident data, the
+ * times of the cues in use, is accounted but never released. Consumers
+ * are asked to release in rank order when the budget is exceeded or the
+ * platform reports low memory, so that the application is not the one killed
+ * when it is in the background. Data in active use, the text of the cues, is
+ * released only when the level turns critical.
+ */
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+public:
+    enum MemoryLevel {
+        MEMORY_LEVEL_NORMAL = 0,
+        MEMORY_LEVEL_WARNING,
+        MEMORY_LEVEL_CRITICAL
+    };
+
+    explicit MemoryBudget(QObject *parent = nullptr);
+    ~MemoryBudget();
+
+    void addConsumer(MemoryConsumer *consumer, MemoryRank rank);
+    // Limit in bytes, 0 when only the memory level is followed
+    void setBudget(qint64 bytes);
+    void setResident(qint64 bytes);
+    qint64 used();
+    MemoryLevel level();
+    void trim();
+
+private slots:
+    void memoryLevelChanged(const QString &level);
+    void memoryLevelReceived(QDBusPendingCallWatcher *watcher);
+
+private:
+    typedef struct _Consumer {
+        MemoryConsumer *consumer;
+        MemoryRank rank;
+    } Consumer;
+
+    qint64 target();
+
+    QVector<Consumer> iConsumers;
+    qint64 iBudget;
+    qint64 iResident;
+    MemoryLevel iLevel;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,912 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mkvparser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+#include <QFileInfo>
+
+#define MKV_ID_EBML 0x1A45DFA3
+#define MKV_ID_SEGMENT 0x18538067
+#define MKV_ID_SEEKHEAD 0x114D9B74
+#define MKV_ID_SEEK 0x4DBB
+#define MKV_ID_SEEKID 0x53AB
+#define MKV_ID_SEEKPOSITION 0x53AC
+#define MKV_ID_INFO 0x1549A966
+#define MKV_ID_TIMESTAMPSCALE 0x2AD7B1
+#define MKV_ID_TRACKS 0x1654AE6B
+#define MKV_ID_TRACKENTRY 0xAE
+#define MKV_ID_TRACKNUMBER 0xD7
+#define MKV_ID_TRACKTYPE 0x83
+#define MKV_ID_CODECID 0x86
+#define MKV_ID_NAME 0x536E
+#define MKV_ID_LANGUAGE 0x22B59C
+#define MKV_ID_FLAGDEFAULT 0x88
+#define MKV_ID_DEFAULTDURATION 0x23E383
+#define MKV_ID_CONTENTENCODINGS 0x6D80
+#define MKV_ID_CONTENTENCODING 0x6240
+#define MKV_ID_CONTENTCOMPRESSION 0x5034
+#define MKV_ID_CONTENTCOMPALGO 0x4254
+#define MKV_ID_CONTENTCOMPSETTINGS 0x4255
+#define MKV_ID_CLUSTER 0x1F43B675
+#define MKV_ID_TIMESTAMP 0xE7
+#define MKV_ID_SIMPLEBLOCK 0xA3
+#define MKV_ID_BLOCKGROUP 0xA0
+#define MKV_ID_BLOCK 0xA1
+#define MKV_ID_BLOCKDURATION 0x9B
+#define MKV_ID_CUES 0x1C53BB6B
+#define MKV_ID_CUEPOINT 0xBB
+#define MKV_ID_CUETRACKPOSITIONS 0xB7
+#define MKV_ID_CUETRACK 0xF7
+#define MKV_ID_CUECLUSTERPOSITION 0xF1
+#define MKV_ID_CUERELATIVEPOSITION 0xF0
+
+#define MKV_TRACK_TYPE_SUBTITLE 0x11
+#define MKV_COMPRESSION_ZLIB 0
+#define MKV_COMPRESSION_HEADER_STRIPPING 3
+#define MKV_BLOCK_LACING 0x06
+
+// Header element is at most 4 bytes of id and 8 bytes of size
+#define MKV_ELEMENT_HEADER_MAX 12
+// Master elements read to memory, cues of long files are a few megabytes
+#define MKV_PAYLOAD_MAX (16 * 1024 * 1024)
+#define MKV_BLOCK_MAX (1024 * 1024)
+#define MKV_DEFAULT_TIMESTAMP_SCALE 1000000
+// Used when a block has no duration
+#define MKV_DEFAULT_DURATION 3000
+
+static int vintLength(uchar first)
+{
+    for (int i = 0; i < 8; i++) {
+        if (first & (0x80 >> i))
+            return i + 1;
+    }
+
+    return 0;
+}
+
+/*
+ * EBML variable length integer, the length marker is kept for ids. Unknown
+ * size is signaled with all value bits set.
+ */
+static int readVint(const uchar *data, qint64 available, bool id,
+                    quint64 &value, bool *unknown = nullptr)
+{
+    int length;
+    quint64 allOnes;
+
+    if (available < 1)
+        return 0;
+
+    length = vintLength(data[0]);
+    if (!length || length > available || (id && length > 4))
+        return 0;
+
+    value = id ? data[0] : data[0] & (0xFF >> length);
+    for (int i = 1; i < length; i++)
+        value = (value << 8) | data[i];
+
+    if (unknown) {
+        allOnes = (Q_UINT64_C(1) << (7 * length)) - 1;
+        *unknown = value == allOnes;
+    }
+
+    return length;
+}
+
+// Child element of a master element read to memory
+static bool nextElement(const QByteArray &data, qint64 &pos,
+                        MkvElement &element)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+    quint64 id;
+    quint64 size;
+    int idLength;
+    int sizeLength;
+
+    idLength = readVint(bytes + pos, data.size() - pos, true, id);
+    if (!idLength)
+        return false;
+
+    sizeLength = readVint(bytes + pos + idLength, data.size() - pos - idLength,
+                          false, size);
+    if (!sizeLength)
+        return false;
+
+    element.id = static_cast<quint32>(id);
+    element.dataStart = pos + idLength + sizeLength;
+
+    if (size > static_cast<quint64>(data.size() - element.dataStart))
+        return false;
+
+    element.size = static_cast<qint64>(size);
+    pos = element.dataStart + element.size;
+
+    return true;
+}
+
+static quint64 readUInt(const QByteArray &data, const MkvElement &element)
+{
+    quint64 value = 0;
+
+    for (qint64 i = 0; i < element.size && i < 8; i++)
+        value = (value << 8) | static_cast<uchar>(data.at(element.dataStart + i));
+
+    return value;
+}
+
+static QByteArray readBytes(const QByteArray &data, const MkvElement &element)
+{
+    return data.mid(static_cast<int>(element.dataStart),
+                    static_cast<int>(element.size));
+}
+
+static bool isTextCodec(const QString &codec)
+{
+    return codec == QStringLiteral("S_TEXT/UTF8") ||
+            codec == QStringLiteral("S_TEXT/ASS") ||
+            codec == QStringLiteral("S_TEXT/SSA") ||
+            codec == QStringLiteral("S_TEXT/WEBVTT") ||
+            codec == QStringLiteral("D_WEBVTT/SUBTITLES");
+}
+
+static bool lessThanPosition(const MkvCuePosition &a, const MkvCuePosition &b)
+{
+    return a.cluster < b.cluster ||
+            (a.cluster == b.cluster && a.relative < b.relative);
+}
+
+MkvParser::MkvParser() :
+    iAssOverride(QStringLiteral(R"(\{[^\}]*\})")),
+    iVttTag(QStringLiteral(R"(<(?!/?(?:i|b|u)>)[^>]*>)"))
+{
+    iSelectedTrack = -1;
+    initializeParser();
+}
+
+void MkvParser::initializeParser()
+{
+    iTracks.clear();
+    iTimestampScale = MKV_DEFAULT_TIMESTAMP_SCALE;
+    iSegmentStart = -1;
+    iSegmentEnd = -1;
+    iFirstCluster = -1;
+    iCues = -1;
+    iSeekInfo = -1;
+    iSeekTracks = -1;
+}
+
+/*
+ * Container is read only when seeking to the elements, reads are not
+ * buffered to avoid reading the skipped video and audio data.
+ */
+int MkvParser::openSubtitle(const QString &filePath)
+{
+    releaseFile();
+    iSubfile = new QFile(filePath);
+    if (!iSubfile->exists()) {
+        qDebug() << "file %s does not exist" << filePath;
+        return -ENOENT;
+    }
+
+    if (!iSubfile->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qDebug() << "Error opening file";
+        return -EACCES;
+    }
+
+    iInput = iSubfile;
+
+    if (!readHeaders()) {
+        qDebug() << "not a matroska file";
+        return -ENOTSUP;
+    }
+
+    qDebug() << iTracks.size() << "text tracks in" << filePath;
+
+    return 0;
+}
+
+bool MkvParser::readElement(qint64 pos, MkvElement &element)
+{
+    const uchar *bytes;
+    QByteArray header;
+    quint64 id;
+    quint64 size;
+    int idLength;
+    int sizeLength;
+    bool unknown;
+
+    if (!iInput->seek(pos))
+        return false;
+
+    header = iInput->read(MKV_ELEMENT_HEADER_MAX);
+    bytes = reinterpret_cast<const uchar*>(header.constData());
+
+    idLength = readVint(bytes, header.size(), true, id);
+    if (!idLength)
+        return false;
+
+    sizeLength = readVint(bytes + idLength, header.size() - idLength, false,
+                          size, &unknown);
+    if (!sizeLength)
+        return false;
+
+    element.id = static_cast<quint32>(id);
+    element.dataStart = pos + idLength + sizeLength;
+    element.size = unknown ? -1 : static_cast<qint64>(size);
+
+    return true;
+}
+
+QByteArray MkvParser::readPayload(const MkvElement &element, qint64 maxSize)
+{
+    if (element.size < 0 || element.size > maxSize) {
+        qDebug() << "skipping too large element" << hex << element.id;
+        return QByteArray();
+    }
+
+    if (!iInput->seek(element.dataStart))
+        return QByteArray();
+
+    return iInput->read(element.size);
+}
+
+/*
+ * Read the headers before the first cluster and the ones after the clusters
+ * pointed by the seek head, clusters are not read.
+ */
+bool MkvParser::readHeaders()
+{
+    MkvElement element;
+    qint64 pos;
+    bool info = false;
+    bool tracks = false;
+
+    if (!readElement(0, element) || element.id != MKV_ID_EBML ||
+            element.size < 0)
+        return false;
+
+    pos = element.dataStart + element.size;
+    if (!readElement(pos, element) || element.id != MKV_ID_SEGMENT)
+        return false;
+
+    iSegmentStart = element.dataStart;
+    iSegmentEnd = iInput->size();
+    if (element.size >= 0)
+        iSegmentEnd = qMin(iSegmentEnd, element.dataStart + element.size);
+
+    pos = iSegmentStart;
+    while (pos < iSegmentEnd && readElement(pos, element)) {
+        if (element.id == MKV_ID_CLUSTER) {
+            iFirstCluster = pos;
+            break;
+        }
+
+        switch (element.id) {
+        case MKV_ID_SEEKHEAD:
+            parseSeekHead(readPayload(element, MKV_PAYLOAD_MAX));
+            break;
+        case MKV_ID_INFO:
+            parseInfo(readPayload(element, MKV_PAYLOAD_MAX));
+            info = true;
+            break;
+        case MKV_ID_TRACKS:
+            parseTracks(readPayload(element, MKV_PAYLOAD_MAX));
+            tracks = true;
+            break;
+        case MKV_ID_CUES:
+            iCues = pos;
+            break;
+        default:
+            break;
+        }
+
+        if (element.size < 0)
+            break;
+
+        pos = element.dataStart + element.size;
+    }
+
+    if (!info && iSeekInfo >= 0 &&
+            readElement(iSegmentStart + iSeekInfo, element) &&
+            element.id == MKV_ID_INFO)
+        parseInfo(readPayload(element, MKV_PAYLOAD_MAX));
+
+    if (!tracks && iSeekTracks >= 0 &&
+            readElement(iSegmentStart + iSeekTracks, element) &&
+            element.id == MKV_ID_TRACKS) {
+        parseTracks(readPayload(element, MKV_PAYLOAD_MAX));
+        tracks = true;
+    }
+
+    return tracks;
+}
+
+void MkvParser::parseSeekHead(const QByteArray &data)
+{
+    MkvElement seek;
+    MkvElement child;
+    qint64 pos = 0;
+
+    while (nextElement(data, pos, seek)) {
+        qint64 childPos = seek.dataStart;
+        qint64 end = seek.dataStart + seek.size;
+        quint64 id = 0;
+        qint64 position = -1;
+
+        if (seek.id != MKV_ID_SEEK)
+            continue;
+
+        while (childPos < end && nextElement(data, childPos, child)) {
+            if (child.id == MKV_ID_SEEKID)
+                id = readUInt(data, child);
+            else if (child.id == MKV_ID_SEEKPOSITION)
+                position = static_cast<qint64>(readUInt(data, child));
+        }
+
+        switch (id) {
+        case MKV_ID_INFO:
+            iSeekInfo = position;
+            break;
+        case MKV_ID_TRACKS:
+            iSeekTracks = position;
+            break;
+        case MKV_ID_CUES:
+            if (iCues < 0 && position >= 0)
+                iCues = iSegmentStart + position;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void MkvParser::parseInfo(const QByteArray &data)
+{
+    MkvElement element;
+    qint64 pos = 0;
+
+    while (nextElement(data, pos, element)) {
+        if (element.id == MKV_ID_TIMESTAMPSCALE)
+            iTimestampScale = readUInt(data, element);
+    }
+
+    if (!iTimestampScale)
+        iTimestampScale = MKV_DEFAULT_TIMESTAMP_SCALE;
+}
+
+void MkvParser::parseTracks(const QByteArray &data)
+{
+    MkvElement element;
+    qint64 pos = 0;
+
+    while (nextElement(data, pos, element)) {
+        if (element.id == MKV_ID_TRACKENTRY)
+            parseTrackEntry(readBytes(data, element));
+    }
+}
+
+void MkvParser::parseTrackEntry(const QByteArray &data)
+{
+    MkvElement element;
+    MkvElement encoding;
+    MkvElement compression;
+    MkvElement setting;
+    MkvTrack entry;
+    quint64 type = 0;
+    qint64 pos = 0;
+
+    entry.track.number = 0;
+    entry.track.language = QStringLiteral("eng");
+    entry.track.isDefault = true;
+    entry.compression = -1;
+    entry.defaultDuration = 0;
+
+    while (nextElement(data, pos, element)) {
+        switch (element.id) {
+        case MKV_ID_TRACKNUMBER:
+            entry.track.number = static_cast<int>(readUInt(data, element));
+            break;
+        case MKV_ID_TRACKTYPE:
+            type = readUInt(data, element);
+            break;
+        case MKV_ID_CODECID:
+            entry.track.codec = QString::fromLatin1(readBytes(data, element));
+            break;
+        case MKV_ID_NAME:
+            entry.track.name = QString::fromUtf8(readBytes(data, element));
+            break;
+        case MKV_ID_LANGUAGE:
+            entry.track.language = QString::fromLatin1(readBytes(data, element));
+            break;
+        case MKV_ID_FLAGDEFAULT:
+            entry.track.isDefault = readUInt(data, element) != 0;
+            break;
+        case MKV_ID_DEFAULTDURATION:
+            entry.defaultDuration = readUInt(data, element);
+            break;
+        case MKV_ID_CONTENTENCODINGS: {
+            // Only the compression of the first encoding is supported
+            QByteArray encodings = readBytes(data, element);
+            qint64 encodingPos = 0;
+
+            if (!nextElement(encodings, encodingPos, encoding) ||
+                    encoding.id != MKV_ID_CONTENTENCODING)
+                break;
+
+            QByteArray encodingData = readBytes(encodings, encoding);
+            qint64 compressionPos = 0;
+
+            while (nextElement(encodingData, compressionPos, compression)) {
+                if (compression.id != MKV_ID_CONTENTCOMPRESSION)
+                    continue;
+
+                QByteArray settings = readBytes(encodingData, compression);
+                qint64 settingPos = 0;
+
+                // Algorithm defaults to zlib when not set
+                entry.compression = MKV_COMPRESSION_ZLIB;
+                while (nextElement(settings, settingPos, setting)) {
+                    if (setting.id == MKV_ID_CONTENTCOMPALGO)
+                        entry.compression = static_cast<int>(readUInt(settings, setting));
+                    else if (setting.id == MKV_ID_CONTENTCOMPSETTINGS)
+                        entry.strippedHeader = readBytes(settings, setting);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (type != MKV_TRACK_TYPE_SUBTITLE || !entry.track.number)
+        return;
+
+    if (!isTextCodec(entry.track.codec)) {
+        qDebug() << "skipping track" << entry.track.number << entry.track.codec;
+        return;
+    }
+
+    iTracks.append(entry);
+}
+
+SubTrackList MkvParser::getTracks()
+{
+    SubTrackList tracks;
+
+    for (const MkvTrack &entry : iTracks)
+        tracks.append(entry.track);
+
+    return tracks;
+}
+
+// Kept over initializeParser(), -1 selects the default track
+bool MkvParser::selectTrack(int number)
+{
+    bool found = number == -1;
+
+    for (const MkvTrack &entry : iTracks)
+        found = found || entry.track.number == number;
+
+    if (!found)
+        return false;
+
+    iSelectedTrack = number;
+    return true;
+}
+
+int MkvParser::getSelectedTrack()
+{
+    const MkvTrack *track = selectedTrack();
+
+    return track ? track->track.number : -1;
+}
+
+const MkvTrack *MkvParser::selectedTrack()
+{
+    const MkvTrack *fallback = nullptr;
+
+    for (const MkvTrack &entry : iTracks) {
+        if (entry.track.number == iSelectedTrack)
+            return &entry;
+
+        if (!fallback || (entry.track.isDefault && !fallback->track.isDefault))
+            fallback = &entry;
+    }
+
+    return fallback;
+}
+
+QVector<MkvCuePosition> MkvParser::readCues(int track)
+{
+    QVector<MkvCuePosition> positions;
+    MkvElement element;
+    MkvElement point;
+    MkvElement child;
+    QByteArray data;
+    qint64 pos = 0;
+
+    if (iCues < 0 || !readElement(iCues, element) || element.id != MKV_ID_CUES)
+        return positions;
+
+    data = readPayload(element, MKV_PAYLOAD_MAX);
+
+    while (nextElement(data, pos, point)) {
+        qint64 pointPos = point.dataStart;
+        qint64 pointEnd = point.dataStart + point.size;
+
+        if (point.id != MKV_ID_CUEPOINT)
+            continue;
+
+        while (pointPos < pointEnd && nextElement(data, pointPos, element)) {
+            qint64 childPos = element.dataStart;
+            qint64 childEnd = element.dataStart + element.size;
+            MkvCuePosition position;
+            int cueTrack = 0;
+
+            if (element.id != MKV_ID_CUETRACKPOSITIONS)
+                continue;
+
+            position.cluster = -1;
+            position.relative = -1;
+
+            while (childPos < childEnd && nextElement(data, childPos, child)) {
+                switch (child.id) {
+                case MKV_ID_CUETRACK:
+                    cueTrack = static_cast<int>(readUInt(data, child));
+                    break;
+                case MKV_ID_CUECLUSTERPOSITION:
+                    position.cluster = static_cast<qint64>(readUInt(data, child));
+                    break;
+                case MKV_ID_CUERELATIVEPOSITION:
+                    position.relative = static_cast<qint64>(readUInt(data, child));
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (cueTrack == track && position.cluster >= 0)
+                positions.append(position);
+        }
+    }
+
+    std::sort(positions.begin(), positions.end(), lessThanPosition);
+
+    return positions;
+}
+
+quint64 MkvParser::readClusterTimestamp(const MkvElement &cluster)
+{
+    MkvElement element;
+    QByteArray data;
+    qint64 pos = cluster.dataStart;
+
+    // Timestamp is the first child in practice
+    while (readElement(pos, element) && element.size >= 0 &&
+           element.size <= 8) {
+        if (element.id == MKV_ID_TIMESTAMP) {
+            data = readPayload(element, 8);
+            element.dataStart = 0;
+            return readUInt(data, element);
+        }
+
+        pos = element.dataStart + element.size;
+    }
+
+    return 0;
+}
+
+/*
+ * Blocks of the track in the cluster, other blocks are skipped after reading
+ * their track number. Returns the position after the cluster.
+ */
+qint64 MkvParser::walkCluster(const MkvElement &cluster, const MkvTrack &track,
+                              SubtitleList &subtitles, SubParseResult *result)
+{
+    MkvElement element;
+    MkvElement block;
+    QByteArray header;
+    quint64 clusterTime = 0;
+    quint64 number;
+    qint64 pos = cluster.dataStart;
+    qint64 end = cluster.size < 0 ? iSegmentEnd : cluster.dataStart + cluster.size;
+
+    while (pos < end && readElement(pos, element)) {
+        // Top level id ends a cluster of unknown size
+        if (element.id > 0xFFFFFF || element.size < 0)
+            break;
+
+        switch (element.id) {
+        case MKV_ID_TIMESTAMP:
+            header = readPayload(element, 8);
+            block.dataStart = 0;
+            block.size = header.size();
+            clusterTime = readUInt(header, block);
+            break;
+        case MKV_ID_SIMPLEBLOCK:
+            if (!iInput->seek(element.dataStart))
+                break;
+            header = iInput->read(8);
+            if (readVint(reinterpret_cast<const uchar*>(header.constData()),
+                         header.size(), false, number) &&
+                    static_cast<int>(number) == track.track.number)
+                readBlock(pos, clusterTime, track, subtitles, result);
+            break;
+        case MKV_ID_BLOCKGROUP:
+            // Block is the first child of the group in practice
+            if (readElement(element.dataStart, block) &&
+                    block.id == MKV_ID_BLOCK && iInput->seek(block.dataStart)) {
+                header = iInput->read(8);
+                if (readVint(reinterpret_cast<const uchar*>(header.constData()),
+                             header.size(), false, number) &&
+                        static_cast<int>(number) == track.track.number)
+                    readBlock(pos, clusterTime, track, subtitles, result);
+            }
+            break;
+        default:
+            break;
+        }
+
+        pos = element.dataStart + element.size;
+    }
+
+    return pos;
+}
+
+void MkvParser::readBlock(qint64 pos, quint64 clusterTime,
+                          const MkvTrack &track, SubtitleList &subtitles,
+                          SubParseResult *result)
+{
+    MkvElement element;
+    MkvElement child;
+    QByteArray data;
+    QByteArray block;
+    qint64 duration = -1;
+    qint64 childPos = 0;
+
+    if (!readElement(pos, element))
+        return;
+
+    data = readPayload(element, MKV_BLOCK_MAX);
+    if (data.isEmpty())
+        return;
+
+    if (element.id == MKV_ID_SIMPLEBLOCK) {
+        parseBlock(data, -1, clusterTime, track, subtitles, result);
+        return;
+    }
+
+    if (element.id != MKV_ID_BLOCKGROUP)
+        return;
+
+    while (nextElement(data, childPos, child)) {
+        if (child.id == MKV_ID_BLOCK)
+            block = readBytes(data, child);
+        else if (child.id == MKV_ID_BLOCKDURATION)
+            duration = static_cast<qint64>(readUInt(data, child));
+    }
+
+    if (!block.isEmpty())
+        parseBlock(block, duration, clusterTime, track, subtitles, result);
+}
+
+void MkvParser::parseBlock(const QByteArray &block, qint64 duration,
+                           quint64 clusterTime, const MkvTrack &track,
+                           SubtitleList &subtitles, SubParseResult *result)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(block.constData());
+    QByteArray payload;
+    quint64 number;
+    qint64 time;
+    qint64 start;
+    qint64 end;
+    int length;
+    qint16 relative;
+
+    length = readVint(bytes, block.size(), false, number);
+    if (!length || block.size() < length + 3 ||
+            static_cast<int>(number) != track.track.number)
+        return;
+
+    relative = static_cast<qint16>((bytes[length] << 8) | bytes[length + 1]);
+
+    // Text subtitles are not laced
+    if (bytes[length + 2] & MKV_BLOCK_LACING) {
+        result->skipped++;
+        return;
+    }
+
+    payload = block.mid(length + 3);
+    if (!decodeContent(track, payload)) {
+        recoverError(result, SUB_PARSE_ERROR_INVALID_FILE);
+        return;
+    }
+
+    time = static_cast<qint64>(clusterTime) + relative;
+    start = time * static_cast<qint64>(iTimestampScale) / 1000000;
+
+    if (duration >= 0)
+        end = (time + duration) * static_cast<qint64>(iTimestampScale) / 1000000;
+    else if (track.defaultDuration)
+        end = start + static_cast<qint64>(track.defaultDuration / 1000000);
+    else
+        end = start + MKV_DEFAULT_DURATION;
+
+    if (start < 0)
+        start = 0;
+    if (end < start)
+        end = start;
+
+    appendSubtitle(subtitles, result, subtitles.size() + 1,
+                   static_cast<unsigned int>(start),
+                   static_cast<unsigned int>(end), convertText(track, payload));
+}
+
+bool MkvParser::decodeContent(const MkvTrack &track, QByteArray &data)
+{
+    QByteArray inflated;
+    z_stream stream;
+    char buffer[4096];
+    int ret;
+
+    switch (track.compression) {
+    case -1:
+        return true;
+    case MKV_COMPRESSION_HEADER_STRIPPING:
+        data.prepend(track.strippedHeader);
+        return true;
+    case MKV_COMPRESSION_ZLIB:
+        break;
+    default:
+        return false;
+    }
+
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<Bytef*>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        inflated.append(buffer, static_cast<int>(sizeof(buffer) - stream.avail_out));
+    } while (ret == Z_OK && inflated.size() < MKV_BLOCK_MAX);
+
+    inflateEnd(&stream);
+
+    if (ret != Z_STREAM_END)
+        return false;
+
+    data = inflated;
+    return true;
+}
+
+QString MkvParser::convertText(const MkvTrack &track, const QByteArray &data)
+{
+    QString text = QString::fromUtf8(data).trimmed();
+    int pos = 0;
+
+    if (track.track.codec == QStringLiteral("S_TEXT/ASS") ||
+            track.track.codec == QStringLiteral("S_TEXT/SSA")) {
+        // ReadOrder, Layer, Style, Name, MarginL, MarginR, MarginV, Effect, Text
+        for (int i = 0; i < 8 && pos >= 0; i++) {
+            pos = text.indexOf(QLatin1Char(','), pos);
+            if (pos >= 0)
+                pos++;
+        }
+
+        if (pos > 0)
+            text = text.mid(pos);
+
+        text.replace(QStringLiteral("{\\i1}"), QStringLiteral("<i>"));
+        text.replace(QStringLiteral("{\\i0}"), QStringLiteral("</i>"));
+        text.replace(QStringLiteral("{\\b1}"), QStringLiteral("<b>"));
+        text.replace(QStringLiteral("{\\b0}"), QStringLiteral("</b>"));
+        text.replace(QStringLiteral("{\\u1}"), QStringLiteral("<u>"));
+        text.replace(QStringLiteral("{\\u0}"), QStringLiteral("</u>"));
+        text.remove(iAssOverride);
+        text.replace(QStringLiteral("\\N"), QStringLiteral("<br>"));
+        text.replace(QStringLiteral("\\n"), QStringLiteral("<br>"));
+        text.replace(QStringLiteral("\\h"), QStringLiteral(" "));
+    } else if (track.track.codec != QStringLiteral("S_TEXT/UTF8")) {
+        // WebVTT voice and class tags
+        text.remove(iVttTag);
+    }
+
+    text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    text.replace(QLatin1Char('\n'), QStringLiteral("<br>"));
+
+    return text;
+}
+
+void MkvParser::parseSubtitles(SubtitleList &subtitles, SubParseResult *result)
+{
+    const MkvTrack *track = selectedTrack();
+    QVector<MkvCuePosition> positions;
+    MkvElement cluster;
+    MkvCuePosition previous;
+    qint64 walked = -1;
+    qint64 pos;
+
+    if (!track) {
+        qDebug() << "no text subtitle tracks";
+        setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+        return;
+    }
+
+    qDebug() << "reading track" << track->track.number << track->track.codec <<
+                track->track.language;
+
+    positions = readCues(track->track.number);
+
+    if (!positions.isEmpty()) {
+        previous.cluster = -1;
+        previous.relative = -1;
+
+        for (const MkvCuePosition &position : positions) {
+            // Same block can be listed by several cue points
+            if (position.cluster == previous.cluster &&
+                    position.relative == previous.relative)
+                continue;
+
+            previous = position;
+
+            if (!readElement(iSegmentStart + position.cluster, cluster) ||
+                    cluster.id != MKV_ID_CLUSTER) {
+                recoverError(result, SUB_PARSE_ERROR_INVALID_FILE);
+                continue;
+            }
+
+            if (position.relative >= 0) {
+                readBlock(cluster.dataStart + position.relative,
+                          readClusterTimestamp(cluster), *track, subtitles,
+                          result);
+            } else if (position.cluster != walked) {
+                walkCluster(cluster, *track, subtitles, result);
+                walked = position.cluster;
+            }
+        }
+
+        return;
+    }
+
+    // No cues for the track, all clusters are walked
+    pos = iFirstCluster;
+    while (pos >= 0 && pos < iSegmentEnd && readElement(pos, cluster)) {
+        if (cluster.id == MKV_ID_CLUSTER)
+            pos = walkCluster(cluster, *track, subtitles, result);
+        else if (cluster.size >= 0)
+            pos = cluster.dataStart + cluster.size;
+        else
+            break;
+    }
+}
+
+void MkvParser::updateFPS(SubtitleList &subtitles)
+{
+    Q_UNUSED(subtitles);
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MKVPARSER_H
+#define MKVPARSER_H
+
+#include "parser.h"
+#include "parserplugin.h"
+
+#include <QRegularExpression>
+
+typedef struct _MkvElement {
+    quint32 id;
+    qint64 dataStart;
+    qint64 size; // -1 when unknown
+} MkvElement;
+
+typedef struct _MkvTrack {
+    SubTrack track;
+    int compression;         // ContentCompAlgo, -1 when not compressed
+    QByteArray strippedHeader;
+    quint64 defaultDuration; // In nanoseconds, 0 when not set
+} MkvTrack;
+
+typedef struct _MkvCuePosition {
+    qint64 cluster;  // From the segment data start
+    qint64 relative; // From the cluster data start, -1 when not set
+} MkvCuePosition;
+
+/*
+ * Text subtitle tracks of Matroska files. Only the headers are read when the
+ * file is opened. Blocks of the selected track are read through the cues
+ * when the file has them for the track, otherwise clusters are walked by
+ * reading only the element headers and the track numbers of the blocks.
+ */
+class MkvParser : public Parser
+{
+public:
+    MkvParser();
+
+    // Parser interface
+public:
+    int openSubtitle(const QString &filePath);
+    void parseSubtitles(SubtitleList &subtitles, SubParseResult *result);
+    void updateFPS(SubtitleList &subtitles);
+    bool needFPSUpdate() { return false; };
+    void initializeParser();
+    SubTrackList getTracks();
+    bool selectTrack(int number);
+    int getSelectedTrack();
+
+private:
+    bool readElement(qint64 pos, MkvElement &element);
+    QByteArray readPayload(const MkvElement &element, qint64 maxSize);
+    bool readHeaders();
+    void parseSeekHead(const QByteArray &data);
+    void parseInfo(const QByteArray &data);
+    void parseTracks(const QByteArray &data);
+    void parseTrackEntry(const QByteArray &data);
+    QVector<MkvCuePosition> readCues(int track);
+    qint64 walkCluster(const MkvElement &cluster, const MkvTrack &track,
+                       SubtitleList &subtitles, SubParseResult *result);
+    quint64 readClusterTimestamp(const MkvElement &cluster);
+    void readBlock(qint64 pos, quint64 clusterTime, const MkvTrack &track,
+                   SubtitleList &subtitles, SubParseResult *result);
+    void parseBlock(const QByteArray &block, qint64 duration,
+                    quint64 clusterTime, const MkvTrack &track,
+                    SubtitleList &subtitles, SubParseResult *result);
+    bool decodeContent(const MkvTrack &track, QByteArray &data);
+    QString convertText(const MkvTrack &track, const QByteArray &data);
+    const MkvTrack *selectedTrack();
+
+    QVector<MkvTrack> iTracks;
+    int iSelectedTrack;
+    quint64 iTimestampScale;
+    qint64 iSegmentStart;
+    qint64 iSegmentEnd;
+    qint64 iFirstCluster;
+    qint64 iCues;
+    qint64 iSeekInfo;
+    qint64 iSeekTracks;
+
+    QRegularExpression iAssOverride;
+    QRegularExpression iVttTag;
+};
+
+class MkvParserPlugin : public QObject, public ParserPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ParserPlugin_iid FILE "mkvparser.json")
+    Q_INTERFACES(ParserPlugin)
+
+public:
+    Parser *createParser() { return new MkvParser(); }
+};
+
+#endif // MKVPARSER_H
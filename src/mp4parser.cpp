@@ -0,0 +1,672 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mp4parser.h"
+
+#include <QTextCodec>
+#include <QtEndian>
+
+#define MP4_FOURCC(a, b, c, d) ((static_cast<quint32>(a) << 24) | \
+                                (static_cast<quint32>(b) << 16) | \
+                                (static_cast<quint32>(c) << 8) | \
+                                static_cast<quint32>(d))
+
+#define MP4_BOX_FTYP MP4_FOURCC('f', 't', 'y', 'p')
+#define MP4_BOX_MOOV MP4_FOURCC('m', 'o', 'o', 'v')
+#define MP4_BOX_MVHD MP4_FOURCC('m', 'v', 'h', 'd')
+#define MP4_BOX_TRAK MP4_FOURCC('t', 'r', 'a', 'k')
+#define MP4_BOX_TKHD MP4_FOURCC('t', 'k', 'h', 'd')
+#define MP4_BOX_EDTS MP4_FOURCC('e', 'd', 't', 's')
+#define MP4_BOX_ELST MP4_FOURCC('e', 'l', 's', 't')
+#define MP4_BOX_MDIA MP4_FOURCC('m', 'd', 'i', 'a')
+#define MP4_BOX_MDHD MP4_FOURCC('m', 'd', 'h', 'd')
+#define MP4_BOX_MINF MP4_FOURCC('m', 'i', 'n', 'f')
+#define MP4_BOX_STBL MP4_FOURCC('s', 't', 'b', 'l')
+#define MP4_BOX_STSD MP4_FOURCC('s', 't', 's', 'd')
+#define MP4_BOX_STTS MP4_FOURCC('s', 't', 't', 's')
+#define MP4_BOX_STSC MP4_FOURCC('s', 't', 's', 'c')
+#define MP4_BOX_STSZ MP4_FOURCC('s', 't', 's', 'z')
+#define MP4_BOX_STCO MP4_FOURCC('s', 't', 'c', 'o')
+#define MP4_BOX_CO64 MP4_FOURCC('c', 'o', '6', '4')
+#define MP4_BOX_VTTC MP4_FOURCC('v', 't', 't', 'c')
+#define MP4_BOX_PAYL MP4_FOURCC('p', 'a', 'y', 'l')
+
+#define MP4_CODEC_TX3G MP4_FOURCC('t', 'x', '3', 'g')
+#define MP4_CODEC_WVTT MP4_FOURCC('w', 'v', 't', 't')
+
+#define MP4_TRACK_ENABLED 0x000001
+// Size, type and 64 bit size
+#define MP4_BOX_HEADER_MAX 16
+// Full box headers, the sample description is read only to the entry type
+#define MP4_HEADER_MAX 256
+#define MP4_SAMPLE_ENTRY_HEADER 16
+// Sample tables of a text track are small, video tables are never read
+#define MP4_TABLE_MAX (16 * 1024 * 1024)
+#define MP4_CHUNK_MAX (1024 * 1024)
+// Samples this small have no text, tx3g length or an empty vtte box
+#define MP4_TX3G_EMPTY 2
+#define MP4_WVTT_EMPTY 8
+
+static quint16 readU16(const QByteArray &data, int pos)
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(data.constData()) + pos);
+}
+
+static quint32 readU32(const QByteArray &data, int pos)
+{
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data.constData()) + pos);
+}
+
+static quint64 readU64(const QByteArray &data, int pos)
+{
+    return qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(data.constData()) + pos);
+}
+
+static QString fourccToString(quint32 fourcc)
+{
+    QString str;
+
+    for (int shift = 24; shift >= 0; shift -= 8)
+        str.append(QLatin1Char(static_cast<char>((fourcc >> shift) & 0xff)));
+
+    return str;
+}
+
+// ISO 639-2/T code packed to three 5 bit letters, Macintosh codes below
+static QString unpackLanguage(quint16 packed)
+{
+    QString language;
+
+    if (packed < 0x400 || packed == 0x7fff)
+        return QStringLiteral("und");
+
+    for (int shift = 10; shift >= 0; shift -= 5)
+        language.append(QLatin1Char(static_cast<char>(((packed >> shift) & 0x1f) + 0x60)));
+
+    return language;
+}
+
+Mp4Parser::Mp4Parser() :
+    iVttTag(QStringLiteral(R"(<(?!/?(?:i|b|u)>)[^>]*>)"))
+{
+    iSelectedTrack = -1;
+    initializeParser();
+}
+
+void Mp4Parser::initializeParser()
+{
+    iTracks.clear();
+    iMovieTimescale = 0;
+    iFileSize = 0;
+}
+
+/*
+ * Like with Matroska reads are not buffered, only the box headers and the
+ * tables of the text tracks are read.
+ */
+int Mp4Parser::openSubtitle(const QString &filePath)
+{
+    releaseFile();
+    iSubfile = new QFile(filePath);
+    if (!iSubfile->exists()) {
+        qDebug() << "file %s does not exist" << filePath;
+        return -ENOENT;
+    }
+
+    if (!iSubfile->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qDebug() << "Error opening file";
+        return -EACCES;
+    }
+
+    iInput = iSubfile;
+    iFileSize = iSubfile->size();
+
+    if (!readHeaders()) {
+        qDebug() << "not an mp4 file";
+        return -ENOTSUP;
+    }
+
+    qDebug() << iTracks.size() << "text tracks in" << filePath;
+
+    return 0;
+}
+
+bool Mp4Parser::readBox(qint64 pos, qint64 end, Mp4Box &box)
+{
+    QByteArray header;
+    quint64 size;
+    int headerSize = 8;
+
+    if (pos + headerSize > end || !iInput->seek(pos))
+        return false;
+
+    header = iInput->read(MP4_BOX_HEADER_MAX);
+    if (header.size() < headerSize)
+        return false;
+
+    size = readU32(header, 0);
+    box.type = readU32(header, 4);
+
+    if (size == 1) {
+        if (header.size() < MP4_BOX_HEADER_MAX)
+            return false;
+
+        size = readU64(header, 8);
+        headerSize = MP4_BOX_HEADER_MAX;
+    } else if (size == 0) {
+        // Extends to the end of the parent
+        size = static_cast<quint64>(end - pos);
+    }
+
+    if (size < static_cast<quint64>(headerSize) ||
+            size > static_cast<quint64>(end - pos))
+        return false;
+
+    box.dataStart = pos + headerSize;
+    box.end = pos + static_cast<qint64>(size);
+
+    return true;
+}
+
+bool Mp4Parser::findBox(const Mp4Box &parent, quint32 type, Mp4Box &box)
+{
+    qint64 pos = parent.dataStart;
+
+    while (readBox(pos, parent.end, box)) {
+        if (box.type == type)
+            return true;
+
+        pos = box.end;
+    }
+
+    return false;
+}
+
+QByteArray Mp4Parser::readPayload(const Mp4Box &box, qint64 maxSize)
+{
+    if (box.end - box.dataStart > maxSize) {
+        qDebug() << "skipping too large box" << fourccToString(box.type);
+        return QByteArray();
+    }
+
+    if (!iInput->seek(box.dataStart))
+        return QByteArray();
+
+    return iInput->read(box.end - box.dataStart);
+}
+
+/*
+ * File type box comes first, the movie box may be at either end of the
+ * file. Media data between them is skipped by the box sizes.
+ */
+bool Mp4Parser::readHeaders()
+{
+    Mp4Box file;
+    Mp4Box box;
+    Mp4Box moov;
+    QByteArray data;
+    qint64 pos;
+
+    file.type = 0;
+    file.dataStart = 0;
+    file.end = iFileSize;
+
+    if (!readBox(0, iFileSize, box) || box.type != MP4_BOX_FTYP)
+        return false;
+
+    if (!findBox(file, MP4_BOX_MOOV, moov)) {
+        qDebug() << "no movie box, fragmented files are not supported";
+        return false;
+    }
+
+    if (findBox(moov, MP4_BOX_MVHD, box)) {
+        data = readPayload(box, MP4_HEADER_MAX);
+        if (data.size() >= 24)
+            iMovieTimescale = readU32(data, data.at(0) == 1 ? 20 : 12);
+    }
+
+    pos = moov.dataStart;
+    while (readBox(pos, moov.end, box)) {
+        if (box.type == MP4_BOX_TRAK)
+            parseTrack(box);
+
+        pos = box.end;
+    }
+
+    return true;
+}
+
+void Mp4Parser::parseTrack(const Mp4Box &trak)
+{
+    Mp4Box tkhd;
+    Mp4Box mdia;
+    Mp4Box mdhd;
+    Mp4Box minf;
+    Mp4Box stsd;
+    Mp4Box edts;
+    Mp4Track entry;
+    QByteArray data;
+    quint32 codec;
+    int version;
+
+    if (!findBox(trak, MP4_BOX_TKHD, tkhd) ||
+            !findBox(trak, MP4_BOX_MDIA, mdia) ||
+            !findBox(mdia, MP4_BOX_MDHD, mdhd) ||
+            !findBox(mdia, MP4_BOX_MINF, minf) ||
+            !findBox(minf, MP4_BOX_STBL, entry.sampleTable) ||
+            !findBox(entry.sampleTable, MP4_BOX_STSD, stsd))
+        return;
+
+    // Codec is the type of the first sample entry
+    if (!iInput->seek(stsd.dataStart))
+        return;
+
+    data = iInput->read(MP4_SAMPLE_ENTRY_HEADER);
+    if (data.size() < MP4_SAMPLE_ENTRY_HEADER || !readU32(data, 4))
+        return;
+
+    codec = readU32(data, 12);
+    if (codec != MP4_CODEC_TX3G && codec != MP4_CODEC_WVTT)
+        return;
+
+    entry.track.codec = fourccToString(codec);
+
+    data = readPayload(tkhd, MP4_HEADER_MAX);
+    version = data.isEmpty() ? 0 : data.at(0);
+    if (data.size() < (version == 1 ? 24 : 16))
+        return;
+
+    entry.track.number = static_cast<int>(readU32(data, version == 1 ? 20 : 12));
+    entry.track.isDefault = readU32(data, 0) & MP4_TRACK_ENABLED;
+
+    data = readPayload(mdhd, MP4_HEADER_MAX);
+    version = data.isEmpty() ? 0 : data.at(0);
+    if (data.size() < (version == 1 ? 34 : 22))
+        return;
+
+    entry.timescale = readU32(data, version == 1 ? 20 : 12);
+    entry.track.language = unpackLanguage(readU16(data, version == 1 ? 32 : 20));
+
+    if (!entry.timescale || !entry.track.number)
+        return;
+
+    entry.delay = 0;
+    entry.mediaStart = 0;
+    if (findBox(trak, MP4_BOX_EDTS, edts))
+        parseEdits(edts, entry);
+
+    iTracks.append(entry);
+}
+
+/*
+ * Empty edits at the start delay the track and the first edit tells where
+ * in the media the presentation begins. Later edits are not supported.
+ */
+void Mp4Parser::parseEdits(const Mp4Box &edts, Mp4Track &entry)
+{
+    Mp4Box elst;
+    QByteArray data;
+    quint64 duration;
+    qint64 mediaTime;
+    quint32 count;
+    int entrySize;
+    int pos = 8;
+    bool large;
+
+    if (!findBox(edts, MP4_BOX_ELST, elst))
+        return;
+
+    data = readPayload(elst, MP4_HEADER_MAX);
+    if (data.size() < pos)
+        return;
+
+    large = data.at(0) == 1;
+    entrySize = large ? 20 : 12;
+    count = readU32(data, 4);
+
+    for (quint32 i = 0; i < count && pos + entrySize <= data.size(); i++) {
+        duration = large ? readU64(data, pos) : readU32(data, pos);
+        mediaTime = large ? static_cast<qint64>(readU64(data, pos + 8)) :
+                            static_cast<qint32>(readU32(data, pos + 4));
+        pos += entrySize;
+
+        if (mediaTime >= 0) {
+            entry.mediaStart = mediaTime;
+            break;
+        }
+
+        if (iMovieTimescale)
+            entry.delay += static_cast<qint64>(duration * 1000 / iMovieTimescale);
+    }
+}
+
+SubTrackList Mp4Parser::getTracks()
+{
+    SubTrackList tracks;
+
+    for (const Mp4Track &entry : iTracks)
+        tracks.append(entry.track);
+
+    return tracks;
+}
+
+// Kept over initializeParser(), -1 selects the first enabled track
+bool Mp4Parser::selectTrack(int number)
+{
+    bool found = number == -1;
+
+    for (const Mp4Track &entry : iTracks)
+        found = found || entry.track.number == number;
+
+    if (!found)
+        return false;
+
+    iSelectedTrack = number;
+    return true;
+}
+
+int Mp4Parser::getSelectedTrack()
+{
+    const Mp4Track *track = selectedTrack();
+
+    return track ? track->track.number : -1;
+}
+
+const Mp4Track *Mp4Parser::selectedTrack()
+{
+    const Mp4Track *fallback = nullptr;
+
+    for (const Mp4Track &entry : iTracks) {
+        if (entry.track.number == iSelectedTrack)
+            return &entry;
+
+        if (!fallback || (entry.track.isDefault && !fallback->track.isDefault))
+            fallback = &entry;
+    }
+
+    return fallback;
+}
+
+/*
+ * Sample sizes and the chunks with their first sample and offset in the
+ * file, from the sample size, chunk offset and sample to chunk tables.
+ */
+bool Mp4Parser::readChunks(const Mp4Track &track, QVector<Mp4Chunk> &chunks,
+                           QVector<quint32> &sizes)
+{
+    Mp4Box stsz;
+    Mp4Box stco;
+    Mp4Box stsc;
+    QByteArray data;
+    QVector<qint64> offsets;
+    Mp4Chunk chunk;
+    quint32 count;
+    quint32 uniform;
+    quint32 first;
+    quint32 last;
+    quint32 sample = 0;
+    bool large = false;
+
+    if (!findBox(track.sampleTable, MP4_BOX_STSZ, stsz) ||
+            !findBox(track.sampleTable, MP4_BOX_STSC, stsc))
+        return false;
+
+    if (!findBox(track.sampleTable, MP4_BOX_STCO, stco)) {
+        if (!findBox(track.sampleTable, MP4_BOX_CO64, stco))
+            return false;
+
+        large = true;
+    }
+
+    data = readPayload(stsz, MP4_TABLE_MAX);
+    if (data.size() < 12)
+        return false;
+
+    uniform = readU32(data, 4);
+    count = readU32(data, 8);
+    if (count > MP4_TABLE_MAX / 4 ||
+            (!uniform && static_cast<quint32>(data.size()) < 12 + count * 4))
+        return false;
+
+    sizes.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count; i++)
+        sizes.append(uniform ? uniform : readU32(data, 12 + static_cast<int>(i) * 4));
+
+    data = readPayload(stco, MP4_TABLE_MAX);
+    if (data.size() < 8)
+        return false;
+
+    count = readU32(data, 4);
+    if (count > MP4_TABLE_MAX / 4 ||
+            static_cast<quint32>(data.size()) < 8 + count * (large ? 8 : 4))
+        return false;
+
+    offsets.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count; i++) {
+        offsets.append(large ? static_cast<qint64>(readU64(data, 8 + static_cast<int>(i) * 8)) :
+                               readU32(data, 8 + static_cast<int>(i) * 4));
+    }
+
+    data = readPayload(stsc, MP4_TABLE_MAX);
+    if (data.size() < 8)
+        return false;
+
+    count = readU32(data, 4);
+    if (count > MP4_TABLE_MAX / 12 ||
+            static_cast<quint32>(data.size()) < 8 + count * 12)
+        return false;
+
+    // Runs of chunks with the same number of samples, chunks count from 1
+    for (quint32 i = 0; i < count; i++) {
+        first = readU32(data, 8 + static_cast<int>(i) * 12);
+        chunk.samples = readU32(data, 12 + static_cast<int>(i) * 12);
+        last = i + 1 < count ? readU32(data, 20 + static_cast<int>(i) * 12) - 1 :
+                               static_cast<quint32>(offsets.size());
+
+        for (quint32 c = first; c && c <= last && c <= static_cast<quint32>(offsets.size()); c++) {
+            if (sample >= static_cast<quint32>(sizes.size()))
+                return true;
+
+            chunk.offset = offsets.at(static_cast<int>(c) - 1);
+            chunk.firstSample = sample;
+            chunks.append(chunk);
+            sample += chunk.samples;
+        }
+    }
+
+    return true;
+}
+
+QString Mp4Parser::convertText(const Mp4Track &track, const QByteArray &sample)
+{
+    QStringList parts;
+    QString text;
+    QByteArray payload;
+    quint32 size;
+    int pos = 0;
+
+    if (track.track.codec == QStringLiteral("tx3g")) {
+        // Text length and the text, style boxes after it are not used
+        if (sample.size() < 2)
+            return QString();
+
+        payload = sample.mid(2, readU16(sample, 0));
+        if (payload.startsWith("\xFE\xFF"))
+            text = QTextCodec::codecForName("UTF-16BE")->toUnicode(payload.mid(2));
+        else
+            text = QString::fromUtf8(payload);
+    } else {
+        // Cue boxes with the text in a payload box, vtte is an empty sample
+        while (pos + 8 <= sample.size()) {
+            size = readU32(sample, pos);
+            if (size < 8 || size > static_cast<quint32>(sample.size() - pos))
+                break;
+
+            if (readU32(sample, pos + 4) == MP4_BOX_VTTC) {
+                int end = pos + static_cast<int>(size);
+                int inner = pos + 8;
+
+                while (inner + 8 <= end) {
+                    quint32 innerSize = readU32(sample, inner);
+
+                    if (innerSize < 8 || innerSize > static_cast<quint32>(end - inner))
+                        break;
+
+                    if (readU32(sample, inner + 4) == MP4_BOX_PAYL)
+                        parts.append(QString::fromUtf8(sample.mid(inner + 8,
+                                                                  static_cast<int>(innerSize) - 8)));
+
+                    inner += static_cast<int>(innerSize);
+                }
+            }
+
+            pos += static_cast<int>(size);
+        }
+
+        text = parts.join(QLatin1Char('\n'));
+        text.remove(iVttTag);
+    }
+
+    text = text.trimmed();
+    text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    text.replace(QLatin1Char('\n'), QStringLiteral("<br>"));
+
+    return text;
+}
+
+void Mp4Parser::parseSample(const Mp4Track &track, const QByteArray &sample,
+                            quint64 time, quint64 endTime,
+                            SubtitleList &subtitles, SubParseResult *result)
+{
+    QString text = convertText(track, sample);
+    qint64 start;
+    qint64 end;
+
+    // Empty samples clear the previous cue
+    if (text.isEmpty())
+        return;
+
+    start = (static_cast<qint64>(time) - track.mediaStart) * 1000 /
+            track.timescale + track.delay;
+    end = (static_cast<qint64>(endTime) - track.mediaStart) * 1000 /
+            track.timescale + track.delay;
+
+    // Cut by the edit list
+    if (end <= 0)
+        return;
+    if (start < 0)
+        start = 0;
+
+    appendSubtitle(subtitles, result, subtitles.size() + 1,
+                   static_cast<unsigned int>(start),
+                   static_cast<unsigned int>(end), text);
+}
+
+void Mp4Parser::parseSubtitles(SubtitleList &subtitles, SubParseResult *result)
+{
+    const Mp4Track *track = selectedTrack();
+    QVector<Mp4Chunk> chunks;
+    QVector<quint32> sizes;
+    QVector<quint64> times;
+    QByteArray data;
+    QByteArray chunkData;
+    Mp4Box stts;
+    quint32 runs;
+    quint32 empty;
+    int sample = 0;
+
+    if (!track) {
+        qDebug() << "no text subtitle tracks";
+        setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+        return;
+    }
+
+    qDebug() << "reading track" << track->track.number << track->track.codec <<
+                track->track.language;
+
+    if (!readChunks(*track, chunks, sizes) ||
+            !findBox(track->sampleTable, MP4_BOX_STTS, stts)) {
+        qDebug() << "invalid sample tables";
+        setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+        return;
+    }
+
+    // Decode time of each sample and the end of the last one
+    data = readPayload(stts, MP4_TABLE_MAX);
+    runs = data.size() >= 8 ? readU32(data, 4) : 0;
+    times.reserve(sizes.size() + 1);
+    times.append(0);
+
+    for (quint32 i = 0; i < runs && 16 + static_cast<int>(i) * 8 <= data.size(); i++) {
+        quint32 count = readU32(data, 8 + static_cast<int>(i) * 8);
+        quint32 delta = readU32(data, 12 + static_cast<int>(i) * 8);
+
+        for (quint32 j = 0; j < count && times.size() <= sizes.size(); j++)
+            times.append(times.last() + delta);
+    }
+
+    // Samples missing from the table last no time
+    while (times.size() <= sizes.size())
+        times.append(times.last());
+
+    empty = track->track.codec == QStringLiteral("tx3g") ? MP4_TX3G_EMPTY :
+                                                           MP4_WVTT_EMPTY;
+
+    for (const Mp4Chunk &chunk : chunks) {
+        int first = static_cast<int>(chunk.firstSample);
+        int last = static_cast<int>(qMin<quint64>(static_cast<quint64>(first) + chunk.samples,
+                                                  static_cast<quint64>(sizes.size())));
+        qint64 total = 0;
+        bool text = false;
+        int pos = 0;
+
+        for (sample = first; sample < last; sample++) {
+            total += sizes.at(sample);
+            text |= sizes.at(sample) > empty;
+        }
+
+        // Gaps between cues are not read
+        if (!text)
+            continue;
+
+        if (total > MP4_CHUNK_MAX || !iInput->seek(chunk.offset)) {
+            if (!recoverError(result, SUB_PARSE_ERROR_INVALID_FILE))
+                return;
+            continue;
+        }
+
+        chunkData = iInput->read(total);
+        if (chunkData.size() < total) {
+            if (!recoverError(result, SUB_PARSE_ERROR_INVALID_FILE))
+                return;
+            continue;
+        }
+
+        for (sample = first; sample < last; sample++) {
+            parseSample(*track, chunkData.mid(pos, static_cast<int>(sizes.at(sample))),
+                        times.at(sample), times.at(sample + 1), subtitles, result);
+            pos += static_cast<int>(sizes.at(sample));
+        }
+    }
+}
+
+void Mp4Parser::updateFPS(SubtitleList &subtitles)
+{
+    Q_UNUSED(subtitles);
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP4PARSER_H
+#define MP4PARSER_H
+
+#include "parser.h"
+#include "parserplugin.h"
+
+#include <QRegularExpression>
+
+typedef struct _Mp4Box {
+    quint32 type;
+    qint64 dataStart;
+    qint64 end;
+} Mp4Box;
+
+typedef struct _Mp4Track {
+    SubTrack track;
+    quint32 timescale;
+    Mp4Box sampleTable;  // stbl of the track
+    qint64 delay;        // Empty edits before the track, in milliseconds
+    qint64 mediaStart;   // Media time of the first edit, in track timescale
+} Mp4Track;
+
+typedef struct _Mp4Chunk {
+    qint64 offset;
+    quint32 firstSample;
+    quint32 samples;
+} Mp4Chunk;
+
+/*
+ * 3GPP timed text (tx3g) and WebVTT (wvtt) tracks of ISO base media files.
+ * Only the box headers and the sample tables of the movie box are read when
+ * the file is opened. Samples of the selected track are read chunk by chunk
+ * from the offsets of the sample tables, media data is never walked.
+ * Fragmented files have no samples in the movie box and are not supported.
+ */
+class Mp4Parser : public Parser
+{
+public:
+    Mp4Parser();
+
+    // Parser interface
+public:
+    int openSubtitle(const QString &filePath);
+    void parseSubtitles(SubtitleList &subtitles, SubParseResult *result);
+    void updateFPS(SubtitleList &subtitles);
+    bool needFPSUpdate() { return false; };
+    void initializeParser();
+    SubTrackList getTracks();
+    bool selectTrack(int number);
+    int getSelectedTrack();
+
+private:
+    bool readBox(qint64 pos, qint64 end, Mp4Box &box);
+    bool findBox(const Mp4Box &parent, quint32 type, Mp4Box &box);
+    QByteArray readPayload(const Mp4Box &box, qint64 maxSize);
+    bool readHeaders();
+    void parseTrack(const Mp4Box &trak);
+    void parseEdits(const Mp4Box &edts, Mp4Track &entry);
+    bool readChunks(const Mp4Track &track, QVector<Mp4Chunk> &chunks,
+                    QVector<quint32> &sizes);
+    void parseSample(const Mp4Track &track, const QByteArray &sample,
+                     quint64 time, quint64 endTime,
+                     SubtitleList &subtitles, SubParseResult *result);
+    QString convertText(const Mp4Track &track, const QByteArray &sample);
+    const Mp4Track *selectedTrack();
+
+    QVector<Mp4Track> iTracks;
+    int iSelectedTrack;
+    quint32 iMovieTimescale;
+    qint64 iFileSize;
+
+    QRegularExpression iVttTag;
+};
+
+class Mp4ParserPlugin : public QObject, public ParserPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ParserPlugin_iid FILE "mp4parser.json")
+    Q_INTERFACES(ParserPlugin)
+
+public:
+    Parser *createParser() { return new Mp4Parser(); }
+};
+
+#endif // MP4PARSER_H
@@ -0,0 +1,368 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mprisclock.h"
+
+#include <QDBusConnection>
+#include <QDBusArgument>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDBusReply>
+#include <QDBusVariant>
+#include <QMimeDatabase>
+#include <QUrl>
+#include <QtDebug>
+
+#define MPRIS_SERVICE_PREFIX "org.mpris.MediaPlayer2."
+#define MPRIS_PATH "/org/mpris/MediaPlayer2"
+#define MPRIS_PLAYER_INTERFACE "org.mpris.MediaPlayer2.Player"
+#define DBUS_PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+
+// Interpolation is corrected against the player this often
+#define MPRIS_RESYNC_INTERVAL 5000
+
+// Players are asked synchronously when attaching, a hung one must not stall
+#define MPRIS_PROBE_TIMEOUT 500
+
+// A playing player is followed before a paused one showing video
+#define MPRIS_SCORE_PLAYING 2
+#define MPRIS_SCORE_VIDEO 1
+
+MprisClock::MprisClock(QObject *parent) :
+    QObject(parent),
+    iPosition(0),
+    iRate(1.0),
+    iLength(0),
+    iPlaying(false)
+{
+    iSince.start();
+
+    iResyncTimer.setInterval(MPRIS_RESYNC_INTERVAL);
+    connect(&iResyncTimer, &QTimer::timeout, this, &MprisClock::resync);
+}
+
+MprisClock::~MprisClock()
+{
+    detach();
+}
+
+/*
+ * Nested dictionaries arrive unmarshalled from D-Bus but as maps from
+ * services of this process.
+ */
+QVariantMap MprisClock::metadataMap(const QVariant &metadata)
+{
+    QVariantMap map;
+
+    if (metadata.canConvert<QDBusArgument>())
+        metadata.value<QDBusArgument>() >> map;
+    else
+        map = metadata.toMap();
+
+    return map;
+}
+
+// How likely the player shows the video being subtitled, -1 if it does not answer
+int MprisClock::playerScore(const QString &service)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(service,
+                                QStringLiteral(MPRIS_PATH),
+                                QStringLiteral(DBUS_PROPERTIES_INTERFACE),
+                                QStringLiteral("GetAll"));
+    QDBusReply<QVariantMap> reply;
+    QVariantMap metadata;
+    QUrl url;
+    int score = 0;
+
+    message << QStringLiteral(MPRIS_PLAYER_INTERFACE);
+
+    reply = QDBusConnection::sessionBus().call(message, QDBus::Block,
+                                               MPRIS_PROBE_TIMEOUT);
+    if (!reply.isValid()) {
+        qDebug() << "MPRIS player" << service << "not answering"
+                 << reply.error().message();
+        return -1;
+    }
+
+    if (reply.value().value(QStringLiteral("PlaybackStatus")).toString() ==
+            QStringLiteral("Playing"))
+        score += MPRIS_SCORE_PLAYING;
+
+    metadata = metadataMap(reply.value().value(QStringLiteral("Metadata")));
+    url = QUrl(metadata.value(QStringLiteral("xesam:url")).toString());
+
+    if (!url.isEmpty() &&
+            QMimeDatabase().mimeTypeForFile(url.path(), QMimeDatabase::MatchExtension)
+            .name().startsWith(QStringLiteral("video/")))
+        score += MPRIS_SCORE_VIDEO;
+
+    return score;
+}
+
+/*
+ * Music players register on the bus as well, prefer the player that is
+ * playing and then one with a video loaded. Equal players are taken in bus
+ * order.
+ */
+QString MprisClock::findPlayer()
+{
+    QDBusConnectionInterface *bus = QDBusConnection::sessionBus().interface();
+    QStringList services;
+    QString found;
+    int best = -2;
+    int score;
+
+    if (!bus)
+        return QString();
+
+    services = bus->registeredServiceNames().value();
+
+    for (const QString &service : services) {
+        if (!service.startsWith(QStringLiteral(MPRIS_SERVICE_PREFIX)))
+            continue;
+
+        score = playerScore(service);
+        if (score > best) {
+            best = score;
+            found = service;
+        }
+    }
+
+    return found;
+}
+
+bool MprisClock::attach()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    QDBusServiceWatcher *watcher;
+
+    if (isAttached())
+        return true;
+
+    iService = findPlayer();
+    if (iService.isEmpty()) {
+        qDebug() << "no MPRIS player found";
+        return false;
+    }
+
+    qDebug() << "following MPRIS player" << iService;
+
+    bus.connect(iService, QStringLiteral(MPRIS_PATH),
+                QStringLiteral(DBUS_PROPERTIES_INTERFACE),
+                QStringLiteral("PropertiesChanged"), this,
+                SLOT(propertiesChanged(QString,QVariantMap,QStringList)));
+    bus.connect(iService, QStringLiteral(MPRIS_PATH),
+                QStringLiteral(MPRIS_PLAYER_INTERFACE),
+                QStringLiteral("Seeked"), this, SLOT(seeked(qlonglong)));
+
+    watcher = new QDBusServiceWatcher(iService, bus,
+                                      QDBusServiceWatcher::WatchForUnregistration,
+                                      this);
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered,
+            this, &MprisClock::serviceUnregistered);
+    connect(this, &MprisClock::detached, watcher, &QObject::deleteLater);
+
+    requestProperties();
+    iResyncTimer.start();
+
+    return true;
+}
+
+void MprisClock::detach()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+
+    if (!isAttached())
+        return;
+
+    bus.disconnect(iService, QStringLiteral(MPRIS_PATH),
+                   QStringLiteral(DBUS_PROPERTIES_INTERFACE),
+                   QStringLiteral("PropertiesChanged"), this,
+                   SLOT(propertiesChanged(QString,QVariantMap,QStringList)));
+    bus.disconnect(iService, QStringLiteral(MPRIS_PATH),
+                   QStringLiteral(MPRIS_PLAYER_INTERFACE),
+                   QStringLiteral("Seeked"), this, SLOT(seeked(qlonglong)));
+
+    iResyncTimer.stop();
+    iService.clear();
+    iLength = 0;
+    setPlaying(false);
+
+    emit detached();
+}
+
+bool MprisClock::isAttached()
+{
+    return !iService.isEmpty();
+}
+
+bool MprisClock::isPlaying()
+{
+    return iPlaying;
+}
+
+// Length of the playing media in milliseconds, 0 when not known
+qint64 MprisClock::length()
+{
+    return iLength;
+}
+
+qint64 MprisClock::now()
+{
+    if (!iPlaying)
+        return iPosition;
+
+    return iPosition + static_cast<qint64>(iSince.elapsed() * iRate);
+}
+
+void MprisClock::setPosition(qint64 position)
+{
+    iPosition = position;
+    iSince.restart();
+}
+
+void MprisClock::setPlaying(bool playing)
+{
+    if (iPlaying == playing)
+        return;
+
+    // Keep the interpolated position when the state changes
+    setPosition(now());
+    iPlaying = playing;
+
+    emit playingChanged(iPlaying);
+}
+
+void MprisClock::setRate(double rate)
+{
+    setPosition(now());
+    iRate = rate > 0.0 ? rate : 1.0;
+}
+
+void MprisClock::setMetadata(const QVariant &metadata)
+{
+    QVariantMap map = metadataMap(metadata);
+
+    iLength = map.value(QStringLiteral("mpris:length")).toLongLong() / 1000;
+}
+
+void MprisClock::requestProperties()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(iService,
+                                QStringLiteral(MPRIS_PATH),
+                                QStringLiteral(DBUS_PROPERTIES_INTERFACE),
+                                QStringLiteral("GetAll"));
+    QDBusPendingCallWatcher *watcher;
+
+    message << QStringLiteral(MPRIS_PLAYER_INTERFACE);
+
+    watcher = new QDBusPendingCallWatcher(
+                QDBusConnection::sessionBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &MprisClock::propertiesReceived);
+}
+
+void MprisClock::resync()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(iService,
+                                QStringLiteral(MPRIS_PATH),
+                                QStringLiteral(DBUS_PROPERTIES_INTERFACE),
+                                QStringLiteral("Get"));
+    QDBusPendingCallWatcher *watcher;
+
+    if (!isAttached())
+        return;
+
+    message << QStringLiteral(MPRIS_PLAYER_INTERFACE) << QStringLiteral("Position");
+
+    watcher = new QDBusPendingCallWatcher(
+                QDBusConnection::sessionBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &MprisClock::positionReceived);
+}
+
+void MprisClock::propertiesReceived(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<QVariantMap> reply = *watcher;
+
+    watcher->deleteLater();
+
+    if (reply.isError()) {
+        qWarning() << "cannot read MPRIS properties" << reply.error().message();
+        return;
+    }
+
+    propertiesChanged(QStringLiteral(MPRIS_PLAYER_INTERFACE), reply.value(),
+                      QStringList());
+}
+
+void MprisClock::positionReceived(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<QDBusVariant> reply = *watcher;
+
+    watcher->deleteLater();
+
+    if (reply.isError())
+        return;
+
+    // MPRIS positions are in microseconds
+    setPosition(reply.value().variant().toLongLong() / 1000);
+}
+
+void MprisClock::propertiesChanged(const QString &interface,
+                                   const QVariantMap &changed,
+                                   const QStringList &invalidated)
+{
+    Q_UNUSED(invalidated);
+
+    if (interface != QStringLiteral(MPRIS_PLAYER_INTERFACE))
+        return;
+
+    if (changed.contains(QStringLiteral("Rate")))
+        setRate(changed.value(QStringLiteral("Rate")).toDouble());
+
+    if (changed.contains(QStringLiteral("Metadata")))
+        setMetadata(changed.value(QStringLiteral("Metadata")));
+
+    if (changed.contains(QStringLiteral("Position")))
+        setPosition(changed.value(QStringLiteral("Position")).toLongLong() / 1000);
+
+    if (changed.contains(QStringLiteral("PlaybackStatus"))) {
+        setPlaying(changed.value(QStringLiteral("PlaybackStatus")).toString() ==
+                   QStringLiteral("Playing"));
+
+        // Position is not signaled, read it when the status changes
+        if (!changed.contains(QStringLiteral("Position")))
+            resync();
+    }
+}
+
+void MprisClock::seeked(qlonglong position)
+{
+    setPosition(position / 1000);
+}
+
+void MprisClock::serviceUnregistered(const QString &service)
+{
+    qDebug() << "MPRIS player" << service << "gone";
+    detach();
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPRISCLOCK_H
+#define MPRISCLOCK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QStringList>
+#include "subtitleclock.h"
+
+class QDBusPendingCallWatcher;
+
+/*
+ * Clock following the position of a MPRIS2 media player on the session bus.
+ * Position, rate and playback status are read when they change and at a slow
+ * resync interval, in between the position is interpolated with a monotonic
+ * timer so no D-Bus calls are made when the clock is read.
+ */
+class MprisClock : public QObject, public SubtitleClock
+{
+    Q_OBJECT
+public:
+    explicit MprisClock(QObject *parent = nullptr);
+    ~MprisClock();
+
+    bool attach();
+    void detach();
+    bool isAttached();
+    bool isPlaying();
+    qint64 length();
+
+    qint64 now();
+    bool isAbsolute() { return true; }
+
+signals:
+    void playingChanged(bool playing);
+    void detached();
+
+private slots:
+    void propertiesChanged(const QString &interface,
+                           const QVariantMap &changed,
+                           const QStringList &invalidated);
+    void seeked(qlonglong position);
+    void propertiesReceived(QDBusPendingCallWatcher *watcher);
+    void positionReceived(QDBusPendingCallWatcher *watcher);
+    void serviceUnregistered(const QString &service);
+    void resync();
+
+private:
+    static QVariantMap metadataMap(const QVariant &metadata);
+    int playerScore(const QString &service);
+    QString findPlayer();
+    void requestProperties();
+    void setPosition(qint64 position);
+    void setPlaying(bool playing);
+    void setRate(double rate);
+    void setMetadata(const QVariant &metadata);
+
+    QString iService;
+    QElapsedTimer iSince;
+    QTimer iResyncTimer;
+    qint64 iPosition;
+    double iRate;
+    qint64 iLength;
+    bool iPlaying;
+};
+
+#endif // MPRISCLOCK_H
@@ -19,7 +19,10 @@
 
 #include "parser.h"
 #include "parserenginefactory.h"
+#include "inflatedevice.h"
+#include "ziparchive.h"
 
+#include <QFileInfo>
 #include <QMimeType>
 #include <QMimeDatabase>
 #include <QTextCodec>
@@ -28,22 +31,32 @@
 Parser::Parser()
 {
     iSubfile = nullptr;
-    iInStream = nullptr;
+    iInput = nullptr;
     iFps = 0.0;
+    iLineNumber = 0;
+    iLineOffset = 0;
+    iRecovery = false;
 }
 
 Parser::~Parser()
 {
-    if (iInStream)
-        delete(iInStream);
+    releaseFile();
+}
+
+// Parser is used again e.g. when another track is selected
+void Parser::releaseFile()
+{
+    if (iInput != iSubfile)
+        delete iInput;
+    iInput = nullptr;
 
     if (iSubfile) {
         if (iSubfile->isOpen())
             iSubfile->close();
 
         delete(iSubfile);
+        iSubfile = nullptr;
     }
-
 }
 QTextCodec *Parser::useFallbackCodec()
 {
@@ -51,7 +64,7 @@ QTextCodec *Parser::useFallbackCodec()
     return QTextCodec::codecForName(iFallbackCodec.toStdString().c_str());
 }
 
-QTextCodec* Parser::detectEncoding(QFile* file)
+QTextCodec* Parser::detectEncoding(QIODevice* file)
 {
     QByteArray bom;
 
@@ -75,13 +88,15 @@ QTextCodec* Parser::detectEncoding(QFile* file)
     return useFallbackCodec();
 }
 
-bool Parser::checkFileMIME(const QString &filepath)
+bool Parser::checkMIME(const QMimeType &mime)
 {
-    QMimeDatabase db;
-    QMimeType mime = db.mimeTypeForFile(filepath, QMimeDatabase::MatchContent);
     QStringList list = mime.parentMimeTypes();
     bool plaintext = false;
 
+    // Content of compressed files may be detected as plain text only
+    if (mime.name() == QStringLiteral("text/plain"))
+        return true;
+
     for (int i = 0; i < list.size(); i++) {
         qDebug() << "mimetype:" << list.at(i);
         QString mimeTypeName = QString(list.at(i));
@@ -97,32 +112,29 @@ bool Parser::checkFileMIME(const QString &filepath)
     return plaintext;
 }
 
-QTime Parser::timeStrToQTime(const QString &str)
+bool Parser::checkFileMIME(const QString &filepath)
 {
-    return QTime::fromString(str, iTimeStampPattern);
+    QMimeDatabase db;
+
+    return checkMIME(db.mimeTypeForFile(filepath, QMimeDatabase::MatchContent));
 }
 
-unsigned int Parser::timestampToMs(const char *timestamp)
+bool Parser::checkDataMIME(const QString &name, QIODevice *device)
 {
-    int h, m, s, ms;
-
-    if (sscanf(timestamp, "%d:%d:%d,%d", &h, &m, &s, &ms) != 4) {
-        qDebug() << "invalid timestamp format:" << timestamp;
-        return 0;
-    }
+    QMimeDatabase db;
 
-    // Allow normal ranges for ms, s, m, limit hours to 100 - could be lower, though.
-    if (ms > 999 || ms < 0 || s > 59 || s < 0 || m > 59 || m < 0 || h < 0 || h > 100) {
-        qDebug() << "invalid timestamp values:" << timestamp;
-        return 0;
-    }
+    return checkMIME(db.mimeTypeForFileNameAndData(name, device));
+}
 
-    return static_cast<unsigned int>((h * 3600 + m * 60 + s) * 1000 + ms);
+QTime Parser::timeStrToQTime(const QString &str)
+{
+    return QTime::fromString(str, iTimeStampPattern);
 }
 
-unsigned int Parser::timestampToMs(QTime &time)
+unsigned int Parser::timeToMs(const QTime &time)
 {
-    return timestampToMs(time.toString("hh:mm:ss,zzz").toStdString().c_str());
+    // Invalid time yields 0
+    return static_cast<unsigned int>(time.msecsSinceStartOfDay());
 }
 
 unsigned int Parser::frameToTimestampMs(const unsigned int frame)
@@ -133,58 +145,257 @@ unsigned int Parser::frameToTimestampMs(const unsigned int frame)
     return static_cast<unsigned int>((frame / iFps) * 1000.0);
 }
 
+bool Parser::isCompressed(const QString &filePath)
+{
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+
+    return suffix == QStringLiteral("gz") || suffix == QStringLiteral("zip");
+}
+
+/*
+ * Ending of the subtitle in the file, "srt" for "movie.srt.gz" and the ending
+ * of the first subtitle entry for zip archives.
+ */
+QString Parser::subtitleSuffix(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    QString suffix = info.suffix().toLower();
+    ZipEntry entry;
+    QFile file(filePath);
+
+    if (suffix == QStringLiteral("gz"))
+        return QFileInfo(info.completeBaseName()).suffix().toLower();
+
+    if (suffix != QStringLiteral("zip"))
+        return suffix;
+
+    if (!file.open(QIODevice::ReadOnly) ||
+            !ZipArchive::findSubtitle(&file, entry))
+        return QString();
+
+    return QFileInfo(entry.name).suffix().toLower();
+}
+
+/*
+ * Decompress the opened file while it is read, the content is checked as
+ * the file itself cannot be.
+ */
+int Parser::openCompressed()
+{
+    QString name;
+    ZipEntry entry;
+
+    if (QFileInfo(iSubfile->fileName()).suffix().toLower() ==
+            QStringLiteral("zip")) {
+        if (!ZipArchive::findSubtitle(iSubfile, entry)) {
+            qDebug() << "no subtitle in archive";
+            return -ENOTSUP;
+        }
+
+        qDebug() << "reading archive entry" << entry.name;
+        iInput = ZipArchive::openEntry(iSubfile, entry);
+        name = entry.name;
+    } else {
+        iInput = new InflateDevice(iSubfile, InflateDevice::FORMAT_GZIP);
+        if (!iInput->open(QIODevice::ReadOnly)) {
+            delete iInput;
+            iInput = nullptr;
+        }
+        name = QFileInfo(iSubfile->fileName()).completeBaseName();
+    }
+
+    if (!iInput) {
+        qDebug() << "cannot decompress file";
+        return -EINVAL;
+    }
+
+    if (!checkDataMIME(name, iInput)) {
+        qDebug() << "cannot use file";
+        return -ENOTSUP;
+    }
+
+    return 0;
+}
+
 int Parser::openSubtitle(const QString &filePath)
 {
     QTextCodec *codec;
+    bool compressed = isCompressed(filePath);
+    int err;
 
-    if (!checkFileMIME(filePath)) {
+    // Content of compressed files is checked when decompressing
+    if (!compressed && !checkFileMIME(filePath)) {
         qDebug() << "cannot use file";
         return -ENOTSUP;
     }
 
+    releaseFile();
     iSubfile = new QFile(filePath);
     if (!iSubfile->exists()) {
         qDebug() << "file %s does not exist" << filePath;
         return -ENOENT;
     }
 
-    if (!iSubfile->open(QIODevice::ReadOnly | QIODevice::Text)) {
+    // Line endings are handled by the reader
+    if (!iSubfile->open(QIODevice::ReadOnly)) {
         qDebug() << "Error opening file";
         return -EACCES;
     }
 
-    codec = Parser::detectEncoding(iSubfile);
-    iInStream = new QTextStream(iSubfile);
+    if (compressed) {
+        err = openCompressed();
+        if (err)
+            return err;
+    } else {
+        iInput = iSubfile;
+    }
 
-    if (codec)
-        iInStream->setCodec(codec);
+    codec = Parser::detectEncoding(iInput);
+    iReader.reset(codec);
+    iCodecName = codec ? QString::fromLatin1(codec->name()) : QString();
+    iLineNumber = 0;
+    iLineOffset = 0;
 
     return 0;
 }
 
-Subtitle *Parser::loadSubtitle(enum SubParseError *err)
+enum SubParseError Parser::loadSubtitles(SubtitleList &subtitles,
+                                         SubParseResult *result)
 {
-    Subtitle *newsub = nullptr;
+    initResult(result);
 
-    if (!iSubfile) {
+    if (!iSubfile || !iInput) {
         qDebug() << "subtitle file not set";
-        *err = SUB_PARSE_ERROR_NO_FILE;
-        return nullptr;
+        result->error = SUB_PARSE_ERROR_NO_FILE;
+        return result->error;
+    }
+
+    if (!iInput->isOpen() || !iInput->isReadable()) {
+        result->error = SUB_PARSE_ERROR_INVALID_FILE;
+        return result->error;
     }
 
-    if (iSubfile->isOpen() && iSubfile->isReadable())
-        newsub = parseSubtitle(err);
+    parseSubtitles(subtitles, result);
+
+    return result->error;
+}
+
+void Parser::initResult(SubParseResult *result)
+{
+    result->error = SUB_PARSE_ERROR_NONE;
+    result->cues = 0;
+    result->skipped = 0;
+    result->line = 0;
+    result->errors = 0;
+    result->diagnostics.clear();
+}
+
+void Parser::parseSubtitles(SubtitleList &subtitles, SubParseResult *result)
+{
+    QString line;
+
+    while (readLine(line)) {
+        if (!parseLine(line, subtitles, result))
+            return;
+    }
 
-    return newsub;
+    finishLines(subtitles, result);
+}
+
+bool Parser::parseLine(QString &line, SubtitleList &subtitles,
+                       SubParseResult *result)
+{
+    Q_UNUSED(line);
+    Q_UNUSED(subtitles);
+
+    qDebug() << "engine does not parse lines";
+    setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+
+    return false;
+}
+
+void Parser::finishLines(SubtitleList &subtitles, SubParseResult *result)
+{
+    Q_UNUSED(subtitles);
+    Q_UNUSED(result);
+}
+
+/*
+ * Start parsing fed bytes, nullptr codec uses the locale codec as there is
+ * no file to detect the encoding from.
+ */
+void Parser::beginFeed(SubParseResult *result, QTextCodec *codec)
+{
+    initializeParser();
+    initResult(result);
+    iReader.reset(codec);
+    iLineNumber = 0;
+    iLineOffset = 0;
+}
+
+bool Parser::feed(const QByteArray &bytes, SubtitleList &subtitles,
+                  SubParseResult *result)
+{
+    if (result->error != SUB_PARSE_ERROR_NONE)
+        return false;
+
+    iReader.feed(bytes);
+
+    return parseFedLines(subtitles, result);
+}
+
+void Parser::endFeed(SubtitleList &subtitles, SubParseResult *result)
+{
+    if (result->error != SUB_PARSE_ERROR_NONE)
+        return;
+
+    iReader.finish();
+
+    if (parseFedLines(subtitles, result))
+        finishLines(subtitles, result);
+}
+
+bool Parser::parseFedLines(SubtitleList &subtitles, SubParseResult *result)
+{
+    QString line;
+
+    while (iReader.readLine(line)) {
+        iLineNumber = iReader.lineNumber();
+        iLineOffset = iReader.lineOffset();
+
+        if (!parseLine(line, subtitles, result))
+            return false;
+    }
+
+    return true;
+}
+
+SubTrackList Parser::getTracks()
+{
+    return SubTrackList();
+}
+
+bool Parser::selectTrack(int number)
+{
+    Q_UNUSED(number);
+    return false;
+}
+
+int Parser::getSelectedTrack()
+{
+    return -1;
 }
 
 void Parser::closeSubtitle()
 {
+    if (iInput && iInput != iSubfile)
+        iInput->close();
+
     if (iSubfile && iSubfile->isOpen())
         iSubfile->close();
 }
 
-QString Parser::getSubtitleText(Subtitle *subtitle)
+QString Parser::getSubtitleText(const Subtitle *subtitle)
 {
     if (!subtitle || subtitle->text.isEmpty())
         return QString("");
@@ -192,47 +403,85 @@ QString Parser::getSubtitleText(Subtitle *subtitle)
     return subtitle->text;
 }
 
-Subtitle *Parser::newSubtitle(int index, unsigned int startTime,
-                              unsigned int endTime,
-                              const QString &text)
+bool Parser::readLine(QString &line)
 {
-    Subtitle *sub = new Subtitle();
+    while (!iReader.readLine(line)) {
+        QByteArray block;
 
-    sub->index = index;
-    sub->start_time = startTime;
-    sub->end_time = endTime;
-    sub->text = text;
+        // Fed lines are parsed by parseFedLines()
+        if (iReader.isFinished() || !iInput)
+            return false;
 
-    return sub;
-}
+        if (iInput->isOpen())
+            block = iInput->read(PARSER_READ_BLOCK_SIZE);
 
-Subtitle *Parser::newSubtitle(int index, unsigned int startTime,
-                              unsigned int endTime, unsigned int startFrame,
-                              unsigned int endFrame,  const QString &text)
-{
-    Subtitle *sub = newSubtitle(index, startTime, endTime, text);
+        if (block.isEmpty())
+            iReader.finish();
+        else
+            iReader.feed(block);
+    }
 
-    sub->start_frame = startFrame;
-    sub->end_frame = endFrame;
+    iLineNumber = iReader.lineNumber();
+    iLineOffset = iReader.lineOffset();
 
-    return sub;
+    return true;
 }
 
-Subtitle* Parser::newSubtitle(int index, const QTime &startTime,
-                                   const QTime &endTime, const QString &text)
+void Parser::appendSubtitle(SubtitleList &subtitles, SubParseResult *result,
+                            int index, unsigned int startTime,
+                            unsigned int endTime, const QString &text)
 {
-    unsigned int start_time = timestampToMs(const_cast<QTime&>(startTime));
-    unsigned int end_time = timestampToMs(const_cast<QTime&>(endTime));
+    appendSubtitle(subtitles, result, index, startTime, endTime, 0, 0, text);
+}
 
-    return newSubtitle(index, start_time, end_time, text);
+void Parser::appendSubtitle(SubtitleList &subtitles, SubParseResult *result,
+                            int index, unsigned int startTime,
+                            unsigned int endTime, unsigned int startFrame,
+                            unsigned int endFrame, const QString &text)
+{
+    Subtitle sub;
+
+    sub.index = index;
+    sub.start_time = startTime;
+    sub.end_time = endTime;
+    sub.start_frame = startFrame;
+    sub.end_frame = endFrame;
+    sub.flags = SUB_FLAG_NONE;
+    sub.text = text;
+
+    subtitles.append(sub);
+    result->cues++;
 }
 
-void Parser::freeSubtitle(Subtitle *subtitle)
+void Parser::setParseError(SubParseResult *result, enum SubParseError err)
 {
-    if (!subtitle)
-        return;
+    result->error = err;
+    result->line = iLineNumber;
+}
+
+/*
+ * Record an error on the current line. In recovery mode true is returned and
+ * the engine continues from the next plausible cue, otherwise the error stops
+ * parsing.
+ */
+bool Parser::recoverError(SubParseResult *result, enum SubParseError err)
+{
+    SubParseDiagnostic diagnostic;
 
-    delete subtitle;
+    result->errors++;
+
+    if (result->diagnostics.size() < PARSER_DIAGNOSTICS_MAX) {
+        diagnostic.offset = iLineOffset;
+        diagnostic.line = iLineNumber;
+        diagnostic.error = err;
+        result->diagnostics.append(diagnostic);
+    }
+
+    if (iRecovery)
+        return true;
+
+    setParseError(result, err);
+    return false;
 }
 
 void Parser::setFps(double fps)
@@ -240,7 +489,27 @@ void Parser::setFps(double fps)
     iFps = fps;
 }
 
+double Parser::getFps()
+{
+    return iFps;
+}
+
+QString Parser::getCodecName()
+{
+    return iCodecName;
+}
+
+QString Parser::getFormat()
+{
+    return QString();
+}
+
 void Parser::setFallbackCodec(const QString &fallbackCodec)
 {
     iFallbackCodec = QString(fallbackCodec);
 }
+
+void Parser::setRecovery(bool enabled)
+{
+    iRecovery = enabled;
+}
@@ -21,60 +21,108 @@
 #define PARSER_H
 
 #include <QString>
-#include <QTextStream>
 #include <QFile>
+#include <QTextCodec>
+#include <QMimeType>
 #include <QtDebug>
 #include "types.h"
+#include "linereader.h"
+
+// Bytes read from the file at a time
+#define PARSER_READ_BLOCK_SIZE 65536
+// Errors recorded in the diagnostics, the rest are only counted
+#define PARSER_DIAGNOSTICS_MAX 100
 
 class Parser
 {
 public:
-    int openSubtitle(const QString &filePath);
-    Subtitle *loadSubtitle(enum SubParseError *err);
+    // Files ending with .gz and .zip are decompressed while read
+    virtual int openSubtitle(const QString &filePath);
+    static bool isCompressed(const QString &filePath);
+    static QString subtitleSuffix(const QString &filePath);
+    enum SubParseError loadSubtitles(SubtitleList &subtitles,
+                                     SubParseResult *result);
     void closeSubtitle();
-    QString getSubtitleText(Subtitle *subtitle);
-    Subtitle *newSubtitle(int index,
-                          unsigned int startTime,
-                          unsigned int endTime,
-                          const QString &text);
-    Subtitle *newSubtitle(int index,
-                          unsigned int startTime,
-                          unsigned int endTime,
-                          unsigned int startFrame,
-                          unsigned int endFrame,
-                          const QString &text);
-    Subtitle *newSubtitle(int index,
-                          const QTime &startTime,
-                          const QTime &endTime,
-                          const QString &text);
-    void freeSubtitle(Subtitle *subtitle);
+    QString getSubtitleText(const Subtitle *subtitle);
     void setFps(double fps);
+    double getFps();
+    // Name of the codec detected for the opened file, empty if none
+    QString getCodecName();
     void setFallbackCodec(const QString &fallbackCodec);
+    // Continue from the next cue after an error instead of stopping
+    void setRecovery(bool enabled);
+
+    /*
+     * Push mode, bytes are fed in chunks of any size instead of reading an
+     * opened file. Completed subtitles are appended to the list on each call
+     * and a partial line or cue is kept until the next one.
+     */
+    void beginFeed(SubParseResult *result, QTextCodec *codec = nullptr);
+    bool feed(const QByteArray &bytes, SubtitleList &subtitles,
+              SubParseResult *result);
+    void endFeed(SubtitleList &subtitles, SubParseResult *result);
 
-    virtual Subtitle *parseSubtitle(enum SubParseError *err) = 0;
-    virtual void updateFPS(Subtitle *subtitle) = 0;
+    /*
+     * Parse all subtitles from the opened file to the end of list. Text
+     * engines get the lines one by one with parseLine(), engines for other
+     * formats can read the file themselves.
+     */
+    virtual void parseSubtitles(SubtitleList &subtitles,
+                                SubParseResult *result);
+    // False stops parsing, state of the cue is kept between lines
+    virtual bool parseLine(QString &line, SubtitleList &subtitles,
+                           SubParseResult *result);
+    // End of input, append the cue not terminated by an empty line
+    virtual void finishLines(SubtitleList &subtitles, SubParseResult *result);
+    virtual void updateFPS(SubtitleList &subtitles) = 0;
+    // Subtitle tracks of container files, selected before parsing
+    virtual SubTrackList getTracks();
+    virtual bool selectTrack(int number);
+    virtual int getSelectedTrack();
+    // Format of the parsed file for SubtitleWriter, empty if not writable
+    virtual QString getFormat();
     virtual bool needFPSUpdate() = 0;
     virtual void initializeParser() = 0;
 
     Parser();
-    ~Parser();
+    virtual ~Parser();
 
 protected:
-    QTextCodec *detectEncoding(QFile* file);
+    QTextCodec *detectEncoding(QIODevice* file);
     bool checkFileMIME(const QString &filepath);
+    bool checkDataMIME(const QString &name, QIODevice *device);
     QTime timeStrToQTime(const QString &str);
+    unsigned int timeToMs(const QTime &time);
     unsigned int frameToTimestampMs(const unsigned int frame);
+    bool readLine(QString &line);
+    void appendSubtitle(SubtitleList &subtitles, SubParseResult *result,
+                        int index, unsigned int startTime,
+                        unsigned int endTime, const QString &text);
+    void appendSubtitle(SubtitleList &subtitles, SubParseResult *result,
+                        int index, unsigned int startTime,
+                        unsigned int endTime, unsigned int startFrame,
+                        unsigned int endFrame, const QString &text);
+    void setParseError(SubParseResult *result, enum SubParseError err);
+    bool recoverError(SubParseResult *result, enum SubParseError err);
+    static void initResult(SubParseResult *result);
+    void releaseFile();
 
     QFile* iSubfile;
-    QTextStream* iInStream;
+    QIODevice* iInput; // File itself or decompressing it
+    LineReader iReader;
     double iFps;
     QString iFallbackCodec;
+    QString iCodecName;
     QString iTimeStampPattern;
+    int iLineNumber;
+    qint64 iLineOffset;
+    bool iRecovery;
 
 private:
-    unsigned int timestampToMs(const char *timestamp);
-    unsigned int timestampToMs(QTime &time);
     QTextCodec *useFallbackCodec();
+    bool checkMIME(const QMimeType &mime);
+    int openCompressed();
+    bool parseFedLines(SubtitleList &subtitles, SubParseResult *result);
 };
 
 #endif // PARSER_H
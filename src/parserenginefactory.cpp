@@ -18,17 +18,223 @@
  */
 
 #include "parserenginefactory.h"
+#include "parserplugin.h"
 
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLibrary>
+#include <QMutexLocker>
+#include <QPluginLoader>
+#include <QtDebug>
+
+// Longest magic bytes read from a file
+#define PARSER_MAGIC_MAX 16
+
+Q_IMPORT_PLUGIN(SrtParserPlugin)
+Q_IMPORT_PLUGIN(SubParserPlugin)
+Q_IMPORT_PLUGIN(MkvParserPlugin)
+Q_IMPORT_PLUGIN(Mp4ParserPlugin)
+
+ParserEngineFactory::ParserEngineFactory() :
+    iScanned(false)
+{
+}
+
+ParserEngineFactory::~ParserEngineFactory()
+{
+    qDeleteAll(iLoaders);
+}
+
+void ParserEngineFactory::addEngine(const QJsonObject &metaData,
+                                    const QStaticPlugin &staticPlugin,
+                                    const QString &fileName)
+{
+    QJsonObject manifest = metaData.value(QStringLiteral("MetaData")).toObject();
+    EngineInfo engine;
+
+    if (metaData.value(QStringLiteral("IID")).toString() !=
+                QLatin1String(ParserPlugin_iid))
+        return;
+
+    for (const QJsonValue &suffix : manifest.value(QStringLiteral("suffixes")).toArray())
+        engine.suffixes.append(suffix.toString().toLower());
+
+    // Hex string of bytes at the start or an object with an offset
+    for (const QJsonValue &value : manifest.value(QStringLiteral("magic")).toArray()) {
+        QJsonObject object = value.toObject();
+        EngineMagic magic;
+
+        if (value.isObject()) {
+            magic.offset = object.value(QStringLiteral("offset")).toInt();
+            magic.bytes = QByteArray::fromHex(object.value(QStringLiteral("bytes")).toString().toLatin1());
+        } else {
+            magic.offset = 0;
+            magic.bytes = QByteArray::fromHex(value.toString().toLatin1());
+        }
+
+        if (!magic.bytes.isEmpty() &&
+                magic.offset + magic.bytes.size() <= PARSER_MAGIC_MAX)
+            engine.magic.append(magic);
+    }
+
+    engine.container = manifest.value(QStringLiteral("container")).toBool();
+    engine.staticPlugin = staticPlugin;
+    engine.fileName = fileName;
+    engine.plugin = nullptr;
+
+    qDebug() << "parser engine for" << engine.suffixes <<
+                (fileName.isEmpty() ? QStringLiteral("built in") : fileName);
+
+    iEngines.append(engine);
+}
+
+// Read the manifests, plugins in the plugin directory override built-in ones
+void ParserEngineFactory::scan()
+{
+    QVector<QStaticPlugin> plugins = QPluginLoader::staticPlugins();
+    QStaticPlugin none = { nullptr, nullptr };
+    QDir dir(QCoreApplication::applicationDirPath() +
+             QStringLiteral("/../share/") + QCoreApplication::applicationName() +
+             QStringLiteral("/plugins"));
+
+    iScanned = true;
+
+    for (const QString &name : dir.entryList(QDir::Files)) {
+        QString fileName = dir.absoluteFilePath(name);
+
+        if (QLibrary::isLibrary(fileName))
+            addEngine(QPluginLoader(fileName).metaData(), none, fileName);
+    }
+
+    for (const QStaticPlugin &plugin : plugins)
+        addEngine(plugin.metaData(), plugin, QString());
+}
+
+Parser* ParserEngineFactory::createParser(EngineInfo &engine)
+{
+    QObject *instance;
+
+    if (!engine.plugin) {
+        if (engine.fileName.isEmpty()) {
+            // Creates only this one, unlike QPluginLoader::staticInstances()
+            instance = engine.staticPlugin.instance();
+        } else {
+            QPluginLoader *loader = new QPluginLoader(engine.fileName);
+
+            instance = loader->instance();
+            if (!instance) {
+                qWarning() << "cannot load parser plugin" << engine.fileName <<
+                              loader->errorString();
+                delete loader;
+                return nullptr;
+            }
+
+            iLoaders.append(loader);
+        }
+
+        engine.plugin = qobject_cast<ParserPlugin *>(instance);
+        if (!engine.plugin)
+            return nullptr;
+    }
+
+    return engine.plugin->createParser();
+}
 
 Parser* ParserEngineFactory::getEngine(const QString &fileEnding)
 {
-    if (engines.contains(fileEnding.toLower()))
-         return engines[fileEnding.toLower()]();
+    QMutexLocker locker(&iMutex);
+    QString suffix = fileEnding.toLower();
+
+    if (!iScanned)
+        scan();
+
+    for (EngineInfo &engine : iEngines) {
+        if (engine.suffixes.contains(suffix))
+            return createParser(engine);
+    }
+
+    return nullptr;
+}
+
+Parser* ParserEngineFactory::detectEngine(const QString &path)
+{
+    QMutexLocker locker(&iMutex);
+    QFile file(path);
+    QByteArray header;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    header = file.read(PARSER_MAGIC_MAX);
+
+    if (!iScanned)
+        scan();
+
+    for (EngineInfo &engine : iEngines) {
+        for (const EngineMagic &magic : engine.magic) {
+            if (header.mid(magic.offset, magic.bytes.size()) == magic.bytes)
+                return createParser(engine);
+        }
+    }
 
     return nullptr;
 }
 
-void ParserEngineFactory::registerEngine(const QString &type, ParserEngine parser)
+bool ParserEngineFactory::isSupported(const QString &fileEnding)
 {
-    engines[type.toLower()] = parser;
+    QMutexLocker locker(&iMutex);
+    QString suffix = fileEnding.toLower();
+
+    if (!iScanned)
+        scan();
+
+    for (const EngineInfo &engine : iEngines) {
+        if (engine.suffixes.contains(suffix))
+            return true;
+    }
+
+    return false;
+}
+
+QStringList ParserEngineFactory::supportedSuffixes(bool containers)
+{
+    QMutexLocker locker(&iMutex);
+    QStringList suffixes;
+
+    if (!iScanned)
+        scan();
+
+    for (const EngineInfo &engine : iEngines) {
+        if (containers || !engine.container)
+            suffixes.append(engine.suffixes);
+    }
+
+    suffixes.removeDuplicates();
+
+    return suffixes;
+}
+
+QStringList ParserEngineFactory::nameFilters(bool containers)
+{
+    QStringList filters;
+
+    // Containers are not read compressed
+    for (const QString &suffix : supportedSuffixes(false))
+        filters << QStringLiteral("*.") + suffix <<
+                   QStringLiteral("*.") + suffix + QStringLiteral(".gz");
+
+    filters << QStringLiteral("*.zip");
+
+    if (!containers)
+        return filters;
+
+    for (const QString &suffix : supportedSuffixes(true)) {
+        if (!filters.contains(QStringLiteral("*.") + suffix))
+            filters << QStringLiteral("*.") + suffix;
+    }
+
+    return filters;
 }
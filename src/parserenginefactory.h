@@ -20,9 +20,25 @@
 #ifndef PARSERENGINEFACTORY_H
 #define PARSERENGINEFACTORY_H
 
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QtPlugin>
+#include <QStringList>
+#include <QVector>
 #include "parser.h"
-#include <functional>
 
+class ParserPlugin;
+class QJsonObject;
+class QPluginLoader;
+
+/*
+ * Parser engines are Qt plugins. The built-in ones are linked in as static
+ * plugins and others are loaded from the plugin directory of the
+ * application. Only the JSON metadata of the plugins is read at the first
+ * lookup, a plugin is loaded when a file of its type is opened. Safe to use
+ * from the prefetch thread.
+ */
 class ParserEngineFactory
 {
 public:
@@ -31,20 +47,41 @@ public:
             return inst;
     }
 
-    using ParserEngine = std::function<Parser*()>;
     Parser* getEngine(const QString &fileEnding);
-    void registerEngine(const QString &type, ParserEngine parser);
+    // Engine by the magic bytes near the start of the file
+    Parser* detectEngine(const QString &path);
+    bool isSupported(const QString &fileEnding);
+    // Containers are videos with subtitle tracks, marked in the manifest
+    QStringList supportedSuffixes(bool containers = true);
+    // Patterns of the readable files, also the compressed subtitle files
+    QStringList nameFilters(bool containers = true);
+
 private:
-    ParserEngineFactory() {};
-    QMap<QString, ParserEngine> engines;
-};
+    typedef struct _EngineMagic {
+        int offset;
+        QByteArray bytes;
+    } EngineMagic;
 
-template <typename T>
-class ParserRegistrar {
-public:
-    ParserRegistrar(const QString& name) {
-        ParserEngineFactory::instance().registerEngine(name, []() -> Parser* { return new T(); });
-    }
+    typedef struct _EngineInfo {
+        QStringList suffixes;
+        QList<EngineMagic> magic;
+        bool container;
+        QStaticPlugin staticPlugin;
+        QString fileName;      // Of a dynamic plugin, empty if static
+        ParserPlugin *plugin;  // Once loaded
+    } EngineInfo;
+
+    ParserEngineFactory();
+    ~ParserEngineFactory();
+    void scan();
+    void addEngine(const QJsonObject &metaData,
+                   const QStaticPlugin &staticPlugin, const QString &fileName);
+    Parser* createParser(EngineInfo &engine);
+
+    QMutex iMutex;
+    QVector<EngineInfo> iEngines;
+    QList<QPluginLoader *> iLoaders;
+    bool iScanned;
 };
 
 #endif // PARSERENGINEFACTORY_H
@@ -0,0 +1,48 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSERPLUGIN_H
+#define PARSERPLUGIN_H
+
+#include <QObject>
+#include <QtPlugin>
+#include "parser.h"
+
+#define ParserPlugin_iid "org.harbour.subsail.ParserPlugin/1.0"
+
+/*
+ * Qt plugin interface of a parser engine. The JSON metadata of the plugin
+ * lists the file suffixes and the magic bytes at the start of the file, hex
+ * encoded, the engine reads:
+ *
+ *   { "suffixes": [ "mkv", "webm" ], "magic": [ "1a45dfa3" ] }
+ *
+ * The metadata is read without loading the plugin, the plugin is loaded and
+ * instantiated only when a file needs it.
+ */
+class ParserPlugin
+{
+public:
+    virtual ~ParserPlugin() {}
+    virtual Parser *createParser() = 0;
+};
+
+Q_DECLARE_INTERFACE(ParserPlugin, ParserPlugin_iid)
+
+#endif // PARSERPLUGIN_H
@@ -0,0 +1,221 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "playbackcursor.h"
+#include "cueeditor.h"
+
+#include <climits>
+#include <QtDebug>
+
+static unsigned int getUnsigned(int value, bool *add)
+{
+    if (value < 0) {
+        *add = false;
+
+        if (value == INT_MIN)
+            return static_cast<unsigned int>(static_cast<unsigned int>(INT_MAX) + 1u);
+
+        return static_cast<unsigned int>(-value);
+    } else {
+        *add = true;
+        return static_cast<unsigned int>(value);
+    }
+}
+
+PlaybackCursor::PlaybackCursor() :
+    iTable(new CueTable(SubtitleList())),
+    iEditor(nullptr)
+{
+    reset();
+}
+
+void PlaybackCursor::setTable(const CueTableRef &table)
+{
+    iTable = table;
+    iEditor = nullptr;
+    iPosition = -1;
+    iState = SUB_STATE_INIT;
+    iNextChange = 0;
+}
+
+// Positions of the editor are not the ones of the table, resolve them again
+void PlaybackCursor::setEditor(const CueEditor *editor)
+{
+    iEditor = editor;
+    iPosition = -1;
+    iState = SUB_STATE_INIT;
+    iNextChange = 0;
+}
+
+int PlaybackCursor::size() const
+{
+    return iEditor ? iEditor->size() : iTable->size();
+}
+
+const Subtitle &PlaybackCursor::cue(int position)
+{
+    if (!iEditor)
+        return iTable->at(position);
+
+    iEditorCue = iEditor->at(position);
+
+    return iEditorCue;
+}
+
+void PlaybackCursor::setOffset(int offset)
+{
+    iOffset = offset;
+    iOffsetUnsigned = getUnsigned(offset, &iOffsetAdd);
+}
+
+void PlaybackCursor::reset()
+{
+    iState = SUB_STATE_INIT;
+    iTime = 0;
+    iNextChange = 0;
+    iPosition = -1;
+    setOffset(0);
+}
+
+unsigned int PlaybackCursor::offsetTime(unsigned int time) const
+{
+    if (iOffsetAdd)
+        return time + iOffsetUnsigned;
+
+    // In case the subtraction would undeflow.
+    if (time <= iOffsetUnsigned)
+        return 0;
+
+    return time - iOffsetUnsigned;
+}
+
+/*
+ * Lookups in the table with this time find the same subtitle as with the
+ * offset applied to each one.
+ */
+unsigned int PlaybackCursor::tableTime(unsigned int time) const
+{
+    if (iOffsetAdd)
+        return time > iOffsetUnsigned ? time - iOffsetUnsigned : 0;
+
+    if (!time)
+        return 0;
+
+    return time > UINT_MAX - iOffsetUnsigned ? UINT_MAX : time + iOffsetUnsigned;
+}
+
+unsigned int PlaybackCursor::applyOffset(unsigned int time, int offset)
+{
+    bool add;
+    unsigned int value = getUnsigned(offset, &add);
+
+    if (add)
+        return time + value;
+
+    return time <= value ? 0 : time - value;
+}
+
+bool PlaybackCursor::isBeforeStart(unsigned int time) const
+{
+    return iOffset < 0 && time <= static_cast<unsigned int>(INT_MAX) &&
+            static_cast<int>(time) + iOffset < 0;
+}
+
+void PlaybackCursor::seek(unsigned int time)
+{
+    const Subtitle *subtitle;
+    unsigned int start;
+    unsigned int end;
+
+    iTime = time;
+
+    if (!size()) {
+        iState = SUB_STATE_INIT;
+        return;
+    }
+
+    if (isBeforeStart(time)) {
+        iState = SUB_STATE_INIT_DELAY;
+        iNextChange = static_cast<unsigned int>(-iOffset);
+        qDebug() << "set init delay with offset" << iOffset << "to" << iNextChange - time;
+        return;
+    }
+
+    if (iEditor)
+        iPosition = iEditor->findPosition(tableTime(time));
+    else
+        iPosition = iTable->findPosition(tableTime(time), iPosition);
+
+    if (iPosition >= size()) {
+        iState = SUB_STATE_END;
+        iPosition = size() - 1;
+        iNextChange = UINT_MAX;
+        // Read for current()
+        cue(iPosition);
+        return;
+    }
+
+    subtitle = &cue(iPosition);
+    start = offsetTime(subtitle->start_time);
+    end = offsetTime(subtitle->end_time);
+
+    if (start > time) {
+        iState = SUB_STATE_DELAY;
+        iNextChange = start;
+    } else {
+        iState = SUB_STATE_DURATION;
+        iNextChange = end < UINT_MAX ? end + 1 : UINT_MAX;
+    }
+}
+
+/*
+ * Time before the next change is enough in most cases. Otherwise the state is
+ * resolved from the absolute time as seek() does, to avoid walking over each
+ * subtitle in between.
+ */
+void PlaybackCursor::advance(unsigned int elapsed)
+{
+    iTime += elapsed;
+
+    switch (iState) {
+    case SUB_STATE_INIT:
+    case SUB_STATE_END:
+        return;
+    default:
+        break;
+    }
+
+    if (iTime < iNextChange)
+        return;
+
+    seek(iTime);
+}
+
+int PlaybackCursor::displayed() const
+{
+    return iState == SUB_STATE_DURATION ? iPosition : -1;
+}
+
+const Subtitle *PlaybackCursor::current() const
+{
+    if (iPosition < 0 || iPosition >= size())
+        return nullptr;
+
+    return iEditor ? &iEditorCue : &iTable->at(iPosition);
+}
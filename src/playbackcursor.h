@@ -0,0 +1,88 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYBACKCURSOR_H
+#define PLAYBACKCURSOR_H
+
+#include "cuetable.h"
+#include "types.h"
+
+class CueEditor;
+
+/*
+ * Playback position over a cue table. The state is resolved with the const
+ * queries of the table when seeking, after that only the time of the next
+ * change is compared while the playback advances. Any number of cursors can
+ * share a table. Edits not yet in a table are followed by reading the cue
+ * editor instead, at O(log n) a seek.
+ *
+ * Times are playback times, the offset is added to the subtitles. A negative
+ * offset delays the start until the playback time has covered it.
+ */
+class PlaybackCursor
+{
+public:
+    PlaybackCursor();
+
+    // Position is resolved again on the next seek
+    void setTable(const CueTableRef &table);
+    // Cues are read from the editor until a table is set again
+    void setEditor(const CueEditor *editor);
+    void setOffset(int offset);
+    void reset();
+
+    void seek(unsigned int time);
+    void advance(unsigned int elapsed);
+
+    unsigned int time() const { return iTime; }
+    int offset() const { return iOffset; }
+    SubState state() const { return iState; }
+    // Position of the subtitle shown or waited for, -1 before the first seek
+    int position() const { return iPosition; }
+    // Position of the subtitle shown, -1 when none is
+    int displayed() const;
+    const Subtitle *current() const;
+
+    // Time of the subtitle in the table shifted by the offset
+    unsigned int offsetTime(unsigned int time) const;
+    // Smallest time in the table that maps to the given time or later
+    unsigned int tableTime(unsigned int time) const;
+    // Negative offset has not been covered yet at the time
+    bool isBeforeStart(unsigned int time) const;
+
+    // Time shifted by the offset, 0 when a negative one covers it
+    static unsigned int applyOffset(unsigned int time, int offset);
+
+private:
+    int size() const;
+    const Subtitle &cue(int position);
+
+    CueTableRef iTable;
+    const CueEditor *iEditor;
+    Subtitle iEditorCue; // Copy of the cue at the position read from the editor
+    SubState iState;
+    unsigned int iTime;
+    unsigned int iNextChange;
+    int iPosition;
+    int iOffset;
+    unsigned int iOffsetUnsigned;
+    bool iOffsetAdd;
+};
+
+#endif // PLAYBACKCURSOR_H
@@ -0,0 +1,47 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SINGLEBYTEDECODER_H
+#define SINGLEBYTEDECODER_H
+
+#include <QString>
+
+/*
+ * Decoder of single byte character sets with a 256 entry table per set.
+ * Used instead of QTextCodec for the common fallback codecs of subtitles.
+ * Every byte is a complete character so no state is kept between calls,
+ * and ASCII runs are widened without table lookups.
+ */
+class SingleByteDecoder
+{
+public:
+    // nullptr when the set is not built in
+    static const SingleByteDecoder *forMib(int mib);
+
+    // Replaces the content of text, its capacity is reused
+    void toUnicode(const char *data, int length, QString &text) const;
+
+private:
+    SingleByteDecoder(int mib, const ushort *table);
+
+    int iMib;
+    const ushort *iTable;
+};
+
+#endif // SINGLEBYTEDECODER_H
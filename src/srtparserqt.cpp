@@ -19,102 +19,157 @@
 
 #include "srtparserqt.h"
 
-#include <QRegularExpression>
 #include <QTime>
 
-SrtParserQt::SrtParserQt()
+SrtParserQt::SrtParserQt() :
+    iControlCode(QStringLiteral(R"(\s*(<(?:i|b|u)>))"))
 {
     iTimeStampPattern = QString("hh:mm:ss,zzz");
+    initializeParser();
 }
 
-Subtitle* SrtParserQt::parseSubtitle(enum SubParseError *err)
+/*
+ * Timestamp line "start --> end", position coordinates after the end time
+ * are ignored and a dot is accepted as the millisecond separator.
+ */
+bool SrtParserQt::parseTimestamps(const QString &line, unsigned int &startTime,
+                                  unsigned int &endTime)
 {
-    QString text;
-    QStringList parts;
-    QTime startTime;
-    QTime endTime;
-    QRegularExpression controlCode(QStringLiteral(R"(\s*(<(?:i|b|u)>))"));
-    bool result;
-    int index = -1;
-    enum srtReadState state = SRT_READ_INDEX;
-
-    *err = SUB_PARSE_ERROR_NONE;
-
-    if (!iInStream) {
-        *err = SUB_PARSE_ERROR_INVALID_FILE;
-        return nullptr;
-    }
+    QStringList parts = line.split(" --> ");
+    QTime start;
+    QTime end;
 
-    if (iInStream->atEnd()) {
-        *err = SUB_PARSE_ERROR_EOF;
-        return nullptr;
-    }
+    if (parts.size() != 2)
+        return false;
 
-    while (!iInStream->atEnd() && state < SRT_READ_STOP) {
-        QString line = iInStream->readLine().trimmed();
-        if (line.isEmpty() && state == SRT_READ_INDEX)
-            continue;
-
-        switch (state) {
-        case SRT_READ_INDEX:
-            index = line.toInt(&result);
-            if (!result) {
-                qDebug() << "invalid index" << line;
-                *err = SUB_PARSE_ERROR_INVALID_INDEX;
-                return nullptr;
-            }
+    start = timeStrToQTime(parts[0].trimmed().replace('.', ','));
+    end = timeStrToQTime(parts[1].trimmed().section(' ', 0, 0).replace('.', ','));
 
-            state = SRT_READ_TIMESTAMP;
-            break;
-        case SRT_READ_TIMESTAMP:
-            parts = line.split(" --> ");
-            if (parts.size() != 2) {
-                qDebug() << "invalid timestamp" << line;
-                *err = SUB_PARSE_ERROR_INVALID_TIMESTAMP;
-                return nullptr;
-            }
+    if (!start.isValid() || !end.isValid())
+        return false;
 
-            startTime = timeStrToQTime(parts[0]);
-            endTime   = timeStrToQTime(parts[1]);
+    startTime = timeToMs(start);
+    endTime = timeToMs(end);
 
-            state = SRT_READ_TEXT;
-            break;
-        case SRT_READ_TEXT:
-            if (line.isEmpty()) {
-                state = SRT_READ_STOP;
-                break;
-            }
+    return true;
+}
 
-            if (!text.isEmpty())
-                text.append(QStringLiteral("<br>").toUtf8());
+void SrtParserQt::initializeParser()
+{
+    iState = SRT_READ_INDEX;
+    iIndex = -1;
+    iStartTime = 0;
+    iEndTime = 0;
+    iText.clear();
+    iContent = false;
+}
 
-            // Some srt files can have tags without space, add them
-            line = line.replace(controlCode, " \\1").toUtf8();
+bool SrtParserQt::parseLine(QString &line, SubtitleList &subtitles,
+                            SubParseResult *result)
+{
+    bool ok;
 
-            // And add appropriate newline markers
-            text.append(line.replace("\n", QStringLiteral("<br>")));
+    line = line.trimmed();
 
+    switch (iState) {
+    case SRT_READ_INDEX:
+        if (line.isEmpty()) {
+            result->skipped++;
+            return true;
+        }
+
+        iContent = true;
+        iIndex = line.toInt(&ok);
+        if (ok) {
+            iState = SRT_READ_TIMESTAMP;
             break;
-        case SRT_READ_STOP:
+        }
+
+        qDebug() << "invalid index" << line;
+        if (!recoverError(result, SUB_PARSE_ERROR_INVALID_INDEX))
+            return false;
+
+        // Index may be missing, table renumbers the cues
+        if (parseTimestamps(line, iStartTime, iEndTime)) {
+            iIndex = 0;
+            iText.clear();
+            iState = SRT_READ_TEXT;
+        } else {
+            result->skipped++;
+            iState = SRT_READ_RESYNC;
+        }
+
+        break;
+    case SRT_READ_TIMESTAMP:
+        if (parseTimestamps(line, iStartTime, iEndTime)) {
+            iText.clear();
+            iState = SRT_READ_TEXT;
             break;
         }
-    }
 
-    if (index < 0) {
-        qDebug() << "cannot parse subtitle line";
-        *err = SUB_PARSE_ERROR_INVALID_FILE;
-        return nullptr;
+        qDebug() << "invalid timestamp" << line;
+        if (!recoverError(result, SUB_PARSE_ERROR_INVALID_TIMESTAMP))
+            return false;
+
+        result->skipped++;
+        iState = line.isEmpty() ? SRT_READ_INDEX : SRT_READ_RESYNC;
+        break;
+    case SRT_READ_TEXT:
+        if (line.isEmpty()) {
+            appendSubtitle(subtitles, result, iIndex, iStartTime, iEndTime,
+                           iText);
+            iState = SRT_READ_INDEX;
+            break;
+        }
+
+        if (!iText.isEmpty())
+            iText.append(QStringLiteral("<br>"));
+
+        // Some srt files can have tags without space, add them
+        iText.append(line.replace(iControlCode, " \\1"));
+
+        break;
+    case SRT_READ_RESYNC:
+        // Skip the broken cue until the next plausible cue header
+        if (line.isEmpty()) {
+            iState = SRT_READ_INDEX;
+        } else if (parseTimestamps(line, iStartTime, iEndTime)) {
+            iIndex = 0;
+            iText.clear();
+            iState = SRT_READ_TEXT;
+            break;
+        } else {
+            iIndex = line.toInt(&ok);
+            if (ok) {
+                iState = SRT_READ_TIMESTAMP;
+                break;
+            }
+        }
+
+        result->skipped++;
+        break;
+    case SRT_READ_STOP:
+        break;
     }
 
-    return newSubtitle(index, startTime, endTime, text);
+    return true;
 }
 
-void SrtParserQt::updateFPS(Subtitle *subtitle)
+void SrtParserQt::finishLines(SubtitleList &subtitles, SubParseResult *result)
 {
-    if (!subtitle) // Avoid warn
-        return;
-    return;
-}
+    // Last subtitle may not be followed by an empty line
+    if (iState == SRT_READ_TEXT)
+        appendSubtitle(subtitles, result, iIndex, iStartTime, iEndTime, iText);
+
+    iState = SRT_READ_INDEX;
 
-ParserRegistrar<SrtParserQt> SrtParserQt::registrar("srt");
+    if (iContent && !result->cues) {
+        qDebug() << "cannot parse subtitle lines";
+        setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+    }
+}
 
+void SrtParserQt::updateFPS(SubtitleList &subtitles)
+{
+    Q_UNUSED(subtitles);
+}
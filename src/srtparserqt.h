@@ -21,12 +21,15 @@
 #define SRTPARSERQT_H
 
 #include "parser.h"
-#include "parserenginefactory.h"
+#include "parserplugin.h"
+
+#include <QRegularExpression>
 
 enum srtReadState {
     SRT_READ_INDEX = 0,
     SRT_READ_TIMESTAMP,
     SRT_READ_TEXT,
+    SRT_READ_RESYNC,
     SRT_READ_STOP
 };
 
@@ -37,14 +40,37 @@ public:
 
     // Parser interface
 public:
-    Subtitle *parseSubtitle(enum SubParseError *err);
-    void updateFPS(Subtitle *subtitle);
+    bool parseLine(QString &line, SubtitleList &subtitles,
+                   SubParseResult *result);
+    void finishLines(SubtitleList &subtitles, SubParseResult *result);
+    void updateFPS(SubtitleList &subtitles);
     bool needFPSUpdate() { return false; };
-    void initializeParser() { return; };
+    void initializeParser();
+    QString getFormat() { return QStringLiteral("srt"); };
 
 private:
-    static ParserRegistrar<SrtParserQt> registrar;
+    bool parseTimestamps(const QString &line, unsigned int &startTime,
+                         unsigned int &endTime);
+
+    QRegularExpression iControlCode;
+
+    // Cue being read, kept between lines fed in push mode
+    enum srtReadState iState;
+    int iIndex;
+    unsigned int iStartTime;
+    unsigned int iEndTime;
+    QString iText;
+    bool iContent;
+};
 
+class SrtParserPlugin : public QObject, public ParserPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ParserPlugin_iid FILE "srtparserqt.json")
+    Q_INTERFACES(ParserPlugin)
+
+public:
+    Parser *createParser() { return new SrtParserQt(); }
 };
 
 #endif // SRTPARSERQT_H
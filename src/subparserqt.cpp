@@ -19,25 +19,29 @@
 
 #include "subparserqt.h"
 
-#include <QRegularExpression>
 #include <QTime>
 #include <Qt>
 
-SubParserQt::SubParserQt()
+SubParserQt::SubParserQt() :
+    iRegexMicroDVD(R"(\{(\d+(?:\.\d+)?)\}\{(\d+(?:\.\d+)?)\}(.*))"),
+    iReplaceControlCode("\\{y:([ibu]+)\\}"),
+    iRemoveControlCode(R"(\{[^\}]+\})")
 {
     iSubtitleIndex = 0;
-    iTimeStampPattern = QString("hh:mm:ss.z");
+    iTimeStampPattern = QString("hh:mm:ss.zzz");
     iType = SUB_TYPE_UNSET;
     iNeedFPSUpdate = true;
+    iViewerState = SUBVIEWER_READ_TIMESTAMP;
+    iStartTime = 0;
+    iEndTime = 0;
 }
 
-void SubParserQt::updateFPS(Subtitle *subtitle)
+void SubParserQt::updateFPS(SubtitleList &subtitles)
 {
-    if (!subtitle)
-        return;
-
-    subtitle->start_time = frameToTimestampMs(subtitle->start_frame);
-    subtitle->end_time = frameToTimestampMs(subtitle->end_frame);
+    for (Subtitle &subtitle : subtitles) {
+        subtitle.start_time = frameToTimestampMs(subtitle.start_frame);
+        subtitle.end_time = frameToTimestampMs(subtitle.end_frame);
+    }
 }
 
 bool SubParserQt::needFPSUpdate()
@@ -45,10 +49,48 @@ bool SubParserQt::needFPSUpdate()
     return iFps == 0.0 && iNeedFPSUpdate ? true : false;
 }
 
+// Both share the .sub ending, known once the first line is read
+QString SubParserQt::getFormat()
+{
+    switch (iType) {
+    case SUB_TYPE_MICRODVD:
+        return QStringLiteral("microdvd");
+    case SUB_TYPE_SUBVIEWER:
+        return QStringLiteral("subviewer");
+    default:
+        break;
+    }
+
+    return QString();
+}
+
 void SubParserQt::initializeParser()
 {
     iType = SUB_TYPE_UNSET;
     iNeedFPSUpdate = true;
+    iSubtitleIndex = 0;
+    iViewerState = SUBVIEWER_READ_TIMESTAMP;
+    iText.clear();
+}
+
+/*
+ * SubViewer fractions are hundredths, "00:00:01.50" is 1500 ms. Pad the
+ * fraction to milliseconds, the "z" pattern would read it as 50 ms.
+ */
+unsigned int SubParserQt::viewerTimeToMs(const QString &str)
+{
+    QString time = str.trimmed();
+    int dot = time.lastIndexOf(QLatin1Char('.'));
+
+    if (dot < 0)
+        time.append(QLatin1Char('.'));
+    else
+        time.truncate(dot + 4);
+
+    while (time.size() - time.lastIndexOf(QLatin1Char('.')) <= 3)
+        time.append(QLatin1Char('0'));
+
+    return timeToMs(timeStrToQTime(time));
 }
 
 subType SubParserQt::checkSubtitleType(QString &firstLine)
@@ -82,9 +124,7 @@ subType SubParserQt::checkSubtitleType(QString &firstLine)
 
 QString SubParserQt::cleanupText(QString &text)
 {
-    QRegularExpression replaceControlCode("\\{y:([ibu]+)\\}");
-    QRegularExpression removeControlCode(R"(\{[^\}]+\})");
-    QRegularExpressionMatch match = replaceControlCode.match(text);
+    QRegularExpressionMatch match = iReplaceControlCode.match(text);
     QString openTags;
     QString closeTags;
 
@@ -108,7 +148,7 @@ QString SubParserQt::cleanupText(QString &text)
     }
 
     // Remove all control codes as they can contain colors etc.
-    text.remove(removeControlCode);
+    text.remove(iRemoveControlCode);
 
     // Then add the tags Label can understand to text
     if (match.hasMatch()) {
@@ -123,20 +163,19 @@ QString SubParserQt::cleanupText(QString &text)
     return text;
 }
 
-Subtitle *SubParserQt::parseMicroDVD(QString &line, SubParseError *err)
+bool SubParserQt::parseMicroDVD(QString &line, SubtitleList &subtitles,
+                                SubParseResult *result)
 {
-    QRegularExpression regexMicroDVD(R"(\{(\d+(?:\.\d+)?)\}\{(\d+(?:\.\d+)?)\}(.*))");
     QString text;
-    QStringList parts;
     unsigned int startTime;
     unsigned int endTime;
 
-    QRegularExpressionMatch match = regexMicroDVD.match(line);
+    QRegularExpressionMatch match = iRegexMicroDVD.match(line);
 
     if (!match.hasMatch()) {
         qDebug() << "failed to process line" << line;
-        *err = SUB_PARSE_ERROR_INVALID_FILE;
-        return nullptr;
+        result->skipped++;
+        return recoverError(result, SUB_PARSE_ERROR_INVALID_FILE);
     }
 
     // Some .sub files can have non-standard frames as floats caused by conversion
@@ -148,8 +187,8 @@ Subtitle *SubParserQt::parseMicroDVD(QString &line, SubParseError *err)
 
     if (!startFrame || !endFrame) {
         qDebug() << "Failed to parse frames on line:" << line;
-        *err = SUB_PARSE_ERROR_INVALID_TIMESTAMP;
-        return nullptr;
+        result->skipped++;
+        return recoverError(result, SUB_PARSE_ERROR_INVALID_TIMESTAMP);
     }
 
     // FPS info
@@ -159,80 +198,98 @@ Subtitle *SubParserQt::parseMicroDVD(QString &line, SubParseError *err)
         iNeedFPSUpdate = false;
 
         qDebug() << "Read FPS from file" << iFps;
-        return nullptr;
+        result->skipped++;
+        return true;
     }
 
     // Last one, reset the index counter
     if (text.compare("[END]", Qt::CaseInsensitive) == 0) {
         iSubtitleIndex = 0;
-        return nullptr;
+        result->skipped++;
+        return true;
     }
 
     startTime = frameToTimestampMs(startFrame);
     endTime = frameToTimestampMs(endFrame);
 
-    return newSubtitle(++iSubtitleIndex, startTime, endTime, startFrame, endFrame, text);
+    appendSubtitle(subtitles, result, ++iSubtitleIndex, startTime, endTime,
+                   startFrame, endFrame, text);
+
+    return true;
 }
 
-Subtitle *SubParserQt::parseSubtitleViewer(QString &line,SubParseError *err)
+bool SubParserQt::parseSubtitleViewer(QString &line, SubtitleList &subtitles,
+                                      SubParseResult *result)
 {
     QStringList parts;
-    QString textLine;
-    QString text;
-    QTime startTime;
-    QTime endTime;
+
+    Q_UNUSED(subtitles);
 
     /* Ignore all lines starting with tags */
     if (line.at(0).toLatin1() == '[') {
         qDebug() << "ignoring tag" << line;
-        *err = SUB_PARSE_ERROR_NONE;
-        return nullptr;
+        result->skipped++;
+        return true;
     }
 
     parts = line.split(",");
     if (parts.size() != 2) {
         qDebug() << "invalid timestamp" << line;
-        *err = SUB_PARSE_ERROR_INVALID_TIMESTAMP;
-        return nullptr;
-    }
+        if (!recoverError(result, SUB_PARSE_ERROR_INVALID_TIMESTAMP))
+            return false;
 
-    startTime = timeStrToQTime(parts[0]);
-    endTime = timeStrToQTime(parts[1]);
+        // Skip the text of the broken cue
+        result->skipped++;
+        iViewerState = SUBVIEWER_SKIP_TEXT;
+        return true;
+    }
 
-    while (!iInStream->atEnd()) {
-        textLine = iInStream->readLine().trimmed();
+    iStartTime = viewerTimeToMs(parts[0]);
+    iEndTime = viewerTimeToMs(parts[1]);
+    iText.clear();
+    iViewerState = SUBVIEWER_READ_TEXT;
 
-        if (textLine.isEmpty())
-            break;
+    return true;
+}
 
-        if (!text.isEmpty())
-            text.append(QStringLiteral("<br>").toUtf8());
+bool SubParserQt::parseSubtitleViewerText(QString &line,
+                                          SubtitleList &subtitles,
+                                          SubParseResult *result)
+{
+    // Text of the cue ends with an empty line
+    if (line.isEmpty()) {
+        if (iViewerState == SUBVIEWER_READ_TEXT)
+            appendSubtitle(subtitles, result, ++iSubtitleIndex, iStartTime,
+                           iEndTime, iText);
+
+        iViewerState = SUBVIEWER_READ_TIMESTAMP;
+        return true;
+    }
 
-        text.append(textLine.replace("[br]", QStringLiteral("<br>")));
+    if (iViewerState == SUBVIEWER_SKIP_TEXT) {
+        result->skipped++;
+        return true;
     }
 
-    return newSubtitle(++iSubtitleIndex, startTime, endTime, text);
+    if (!iText.isEmpty())
+        iText.append(QStringLiteral("<br>"));
+
+    iText.append(line.replace("[br]", QStringLiteral("<br>")));
+
+    return true;
 }
 
-Subtitle *SubParserQt::parseSubtitle(enum SubParseError *err)
+bool SubParserQt::parseLine(QString &line, SubtitleList &subtitles,
+                            SubParseResult *result)
 {
-    *err = SUB_PARSE_ERROR_NONE;
-
-    if (!iInStream) {
-        *err = SUB_PARSE_ERROR_INVALID_FILE;
-        return nullptr;
-    }
+    line = line.trimmed();
 
-    if (iInStream->atEnd()) {
-        iSubtitleIndex = 0;
-        *err = SUB_PARSE_ERROR_EOF;
-        return nullptr;
-    }
+    if (iViewerState != SUBVIEWER_READ_TIMESTAMP)
+        return parseSubtitleViewerText(line, subtitles, result);
 
-    QString line = iInStream->readLine().trimmed();
-    if (line.isEmpty() || line == QStringLiteral("\n")) {
-        qDebug() << "skip empty line";
-        return nullptr; // noerror
+    if (line.isEmpty()) {
+        result->skipped++;
+        return true;
     }
 
     /* Should be done only once */
@@ -242,15 +299,24 @@ Subtitle *SubParserQt::parseSubtitle(enum SubParseError *err)
     switch (iType) {
     case SUB_TYPE_UNSET:
         qWarning() << "cannot detect .sub file type";
-        *err = SUB_PARSE_ERROR_INVALID_FILE;
-        break;
+        setParseError(result, SUB_PARSE_ERROR_INVALID_FILE);
+        return false;
     case SUB_TYPE_MICRODVD:
-        return parseMicroDVD(line, err);
+        return parseMicroDVD(line, subtitles, result);
     case SUB_TYPE_SUBVIEWER:
-        return parseSubtitleViewer(line, err);
+        return parseSubtitleViewer(line, subtitles, result);
     }
 
-    return nullptr;
+    return true;
 }
 
-ParserRegistrar<SubParserQt> SubParserQt::registrar("sub");
+void SubParserQt::finishLines(SubtitleList &subtitles, SubParseResult *result)
+{
+    // Last SubViewer cue may not be followed by an empty line
+    if (iViewerState == SUBVIEWER_READ_TEXT)
+        appendSubtitle(subtitles, result, ++iSubtitleIndex, iStartTime,
+                       iEndTime, iText);
+
+    iViewerState = SUBVIEWER_READ_TIMESTAMP;
+    iSubtitleIndex = 0;
+}
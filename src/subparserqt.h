@@ -21,7 +21,9 @@
 #define SUBPARSERQT_H
 
 #include "parser.h"
-#include "parserenginefactory.h"
+#include "parserplugin.h"
+
+#include <QRegularExpression>
 
 typedef enum _subType {
     SUB_TYPE_UNSET = 0,
@@ -29,27 +31,59 @@ typedef enum _subType {
     SUB_TYPE_SUBVIEWER
 } subType;
 
+typedef enum _subViewerState {
+    SUBVIEWER_READ_TIMESTAMP = 0,
+    SUBVIEWER_READ_TEXT,
+    SUBVIEWER_SKIP_TEXT
+} subViewerState;
+
 class SubParserQt : public Parser
 {
 
 public:
     SubParserQt();
-    Subtitle *parseSubtitle(enum SubParseError *err);
-    void updateFPS(Subtitle *subtitle);
+    bool parseLine(QString &line, SubtitleList &subtitles,
+                   SubParseResult *result);
+    void finishLines(SubtitleList &subtitles, SubParseResult *result);
+    void updateFPS(SubtitleList &subtitles);
     bool needFPSUpdate();
     void initializeParser();
+    QString getFormat();
 
 private:
     int iSubtitleIndex;
     subType iType;
     bool iNeedFPSUpdate;
 
+    // SubViewer cue being read, kept between lines fed in push mode
+    subViewerState iViewerState;
+    unsigned int iStartTime;
+    unsigned int iEndTime;
+    QString iText;
+
+    QRegularExpression iRegexMicroDVD;
+    QRegularExpression iReplaceControlCode;
+    QRegularExpression iRemoveControlCode;
+
     QString cleanupText(QString &text);
+    unsigned int viewerTimeToMs(const QString &str);
     subType checkSubtitleType(QString &firstLine);
-    Subtitle *parseMicroDVD(QString &line, enum SubParseError *err);
-    Subtitle *parseSubtitleViewer(QString &line, enum SubParseError *err);
+    bool parseMicroDVD(QString &line, SubtitleList &subtitles,
+                       SubParseResult *result);
+    bool parseSubtitleViewer(QString &line, SubtitleList &subtitles,
+                             SubParseResult *result);
+    bool parseSubtitleViewerText(QString &line, SubtitleList &subtitles,
+                                 SubParseResult *result);
+};
+
+class SubParserPlugin : public QObject, public ParserPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID ParserPlugin_iid FILE "subparserqt.json")
+    Q_INTERFACES(ParserPlugin)
 
-    static ParserRegistrar<SubParserQt> registrar;
+public:
+    Parser *createParser() { return new SubParserQt(); }
 };
 
 #endif // SUBPARSERQT_H
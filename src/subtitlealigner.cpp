@@ -0,0 +1,231 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "subtitlealigner.h"
+
+#include <math.h>
+#include <QtDebug>
+
+// Conversions between 23.976, 24 and 25 fps
+static const double alignScales[] = {
+    1.0,
+    25.0 / 24.0, 24.0 / 25.0,
+    25.0 / 23.976, 23.976 / 25.0,
+    24.0 / 23.976, 23.976 / 24.0
+};
+
+static inline std::complex<float> multiply(const std::complex<float> &a,
+                                           const std::complex<float> &b)
+{
+    // Plain product, the library one checks for infinities
+    return std::complex<float>(a.real() * b.real() - a.imag() * b.imag(),
+                               a.real() * b.imag() + a.imag() * b.real());
+}
+
+SubtitleAligner::SubtitleAligner(const CueTable &reference,
+                                 const CueTable &subtitles) :
+    iSubtitles(subtitles)
+{
+    qint64 bins;
+    int bits = 0;
+
+    // Subtitles are at most 25 / 23.976 times longer when scaled
+    bins = qMax<qint64>(reference.totalTime(),
+                        subtitles.totalTime() * 25.0 / 23.976) / ALIGN_BIN_SIZE + 1;
+    iMaxLag = ALIGN_MAX_OFFSET / ALIGN_BIN_SIZE;
+
+    // Padding with the largest lag keeps the circular correlation from
+    // wrapping around
+    iSize = 1;
+    while (iSize < bins + iMaxLag) {
+        iSize <<= 1;
+        bits++;
+    }
+
+    iTwiddles.resize(iSize / 2);
+    for (int i = 0; i < iSize / 2; i++)
+        iTwiddles[i] = std::polar(1.0f, static_cast<float>(-2.0 * M_PI * i / iSize));
+
+    iReference.fill(Complex(0.0f, 0.0f), iSize);
+    iReferenceActive = buildSignal(reference, 1.0, iReference, false);
+    transform(iReference, false);
+
+    qDebug() << "aligning with" << iSize << "point transforms," << bits << "bits";
+}
+
+/*
+ * One for the bins where a subtitle is shown, to the real or the imaginary
+ * part. A difference array keeps this linear in subtitles and bins.
+ */
+qint64 SubtitleAligner::buildSignal(const CueTable &table, double scale,
+                                    QVector<Complex> &signal, bool imaginary)
+{
+    QVector<int> edges(iSize + 1, 0);
+    qint64 active = 0;
+    int level = 0;
+
+    for (const Subtitle &subtitle : table.subtitles()) {
+        qint64 start = static_cast<qint64>(subtitle.start_time * scale) / ALIGN_BIN_SIZE;
+        qint64 end = static_cast<qint64>(subtitle.end_time * scale) / ALIGN_BIN_SIZE;
+
+        if (start >= iSize)
+            continue;
+
+        edges[static_cast<int>(start)]++;
+        edges[static_cast<int>(qMin<qint64>(end, iSize))]--;
+    }
+
+    for (int i = 0; i < iSize; i++) {
+        float value;
+
+        level += edges.at(i);
+        value = level > 0 ? 1.0f : 0.0f;
+        active += level > 0;
+
+        if (imaginary)
+            signal[i].imag(value);
+        else
+            signal[i].real(value);
+    }
+
+    return active;
+}
+
+// In place iterative radix-2 FFT, inverse is not normalized
+void SubtitleAligner::transform(QVector<Complex> &data, bool inverse)
+{
+    Complex *values = data.data();
+
+    for (int i = 1, j = 0; i < iSize; i++) {
+        int bit = iSize >> 1;
+
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap(values[i], values[j]);
+    }
+
+    for (int length = 2; length <= iSize; length <<= 1) {
+        int half = length >> 1;
+        int step = iSize / length;
+
+        for (int i = 0; i < iSize; i += length) {
+            for (int k = 0; k < half; k++) {
+                Complex twiddle = iTwiddles.at(k * step);
+                Complex odd;
+
+                if (inverse)
+                    twiddle = std::conj(twiddle);
+
+                odd = multiply(values[i + k + half], twiddle);
+                values[i + k + half] = values[i + k] - odd;
+                values[i + k] += odd;
+            }
+        }
+    }
+}
+
+void SubtitleAligner::findPeak(double scale, qint64 active, bool imaginary,
+                               AlignResult &best)
+{
+    double norm;
+
+    if (!active || !iReferenceActive)
+        return;
+
+    norm = sqrt(static_cast<double>(active) * iReferenceActive) * iSize;
+
+    for (int lag = -iMaxLag; lag <= iMaxLag; lag++) {
+        int index = lag < 0 ? iSize + lag : lag;
+        const Complex &value = iWork.at(index);
+        double confidence = (imaginary ? value.imag() : value.real()) / norm;
+
+        if (confidence > best.confidence) {
+            best.confidence = confidence;
+            best.offset = lag * ALIGN_BIN_SIZE;
+            best.scale = scale;
+        }
+    }
+}
+
+/*
+ * Correlate the subtitles at two scales against the reference. The signals
+ * go to the real and imaginary parts of one transform, their spectra are
+ * separated by the symmetry of real signals, and the correlations come back
+ * from one inverse transform in the real and imaginary parts.
+ */
+void SubtitleAligner::correlate(double scale, double otherScale,
+                                AlignResult &best)
+{
+    const Complex half(0.5f, 0.0f);
+    const Complex minusHalfI(0.0f, -0.5f);
+    const Complex i(0.0f, 1.0f);
+    qint64 active;
+    qint64 otherActive = 0;
+
+    iWork.fill(Complex(0.0f, 0.0f), iSize);
+    active = buildSignal(iSubtitles, scale, iWork, false);
+    if (otherScale > 0.0)
+        otherActive = buildSignal(iSubtitles, otherScale, iWork, true);
+
+    transform(iWork, false);
+
+    for (int k = 0; k <= iSize / 2; k++) {
+        int n = (iSize - k) & (iSize - 1);
+        Complex z = iWork.at(k);
+        Complex zn = iWork.at(n);
+        Complex a = multiply(z + std::conj(zn), half);
+        Complex b = multiply(z - std::conj(zn), minusHalfI);
+        Complex an = std::conj(a);
+        Complex bn = std::conj(b);
+
+        // Spectra of real signals are conjugate symmetric
+        iWork[k] = multiply(std::conj(a), iReference.at(k)) +
+                multiply(i, multiply(std::conj(b), iReference.at(k)));
+        iWork[n] = multiply(std::conj(an), iReference.at(n)) +
+                multiply(i, multiply(std::conj(bn), iReference.at(n)));
+    }
+
+    transform(iWork, true);
+
+    findPeak(scale, active, false, best);
+    if (otherScale > 0.0)
+        findPeak(otherScale, otherActive, true, best);
+}
+
+AlignResult SubtitleAligner::align(bool searchScale)
+{
+    AlignResult best;
+    int scales = searchScale ? sizeof(alignScales) / sizeof(alignScales[0]) : 1;
+
+    best.offset = 0;
+    best.scale = 1.0;
+    best.confidence = 0.0;
+
+    for (int i = 0; i < scales; i += 2)
+        correlate(alignScales[i], i + 1 < scales ? alignScales[i + 1] : 0.0,
+                  best);
+
+    qDebug() << "best alignment offset" << best.offset << "scale" << best.scale <<
+                "confidence" << best.confidence;
+
+    return best;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLEALIGNER_H
+#define SUBTITLEALIGNER_H
+
+#include <QVector>
+#include <complex>
+#include "cuetable.h"
+
+// Resolution of the speech activity signals in milliseconds
+#define ALIGN_BIN_SIZE 10
+// Offsets searched in both directions
+#define ALIGN_MAX_OFFSET (10 * 60 * 1000)
+
+typedef struct _AlignResult {
+    int offset;        // In milliseconds, applied after the scale
+    double scale;      // Multiplier of the subtitle times
+    double confidence; // Normalized correlation at the offset, 0.0 - 1.0
+} AlignResult;
+
+/*
+ * Finds the offset, and optionally the frame rate conversion, that best
+ * matches the times of subtitles to a correctly timed reference. Both are
+ * turned into binary speech activity signals and cross-correlated with an
+ * FFT. Signals are real, so two candidate scales share one forward and one
+ * inverse transform.
+ */
+class SubtitleAligner
+{
+public:
+    SubtitleAligner(const CueTable &reference, const CueTable &subtitles);
+
+    AlignResult align(bool searchScale);
+
+private:
+    typedef std::complex<float> Complex;
+
+    qint64 buildSignal(const CueTable &table, double scale,
+                       QVector<Complex> &signal, bool imaginary);
+    void transform(QVector<Complex> &data, bool inverse);
+    void correlate(double scale, double otherScale, AlignResult &best);
+    void findPeak(double scale, qint64 active, bool imaginary,
+                  AlignResult &best);
+
+    const CueTable &iSubtitles;
+    QVector<Complex> iReference;
+    QVector<Complex> iTwiddles;
+    QVector<Complex> iWork;
+    qint64 iReferenceActive;
+    int iMaxLag;
+    int iSize;
+};
+
+#endif // SUBTITLEALIGNER_H
@@ -0,0 +1,225 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "subtitlecache.h"
+#include "subtitleengine.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <QCollator>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QtDebug>
+
+// Default limit for parsed subtitles kept in memory
+#define CACHE_MAX_COST (16 * 1024 * 1024)
+
+void SubtitlePrefetcher::prefetch(const QString &path, const QString &key,
+                                  const QString &fallbackCodec)
+{
+    ParsedSubtitle parsed;
+    Parser *parser;
+
+    parser = ParserEngineFactory::instance().getEngine(Parser::subtitleSuffix(path));
+    if (!parser) {
+        emit prefetchFailed(key);
+        return;
+    }
+
+    switch (SubtitleEngine::parseFile(parser, path, fallbackCodec, parsed)) {
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        qDebug() << "prefetched" << path;
+        emit prefetched(key, parsed);
+        break;
+    default:
+        emit prefetchFailed(key);
+        break;
+    }
+
+    delete parser;
+}
+
+SubtitleCache::SubtitleCache(QObject *parent) :
+    QObject(parent),
+    iCache(CACHE_MAX_COST),
+    iMaxCost(CACHE_MAX_COST)
+{
+    qRegisterMetaType<ParsedSubtitle>("ParsedSubtitle");
+
+    iPrefetcher = new SubtitlePrefetcher;
+    iPrefetcher->moveToThread(&iPrefetchThread);
+
+    connect(&iPrefetchThread, &QThread::finished,
+            iPrefetcher, &QObject::deleteLater);
+    connect(this, &SubtitleCache::prefetchRequested,
+            iPrefetcher, &SubtitlePrefetcher::prefetch);
+    connect(iPrefetcher, &SubtitlePrefetcher::prefetched,
+            this, &SubtitleCache::prefetchDone);
+    connect(iPrefetcher, &SubtitlePrefetcher::prefetchFailed,
+            this, &SubtitleCache::prefetchFailed);
+
+    // Speculative work must not compete with the UI
+    iPrefetchThread.start(QThread::IdlePriority);
+}
+
+SubtitleCache::~SubtitleCache()
+{
+    iPrefetchThread.quit();
+    iPrefetchThread.wait();
+}
+
+QString SubtitleCache::cacheKey(const QString &path,
+                                const QString &fallbackCodec)
+{
+    QFileInfo fileInfo(path);
+
+    if (!fileInfo.exists())
+        return QString();
+
+    return QStringLiteral("%1|%2|%3|%4").arg(fileInfo.absoluteFilePath())
+                                        .arg(fileInfo.size())
+                                        .arg(fileInfo.lastModified().toMSecsSinceEpoch())
+                                        .arg(fallbackCodec);
+}
+
+int SubtitleCache::calcCost(const ParsedSubtitle &parsed)
+{
+    qint64 cost = 0;
+
+    for (const Subtitle &subtitle : parsed.subtitles)
+        cost += sizeof(Subtitle) + subtitle.text.capacity() * sizeof(QChar);
+
+    return cost > INT_MAX ? INT_MAX : static_cast<int>(cost);
+}
+
+bool SubtitleCache::lookup(const QString &key, ParsedSubtitle &parsed)
+{
+    ParsedSubtitle *cached;
+
+    if (key.isEmpty())
+        return false;
+
+    cached = iCache.object(key);
+    if (!cached)
+        return false;
+
+    parsed = *cached;
+
+    return true;
+}
+
+void SubtitleCache::insert(const QString &key, const ParsedSubtitle &parsed)
+{
+    if (key.isEmpty() || parsed.subtitles.isEmpty())
+        return;
+
+    if (!iCache.insert(key, new ParsedSubtitle(parsed), calcCost(parsed))) {
+        qDebug() << "subtitle too large to be cached";
+        return;
+    }
+
+    // Prefetched files arrive at any time, keep the budget after each
+    memoryGrown();
+}
+
+void SubtitleCache::setMaxCost(int bytes)
+{
+    iMaxCost = bytes;
+    iCache.setMaxCost(bytes);
+}
+
+void SubtitleCache::clear()
+{
+    iCache.clear();
+}
+
+qint64 SubtitleCache::memoryCost()
+{
+    return iCache.totalCost();
+}
+
+// Least recently used files are dropped first
+qint64 SubtitleCache::releaseMemory(qint64 bytes)
+{
+    int before = iCache.totalCost();
+
+    iCache.setMaxCost(static_cast<int>(qMax<qint64>(0, before - bytes)));
+    iCache.setMaxCost(iMaxCost);
+
+    return before - iCache.totalCost();
+}
+
+QString SubtitleCache::nextSibling(const QString &path)
+{
+    QFileInfo fileInfo(path);
+    QDir dir = fileInfo.absoluteDir();
+    QStringList files;
+    QCollator collator;
+    int index;
+
+    // Videos next to the subtitles are not parsed ahead
+    files = dir.entryList(ParserEngineFactory::instance().nameFilters(false),
+                          QDir::Files | QDir::Readable);
+
+    // Natural order so that "Episode 10" follows "Episode 9"
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(files.begin(), files.end(), collator);
+
+    index = files.indexOf(fileInfo.fileName());
+    if (index < 0 || index + 1 >= files.size())
+        return QString();
+
+    return dir.absoluteFilePath(files.at(index + 1));
+}
+
+void SubtitleCache::prefetchNext(const QString &path,
+                                 const QString &fallbackCodec)
+{
+    QString next = nextSibling(path);
+    QString key;
+
+    if (next.isEmpty())
+        return;
+
+    key = cacheKey(next, fallbackCodec);
+    if (key.isEmpty() || iCache.contains(key) || iPending.contains(key))
+        return;
+
+    qDebug() << "prefetch" << next;
+
+    iPending.insert(key);
+    emit prefetchRequested(next, key, fallbackCodec);
+}
+
+void SubtitleCache::prefetchDone(const QString &key,
+                                 const ParsedSubtitle &parsed)
+{
+    iPending.remove(key);
+    insert(key, parsed);
+}
+
+void SubtitleCache::prefetchFailed(const QString &key)
+{
+    iPending.remove(key);
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLECACHE_H
+#define SUBTITLECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QThread>
+#include <QSet>
+#include "types.h"
+#include "memorybudget.h"
+
+typedef struct _ParsedSubtitle {
+    SubtitleList subtitles;
+    double fps;
+    bool needFps;
+    SubParseDiagnostics diagnostics;
+    SubTrackList tracks;
+    int track;
+    QString codec;
+    QString format;
+} ParsedSubtitle;
+
+Q_DECLARE_METATYPE(ParsedSubtitle)
+
+class SubtitlePrefetcher : public QObject
+{
+    Q_OBJECT
+public slots:
+    void prefetch(const QString &path, const QString &key,
+                  const QString &fallbackCodec);
+
+signals:
+    void prefetched(const QString &key, const ParsedSubtitle &parsed);
+    void prefetchFailed(const QString &key);
+};
+
+/*
+ * Memory bounded LRU of parsed subtitle files keyed by path, size, mtime and
+ * the codec used. The next file in the same directory can be parsed ahead in
+ * a low priority thread. Everything in it can be parsed again, so it is the
+ * first to go when memory runs low.
+ */
+class SubtitleCache : public QObject, public MemoryConsumer
+{
+    Q_OBJECT
+public:
+    explicit SubtitleCache(QObject *parent = nullptr);
+    ~SubtitleCache();
+
+    static QString cacheKey(const QString &path, const QString &fallbackCodec);
+    bool lookup(const QString &key, ParsedSubtitle &parsed);
+    void insert(const QString &key, const ParsedSubtitle &parsed);
+    void prefetchNext(const QString &path, const QString &fallbackCodec);
+    void setMaxCost(int bytes);
+    void clear();
+
+    qint64 memoryCost();
+    qint64 releaseMemory(qint64 bytes);
+
+signals:
+    void prefetchRequested(const QString &path, const QString &key,
+                           const QString &fallbackCodec);
+
+private slots:
+    void prefetchDone(const QString &key, const ParsedSubtitle &parsed);
+    void prefetchFailed(const QString &key);
+
+private:
+    static int calcCost(const ParsedSubtitle &parsed);
+    QString nextSibling(const QString &path);
+
+    QCache<QString, ParsedSubtitle> iCache;
+    QSet<QString> iPending;
+    int iMaxCost;
+    QThread iPrefetchThread;
+    SubtitlePrefetcher *iPrefetcher;
+};
+
+#endif // SUBTITLECACHE_H
@@ -0,0 +1,593 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "subtitlecatalogue.h"
+#include "subtitleengine.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <QCollator>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextCodec>
+#include <QtDebug>
+
+#define CATALOGUE_INDEX_FILE "catalogue.json"
+#define CATALOGUE_INDEX_VERSION 1
+// inotify watches are a shared resource, deep trees are only crawled
+#define CATALOGUE_MAX_WATCHES 256
+#define CATALOGUE_MAX_DEPTH 8
+// Bytes of a file looked at when guessing the codec
+#define CATALOGUE_CODEC_SNIFF (64 * 1024)
+// Directories change in bursts while files are copied
+#define CATALOGUE_RESCAN_DELAY 2000
+
+/*
+ * Codec of an uncompressed file without BOM. Text that is valid UTF-8 is
+ * taken as such, anything else is one of the 8 bit codecs and the fallback
+ * codec selected in settings decides which.
+ */
+static QString guessCodec(const QString &path)
+{
+    QFile file(path);
+    QByteArray head;
+    QTextCodec::ConverterState state;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    head = file.read(CATALOGUE_CODEC_SNIFF);
+    QTextCodec::codecForName("UTF-8")->toUnicode(head.constData(),
+                                                 head.size(), &state);
+
+    return state.invalidChars ? QStringLiteral("8-bit") :
+                                QStringLiteral("UTF-8");
+}
+
+/*
+ * Files that cannot be parsed are kept with no cues so that they are not
+ * parsed again on every crawl, they are not listed.
+ */
+void CatalogueCrawler::scanEntry(const QString &path,
+                                 const CatalogueEntries &known,
+                                 CatalogueEntry &entry)
+{
+    QFileInfo fileInfo(path);
+    CatalogueEntries::const_iterator iter = known.constFind(path);
+    ParsedSubtitle parsed;
+    Parser *parser;
+    bool ok = false;
+
+    entry.path = path;
+    entry.cues = 0;
+    entry.duration = 0;
+    entry.size = fileInfo.size();
+    entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    if (iter != known.constEnd() && iter->size == entry.size &&
+                iter->modified == entry.modified) {
+        entry = *iter;
+        return;
+    }
+
+    entry.format = Parser::subtitleSuffix(path);
+    parser = ParserEngineFactory::instance().getEngine(entry.format);
+    if (!parser)
+        return;
+
+    // Without a fallback codec only a BOM gives the codec name
+    switch (SubtitleEngine::parseFile(parser, path, QString(), parsed)) {
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+    case SubtitleEngine::SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        ok = !parsed.subtitles.isEmpty();
+        break;
+    default:
+        break;
+    }
+
+    delete parser;
+
+    if (!ok)
+        return;
+
+    entry.cues = parsed.subtitles.size();
+    for (const Subtitle &subtitle : parsed.subtitles)
+        entry.duration = qMax(entry.duration, subtitle.end_time);
+
+    entry.codec = parsed.codec;
+    if (entry.codec.isEmpty() && !Parser::isCompressed(path))
+        entry.codec = guessCodec(path);
+}
+
+void CatalogueCrawler::crawl(const QString &root, bool recursive,
+                             const CatalogueEntries &known)
+{
+    QList<QPair<QString, int> > pending;
+    QStringList directories;
+
+    pending.append(qMakePair(root, 0));
+
+    while (!pending.isEmpty()) {
+        QPair<QString, int> next = pending.takeFirst();
+        QDir dir(next.first);
+        QVector<CatalogueEntry> entries;
+
+        if (QThread::currentThread()->isInterruptionRequested())
+            return;
+
+        if (!dir.exists())
+            continue;
+
+        directories.append(next.first);
+
+        for (const QFileInfo &fileInfo :
+                    dir.entryInfoList(SubtitleCatalogue::nameFilters(),
+                                      QDir::Files | QDir::Readable)) {
+            CatalogueEntry entry;
+
+            scanEntry(fileInfo.absoluteFilePath(), known, entry);
+            entries.append(entry);
+        }
+
+        emit directoryScanned(next.first, entries);
+
+        if (!recursive || next.second >= CATALOGUE_MAX_DEPTH)
+            continue;
+
+        // Links are not followed to keep out of loops
+        for (const QFileInfo &fileInfo :
+                    dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot |
+                                      QDir::Readable | QDir::NoSymLinks))
+            pending.append(qMakePair(fileInfo.absoluteFilePath(),
+                                     next.second + 1));
+    }
+
+    emit crawlFinished(root, recursive, directories);
+}
+
+SubtitleCatalogue::SubtitleCatalogue(QObject *parent) :
+    QAbstractListModel(parent),
+    iRoots(defaultRoots()),
+    iCrawling(false),
+    iDirty(false)
+{
+    qRegisterMetaType<CatalogueEntry>("CatalogueEntry");
+    qRegisterMetaType<CatalogueEntries>("CatalogueEntries");
+    qRegisterMetaType<QVector<CatalogueEntry> >("QVector<CatalogueEntry>");
+
+    iCrawler = new CatalogueCrawler;
+    iCrawler->moveToThread(&iCrawlThread);
+
+    connect(&iCrawlThread, &QThread::finished,
+            iCrawler, &QObject::deleteLater);
+    connect(this, &SubtitleCatalogue::crawlRequested,
+            iCrawler, &CatalogueCrawler::crawl);
+    connect(iCrawler, &CatalogueCrawler::directoryScanned,
+            this, &SubtitleCatalogue::updateDirectory);
+    connect(iCrawler, &CatalogueCrawler::crawlFinished,
+            this, &SubtitleCatalogue::finishCrawl);
+    connect(&iWatcher, &QFileSystemWatcher::directoryChanged,
+            this, &SubtitleCatalogue::directoryChanged);
+
+    iRescanTimer.setSingleShot(true);
+    iRescanTimer.setInterval(CATALOGUE_RESCAN_DELAY);
+    connect(&iRescanTimer, &QTimer::timeout,
+            this, &SubtitleCatalogue::rescanChanged);
+
+    // Crawling must not compete with the UI
+    iCrawlThread.start(QThread::IdlePriority);
+
+    load();
+    updateRows();
+    refresh();
+}
+
+SubtitleCatalogue::~SubtitleCatalogue()
+{
+    iCrawlThread.requestInterruption();
+    iCrawlThread.quit();
+    iCrawlThread.wait();
+
+    if (iDirty)
+        save();
+}
+
+QStringList SubtitleCatalogue::nameFilters()
+{
+    // Containers are left out, parsing those means reading whole videos
+    return ParserEngineFactory::instance().nameFilters(false);
+}
+
+QStringList SubtitleCatalogue::defaultRoots()
+{
+    QStringList roots;
+    QDir media(QStringLiteral("/run/media/") +
+               QString::fromLocal8Bit(qgetenv("USER")));
+
+    roots << QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) <<
+             QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) <<
+             QStandardPaths::writableLocation(QStandardPaths::MoviesLocation);
+
+    // Memory cards
+    for (const QFileInfo &fileInfo :
+                media.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+        roots << fileInfo.absoluteFilePath();
+
+    roots.removeAll(QString());
+    roots.removeDuplicates();
+
+    return roots;
+}
+
+void SubtitleCatalogue::setRoots(const QStringList &roots)
+{
+    iRoots = roots;
+    refresh();
+}
+
+int SubtitleCatalogue::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return iRows.size();
+}
+
+QVariant SubtitleCatalogue::data(const QModelIndex &index, int role) const
+{
+    int row = index.row();
+    CatalogueEntries::const_iterator iter;
+
+    if (row < 0 || row >= iRows.size())
+        return QVariant();
+
+    iter = iEntries.constFind(iRows.at(row));
+    if (iter == iEntries.constEnd())
+        return QVariant();
+
+    switch (role) {
+    case PathRole:
+        return iter->path;
+    case NameRole:
+        return QFileInfo(iter->path).fileName();
+    case FormatRole:
+        return iter->format;
+    case CodecRole:
+        return iter->codec;
+    case CuesRole:
+        return iter->cues;
+    case DurationRole:
+        return iter->duration;
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> SubtitleCatalogue::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+
+    roles[PathRole] = "path";
+    roles[NameRole] = "name";
+    roles[FormatRole] = "format";
+    roles[CodecRole] = "codec";
+    roles[CuesRole] = "cues";
+    roles[DurationRole] = "duration";
+
+    return roles;
+}
+
+QString SubtitleCatalogue::filter() const
+{
+    return iFilter;
+}
+
+void SubtitleCatalogue::setFilter(const QString &filter)
+{
+    if (iFilter == filter)
+        return;
+
+    iFilter = filter;
+    updateRows();
+    emit filterChanged();
+}
+
+bool SubtitleCatalogue::crawling() const
+{
+    return iCrawling;
+}
+
+void SubtitleCatalogue::refresh()
+{
+    for (const QString &root : iRoots)
+        queueCrawl(root, true);
+}
+
+QStringRef SubtitleCatalogue::directoryOf(const QString &path)
+{
+    return path.leftRef(path.lastIndexOf(QLatin1Char('/')));
+}
+
+bool SubtitleCatalogue::isBelow(const QStringRef &path, const QString &directory)
+{
+    return path.startsWith(directory) && path.size() > directory.size() &&
+            path.at(directory.size()) == QLatin1Char('/');
+}
+
+/*
+ * Rows are the paths matching all words of the filter in the file name,
+ * in natural order. Rebuilt from the index on every change, it is small
+ * enough for that to stay instant.
+ */
+void SubtitleCatalogue::updateRows()
+{
+    QStringList words = iFilter.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    QVector<QPair<QString, QString> > matches;
+    QCollator collator;
+    QVector<QString> rows;
+
+    matches.reserve(iEntries.size());
+
+    for (CatalogueEntries::const_iterator iter = iEntries.constBegin();
+                iter != iEntries.constEnd(); ++iter) {
+        QString name = iter.key().mid(iter.key().lastIndexOf(QLatin1Char('/')) + 1);
+        bool match = iter->cues > 0;
+
+        for (const QString &word : words) {
+            if (!match || !name.contains(word, Qt::CaseInsensitive)) {
+                match = false;
+                break;
+            }
+        }
+
+        if (match)
+            matches.append(qMakePair(name, iter.key()));
+    }
+
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(matches.begin(), matches.end(),
+              [&collator](const QPair<QString, QString> &a,
+                          const QPair<QString, QString> &b) {
+        return collator.compare(a.first, b.first) < 0;
+    });
+
+    rows.reserve(matches.size());
+    for (const QPair<QString, QString> &match : matches)
+        rows.append(match.second);
+
+    beginResetModel();
+    iRows = rows;
+    endResetModel();
+}
+
+void SubtitleCatalogue::queueCrawl(const QString &directory, bool recursive)
+{
+    QPair<QString, bool> request(directory, recursive);
+
+    if (iQueue.contains(request))
+        return;
+
+    iQueue.append(request);
+
+    if (!iCrawling)
+        crawlNext();
+}
+
+void SubtitleCatalogue::crawlNext()
+{
+    QPair<QString, bool> next;
+    bool wasCrawling = iCrawling;
+
+    iCrawling = !iQueue.isEmpty();
+
+    if (iCrawling) {
+        next = iQueue.takeFirst();
+        qDebug() << "crawl" << next.first;
+        // Known entries are shared with the thread, not copied
+        emit crawlRequested(next.first, next.second, iEntries);
+    } else if (iDirty) {
+        save();
+    }
+
+    if (wasCrawling != iCrawling)
+        emit crawlingChanged();
+}
+
+void SubtitleCatalogue::updateDirectory(const QString &directory,
+                                        const QVector<CatalogueEntry> &entries)
+{
+    CatalogueEntries::iterator iter;
+    QSet<QString> paths;
+    bool changed = false;
+
+    for (const CatalogueEntry &entry : entries) {
+        paths.insert(entry.path);
+
+        iter = iEntries.find(entry.path);
+        if (iter != iEntries.end() && iter->size == entry.size &&
+                    iter->modified == entry.modified)
+            continue;
+
+        iEntries.insert(entry.path, entry);
+        changed = true;
+    }
+
+    iter = iEntries.begin();
+    while (iter != iEntries.end()) {
+        if (directoryOf(iter.key()) == directory &&
+                    !paths.contains(iter.key())) {
+            iter = iEntries.erase(iter);
+            changed = true;
+        } else {
+            ++iter;
+        }
+    }
+
+    watch(directory);
+
+    if (!changed)
+        return;
+
+    iDirty = true;
+    updateRows();
+}
+
+void SubtitleCatalogue::finishCrawl(const QString &root, bool recursive,
+                                    const QStringList &directories)
+{
+    QSet<QString> scanned = directories.toSet();
+    CatalogueEntries::iterator iter = iEntries.begin();
+    bool removed = false;
+
+    // Directories removed after the previous crawl were not reported
+    while (recursive && iter != iEntries.end()) {
+        QStringRef directory = directoryOf(iter.key());
+
+        if ((directory == root || isBelow(directory, root)) &&
+                    !scanned.contains(directory.toString())) {
+            iter = iEntries.erase(iter);
+            removed = true;
+        } else {
+            ++iter;
+        }
+    }
+
+    if (removed) {
+        iDirty = true;
+        updateRows();
+    }
+
+    crawlNext();
+}
+
+void SubtitleCatalogue::watch(const QString &directory)
+{
+    if (iWatcher.directories().contains(directory))
+        return;
+
+    if (iWatcher.directories().size() >= CATALOGUE_MAX_WATCHES)
+        return;
+
+    iWatcher.addPath(directory);
+}
+
+void SubtitleCatalogue::directoryChanged(const QString &directory)
+{
+    iChangedDirectories.insert(directory);
+    iRescanTimer.start();
+}
+
+void SubtitleCatalogue::rescanChanged()
+{
+    // New subdirectories are found only by walking below the changed one
+    for (const QString &directory : iChangedDirectories)
+        queueCrawl(directory, true);
+
+    iChangedDirectories.clear();
+}
+
+QString SubtitleCatalogue::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+            QLatin1String("/" CATALOGUE_INDEX_FILE);
+}
+
+void SubtitleCatalogue::load()
+{
+    QFile file(indexPath());
+    QJsonDocument document;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    document = QJsonDocument::fromJson(file.readAll());
+    if (document.object().value(QStringLiteral("version")).toInt() !=
+                CATALOGUE_INDEX_VERSION) {
+        qWarning() << "ignoring subtitle catalogue of unknown version";
+        return;
+    }
+
+    for (const QJsonValue &value : document.object().value(QStringLiteral("entries")).toArray()) {
+        QJsonObject object = value.toObject();
+        CatalogueEntry entry;
+
+        entry.path = object.value(QStringLiteral("path")).toString();
+        entry.format = object.value(QStringLiteral("format")).toString();
+        entry.codec = object.value(QStringLiteral("codec")).toString();
+        entry.cues = object.value(QStringLiteral("cues")).toInt();
+        entry.duration = object.value(QStringLiteral("duration")).toDouble();
+        entry.size = object.value(QStringLiteral("size")).toDouble();
+        entry.modified = object.value(QStringLiteral("modified")).toDouble();
+
+        if (!entry.path.isEmpty())
+            iEntries.insert(entry.path, entry);
+    }
+
+    qDebug() << "read" << iEntries.size() << "catalogue entries";
+}
+
+int SubtitleCatalogue::save()
+{
+    QSaveFile file(indexPath());
+    QJsonArray entries;
+    QJsonObject root;
+
+    if (!QDir().mkpath(QFileInfo(file.fileName()).path()))
+        return -EACCES;
+
+    for (const CatalogueEntry &entry : iEntries) {
+        QJsonObject object;
+
+        object.insert(QStringLiteral("path"), entry.path);
+        object.insert(QStringLiteral("format"), entry.format);
+        object.insert(QStringLiteral("codec"), entry.codec);
+        object.insert(QStringLiteral("cues"), entry.cues);
+        object.insert(QStringLiteral("duration"), static_cast<double>(entry.duration));
+        object.insert(QStringLiteral("size"), static_cast<double>(entry.size));
+        object.insert(QStringLiteral("modified"), static_cast<double>(entry.modified));
+        entries.append(object);
+    }
+
+    root.insert(QStringLiteral("version"), CATALOGUE_INDEX_VERSION);
+    root.insert(QStringLiteral("entries"), entries);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return -EACCES;
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+
+    if (!file.commit())
+        return -EIO;
+
+    iDirty = false;
+
+    return 0;
+}
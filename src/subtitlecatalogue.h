@@ -0,0 +1,147 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLECATALOGUE_H
+#define SUBTITLECATALOGUE_H
+
+#include <QAbstractListModel>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+typedef struct _CatalogueEntry {
+    QString path;
+    QString format;
+    QString codec;
+    int cues;
+    unsigned int duration;
+    qint64 size;
+    qint64 modified;
+} CatalogueEntry;
+
+typedef QHash<QString, CatalogueEntry> CatalogueEntries;
+
+Q_DECLARE_METATYPE(CatalogueEntry)
+Q_DECLARE_METATYPE(CatalogueEntries)
+
+class CatalogueCrawler : public QObject
+{
+    Q_OBJECT
+public slots:
+    /*
+     * Walk the directory and, when recursive, everything below it. Files
+     * with the same size and mtime as in the known entries are not parsed
+     * again.
+     */
+    void crawl(const QString &root, bool recursive,
+               const CatalogueEntries &known);
+
+signals:
+    // All subtitle files of one directory, replaces the earlier ones
+    void directoryScanned(const QString &directory,
+                          const QVector<CatalogueEntry> &entries);
+    void crawlFinished(const QString &root, bool recursive,
+                       const QStringList &directories);
+
+private:
+    void scanEntry(const QString &path, const CatalogueEntries &known,
+                   CatalogueEntry &entry);
+};
+
+/*
+ * Index of the subtitle files found under the catalogue roots. Files are
+ * parsed once in a low priority thread, the results are kept in a small
+ * file and directories are watched for changes so that only the changed
+ * ones are walked again. Listing and name search use the index only.
+ */
+class SubtitleCatalogue : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString filter READ filter WRITE setFilter NOTIFY filterChanged)
+    Q_PROPERTY(bool crawling READ crawling NOTIFY crawlingChanged)
+public:
+    enum CatalogueRoles {
+        PathRole = Qt::UserRole + 1,
+        NameRole,
+        FormatRole,
+        CodecRole,
+        CuesRole,
+        DurationRole
+    };
+
+    explicit SubtitleCatalogue(QObject *parent = nullptr);
+    ~SubtitleCatalogue();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    QString filter() const;
+    void setFilter(const QString &filter);
+    bool crawling() const;
+
+    Q_INVOKABLE void refresh();
+    void setRoots(const QStringList &roots);
+    static QStringList defaultRoots();
+    static QStringList nameFilters();
+
+signals:
+    void filterChanged();
+    void crawlingChanged();
+    void crawlRequested(const QString &root, bool recursive,
+                        const CatalogueEntries &known);
+
+private slots:
+    void updateDirectory(const QString &directory,
+                         const QVector<CatalogueEntry> &entries);
+    void finishCrawl(const QString &root, bool recursive,
+                     const QStringList &directories);
+    void directoryChanged(const QString &directory);
+    void rescanChanged();
+    void crawlNext();
+
+private:
+    static QString indexPath();
+    static QStringRef directoryOf(const QString &path);
+    static bool isBelow(const QStringRef &path, const QString &directory);
+    void load();
+    int save();
+    void queueCrawl(const QString &directory, bool recursive);
+    void updateRows();
+    void watch(const QString &directory);
+
+    CatalogueEntries iEntries;
+    QVector<QString> iRows;
+    QString iFilter;
+    QStringList iRoots;
+    QList<QPair<QString, bool> > iQueue;
+    bool iCrawling;
+    bool iDirty;
+    QFileSystemWatcher iWatcher;
+    QTimer iRescanTimer;
+    QSet<QString> iChangedDirectories;
+    QThread iCrawlThread;
+    CatalogueCrawler *iCrawler;
+};
+
+#endif // SUBTITLECATALOGUE_H
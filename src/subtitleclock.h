@@ -0,0 +1,60 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLECLOCK_H
+#define SUBTITLECLOCK_H
+
+#include <QElapsedTimer>
+
+/*
+ * Time source of the playback in milliseconds. Only differences of now() are
+ * used unless the clock is absolute, in which case now() is the position of
+ * the playback itself.
+ */
+class SubtitleClock
+{
+public:
+    virtual ~SubtitleClock() {}
+    virtual qint64 now() = 0;
+    virtual bool isAbsolute() { return false; }
+};
+
+class MonotonicClock : public SubtitleClock
+{
+public:
+    MonotonicClock() { iTimer.start(); }
+    qint64 now() { return iTimer.elapsed(); }
+
+private:
+    QElapsedTimer iTimer;
+};
+
+// Manually advanced clock for replaying playback without waiting
+class SimulatedClock : public SubtitleClock
+{
+public:
+    SimulatedClock() : iNow(0) {}
+    qint64 now() { return iNow; }
+    void advance(qint64 time) { iNow += time; }
+
+private:
+    qint64 iNow;
+};
+
+#endif // SUBTITLECLOCK_H
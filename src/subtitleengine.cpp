@@ -19,40 +19,38 @@
 
 #include "subtitleengine.h"
 #include "parserenginefactory.h"
+#include "subtitlewriter.h"
+#include "subtitlealigner.h"
+#include "fpsestimator.h"
+#include "densitytimeline.h"
 
+#include <climits>
 #include <math.h>
+#include <unistd.h>
 
 #include <QFileInfo>
 #include <QTextCodec>
 
+// Streamed cues are added to the table at most this often, in milliseconds
+#define STREAM_PUBLISH_INTERVAL 500
+// Edits are published as a new table at most this often, in milliseconds
+#define EDIT_PUBLISH_INTERVAL 500
+
 void SubtitleEngine::setupSubtitles()
 {
-    Subtitle *first = nullptr;
+    const Subtitle *first = nullptr;
 
-    if (iSubtitles.empty())
+    if (iTable->isEmpty())
         return;
 
-    qDebug() << iSubtitles.size() << "subtitle lines processed";
+    qDebug() << iTable->size() << "subtitle lines processed";
 
-    first = iSubtitles.first();
+    first = &iTable->first();
 
-    iTotalTime = iSubtitles.last()->end_time;
     qDebug() << "total duration" << iTotalTime << "ms";
     qDebug() << "start" << first->index << "time" << first->start_time;
 
-    iCurrentIndex = 0;
-    iPrevEndTime = 0;
-
-    if (iTimeOffset < 0) {
-        iState = SUB_STATE_INIT_DELAY;
-        iInitDelay = -iTimeOffset;
-        iDelay = 0;
-    } else {
-        iState = SUB_STATE_DELAY;
-        iDelay = getSubtitleStart(first);
-    }
-
-    iPrevEndTime = 0;
+    setTime(0);
 }
 
 static QString parseErrorToStr(enum SubParseError err)
@@ -74,28 +72,23 @@ static QString parseErrorToStr(enum SubParseError err)
     return QString("");
 }
 
-SubtitleEngine::SubtitleLoadStatus SubtitleEngine::loadSubtitle(QString file)
+/*
+ * Parse the file in recovery mode, broken cues are skipped and reported in
+ * the diagnostics of the result instead of failing the whole file.
+ */
+SubtitleEngine::SubtitleLoadStatus SubtitleEngine::parseFile(Parser *parser,
+                                                           const QString &file,
+                                                           const QString &fallbackCodec,
+                                                           ParsedSubtitle &parsed)
 {
-    Subtitle *newsub;
+    SubParseResult result;
     enum SubParseError parseErr = SUB_PARSE_ERROR_NONE;
 
-    qDebug() << "load " << file << "";
-
-    freeSubtitles();
-
-    QFileInfo fileInfo(file);
-    QString suffix = fileInfo.suffix();
-
-    iParser = ParserEngineFactory::instance().getEngine(suffix);
-    if (!iParser) {
-        qWarning() << "no parser available for type" << suffix;
-        return SUBTITLE_LOAD_STATUS_NOT_SUPPORTED;
-    }
-
-    iParser->initializeParser();
-    iParser->setFallbackCodec(iFallbackCodec);
+    parser->initializeParser();
+    parser->setFallbackCodec(fallbackCodec);
+    parser->setRecovery(true);
 
-    int err = iParser->openSubtitle(file);
+    int err = parser->openSubtitle(file);
     switch (err) {
     case -ENOTSUP:
         qWarning() << "cannot open subtitle" << strerror(-err);
@@ -108,15 +101,18 @@ SubtitleEngine::SubtitleLoadStatus SubtitleEngine::loadSubtitle(QString file)
         return SUBTITLE_LOAD_STATUS_ACCESS_DENIED;
     case 0:
         break;
+    default:
+        qWarning() << "cannot open subtitle" << strerror(-err);
+        parser->closeSubtitle();
+        return SUBTITLE_LOAD_STATUS_FAILURE;
     }
 
-    do {
-        newsub = iParser->loadSubtitle(&parseErr);
-        if (newsub) /* Skip empty lines */
-            iSubtitles.append(newsub);
-    } while (parseErr == SUB_PARSE_ERROR_NONE);
+    parseErr = parser->loadSubtitles(parsed.subtitles, &result);
+
+    parser->closeSubtitle();
 
-    iParser->closeSubtitle();
+    qDebug() << result.cues << "subtitles parsed," << result.skipped <<
+                "lines skipped," << result.errors << "errors";
 
     switch (parseErr) {
     case SUB_PARSE_ERROR_NONE:
@@ -126,18 +122,191 @@ SubtitleEngine::SubtitleLoadStatus SubtitleEngine::loadSubtitle(QString file)
     case SUB_PARSE_ERROR_INVALID_TIMESTAMP:
     case SUB_PARSE_ERROR_INVALID_FILE:
     case SUB_PARSE_ERROR_NO_FILE:
-        qWarning() << "cannot parse subtitle file" << parseErrorToStr(parseErr);
+        qWarning() << "cannot parse subtitle file" << parseErrorToStr(parseErr) <<
+                      "on line" << result.line;
         return SUBTITLE_LOAD_STATUS_PARSE_FAILURE;
     }
 
+    parsed.fps = parser->getFps();
+    parsed.needFps = parser->needFPSUpdate();
+    parsed.diagnostics = result.diagnostics;
+    parsed.tracks = parser->getTracks();
+    parsed.track = parser->getSelectedTrack();
+    parsed.codec = parser->getCodecName();
+    parsed.format = parser->getFormat();
+
+    if (parsed.needFps)
+        return SUBTITLE_LOAD_STATUS_OK_NEED_FPS;
+
+    return result.errors ? SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS :
+                           SUBTITLE_LOAD_STATUS_OK;
+}
+
+SubtitleEngine::SubtitleLoadStatus SubtitleEngine::loadSubtitle(QString file)
+{
+    ParsedSubtitle parsed;
+    SubtitleLoadStatus status;
+    QString key;
+
+    qDebug() << "load " << file << "";
+
+    freeSubtitles();
+
+    // Compressed files are named by the subtitle inside
+    QString suffix = Parser::subtitleSuffix(file);
+
+    iParser = ParserEngineFactory::instance().getEngine(suffix);
+    if (!iParser)
+        iParser = ParserEngineFactory::instance().detectEngine(file);
+    if (!iParser) {
+        qWarning() << "no parser available for type" << suffix;
+        return SUBTITLE_LOAD_STATUS_NOT_SUPPORTED;
+    }
+
+    key = SubtitleCache::cacheKey(file, iFallbackCodec);
+
+    if (iCache->lookup(key, parsed)) {
+        qDebug() << "using cached subtitles";
+        iParser->setFallbackCodec(iFallbackCodec);
+        iParser->setFps(parsed.fps);
+    } else {
+        status = parseFile(iParser, file, iFallbackCodec, parsed);
+        switch (status) {
+        case SUBTITLE_LOAD_STATUS_OK:
+        case SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+        case SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+            break;
+        default:
+            return status;
+        }
+
+        iCache->insert(key, parsed);
+    }
+
+    iTextStored = true;
+    publishSubtitles(parsed.subtitles);
+    syncTable();
+    iPath = file;
+    iDiagnostics = parsed.diagnostics;
+    iTracks = parsed.tracks;
+    iTrack = parsed.track;
+    iFormat = parsed.format;
+    updateFingerprint();
     setupSubtitles();
 
-    if (iParser->needFPSUpdate())
+    // Next episode is likely to be opened next, unless memory is low
+    if (iMemory->level() == MemoryBudget::MEMORY_LEVEL_NORMAL)
+        iCache->prefetchNext(file, iFallbackCodec);
+
+    if (parsed.needFps)
         return SUBTITLE_LOAD_STATUS_OK_NEED_FPS;
 
+    if (!iDiagnostics.isEmpty())
+        return SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS;
+
     return SUBTITLE_LOAD_STATUS_OK;
 }
 
+/*
+ * Read subtitles of the given format as they arrive from stdin ("-") or a
+ * local socket. Cues are added to the table while the playback runs.
+ */
+SubtitleEngine::SubtitleLoadStatus SubtitleEngine::openStream(const QString &source,
+                                                              const QString &format)
+{
+    bool ok;
+
+    qDebug() << "open stream" << source << "as" << format;
+
+    freeSubtitles();
+
+    iParser = ParserEngineFactory::instance().getEngine(format);
+    if (!iParser) {
+        qWarning() << "no parser available for type" << format;
+        return SUBTITLE_LOAD_STATUS_NOT_SUPPORTED;
+    }
+
+    iParser->setFallbackCodec(iFallbackCodec);
+    iParser->setRecovery(true);
+
+    iStream = new SubtitleStream(iParser, this);
+    connect(iStream, &SubtitleStream::cuesReceived,
+            this, &SubtitleEngine::streamCuesReceived);
+    connect(iStream, &SubtitleStream::finished,
+            this, &SubtitleEngine::streamFinished);
+
+    if (source == QStringLiteral("-"))
+        ok = iStream->openFd(STDIN_FILENO);
+    else
+        ok = iStream->openLocalSocket(source);
+
+    if (!ok) {
+        delete iStream;
+        iStream = nullptr;
+        return SUBTITLE_LOAD_STATUS_FILE_NOT_FOUND;
+    }
+
+    setupSubtitles();
+
+    return iParser->needFPSUpdate() ? SUBTITLE_LOAD_STATUS_OK_NEED_FPS :
+                                      SUBTITLE_LOAD_STATUS_OK;
+}
+
+/*
+ * Each new table is built from all cues received so far. Cues are collected
+ * and published at most once per interval instead of for every chunk.
+ */
+void SubtitleEngine::streamCuesReceived(const SubtitleList &cues)
+{
+    // Format of a .sub stream is known after the first lines
+    iFormat = iParser->getFormat();
+    iStreamPending.append(cues);
+
+    // First cues are shown right away
+    if (iTable->isEmpty() && !iEditsPending) {
+        flushStream();
+        return;
+    }
+
+    if (!iStreamTimer.isActive())
+        iStreamTimer.start();
+}
+
+void SubtitleEngine::flushStream()
+{
+    iStreamTimer.stop();
+
+    // Pending edits take the cues along when published
+    if (iStreamPending.isEmpty() || iEditsPending)
+        return;
+
+    // Editor in use takes them as well, so its edits can still be undone
+    if (iEditorTable == iTable) {
+        iEditsPending = true;
+        publishEdits();
+        return;
+    }
+
+    iStreamSubtitles.append(iStreamPending);
+    iStreamPending.clear();
+
+    publishSubtitles(iStreamSubtitles);
+    syncTable();
+}
+
+void SubtitleEngine::streamFinished()
+{
+    if (!iStream)
+        return;
+
+    flushStream();
+
+    qDebug() << "stream finished with" << iStreamSubtitles.size() << "subtitles";
+
+    iStream->deleteLater();
+    iStream = nullptr;
+}
+
 void SubtitleEngine::unloadSubtitle()
 {
     qDebug() << "unload subtitle and reset";
@@ -146,342 +315,406 @@ void SubtitleEngine::unloadSubtitle()
 
 void SubtitleEngine::updateFps(double fps)
 {
-    Subtitle *subtitle;
+    bool frameTimed = iFormat == QStringLiteral("microdvd");
+    double previous;
+    bool editorInUse;
 
     if (!iParser)
         return;
 
     qDebug() << "updating FPS to" << fps;
+
+    // Edits not yet in the table would be lost with it
+    publishEdits();
+
+    previous = iParser->getFps();
     iParser->setFps(fps);
+    flushStream();
+    editorInUse = iEditorTable == iTable;
+
+    // Published table is immutable, recalculate a copy and replace it
+    SubtitleList subtitles = iTable->subtitles();
+    iParser->updateFPS(subtitles);
+    publishSubtitles(subtitles);
+    syncTable();
+
+    // Editor is retimed along to keep the undo. Times are not in proportion
+    // to the frames after scaleTime(), the editor starts over then.
+    if (editorInUse && (!frameTimed || (previous > 0.0 && iTimeScale == 1.0))) {
+        if (frameTimed)
+            iEditor.retime(previous / fps);
+        iEditorTable = iTable;
+    }
+
+    // Times are calculated again from the frames
+    iTimeScale = 1.0;
 
-    foreach (subtitle, iSubtitles)
-        iParser->updateFPS(subtitle);
+    // Cues still arriving are appended to the updated ones
+    if (iStream)
+        iStreamSubtitles = subtitles;
 
-    // Update time from the last one
-    iTotalTime = iSubtitles.isEmpty() ? 0 : iSubtitles.last()->end_time;
     qDebug() << "total time updated to" << iTotalTime;
 }
 
 void SubtitleEngine::increaseTime(unsigned int time)
 {
-    iCurrentTime += time;
+    syncTable();
 
-    switch(iState) {
-    case SUB_STATE_INIT:
-        break;
-    case SUB_STATE_INIT_DELAY:
-        if (time >= iInitDelay) {
-            time -= iInitDelay;
-            iInitDelay = 0;
-            iState = SUB_STATE_DELAY;
-            if (!iSubtitles.isEmpty())
-                setEngineSubTime(getSubtitleStart(iSubtitles.first()));
-
-            increaseTime(time);
-            break;
-        }
+    if (iTable->isEmpty())
+        return;
 
-        iInitDelay -= time;
-        break;
-    case SUB_STATE_DELAY:
-        if (time >= iDelay) {
-            time -= iDelay;
-            iDelay = 0;
-            iState = SUB_STATE_DURATION;
-            iDuration = calcCurrentDuration();
-            increaseTime(time);
-            break;
-        }
+    iCursor.advance(time);
+    setDisplayedIndex(iCursor.displayed());
+}
 
-        setEngineSubTime(iDelay - time);
-        break;
-    case SUB_STATE_DURATION:
-        if (time >= iDuration) {
-            time -= iDuration;
-            iDuration = 0;
-            iPrevEndTime = getSubtitleEnd(getSubtitleNow());
-
-            if (iCurrentIndex + 1 < iSubtitles.size()) {
-                iCurrentIndex++;
-                unsigned int nextStart = getSubtitleStart(getSubtitleNow());
-                if (nextStart > iCurrentTime) {
-                    iState = SUB_STATE_DELAY;
-                    setEngineSubTime(calcCurrentDelay());
-                } else {
-                    iState = SUB_STATE_DURATION;
-                    setEngineSubTime(calcCurrentDuration());
-                }
-
-                increaseTime(time);
-                break;
-            }
-
-            iState = SUB_STATE_END;
-            break;
-        }
+void SubtitleEngine::setDisplayedIndex(int position)
+{
+    if (iDisplayedIndex == position)
+        return;
 
-        setEngineSubTime(iDuration - time);
-        break;
-    case SUB_STATE_END:
-        iDuration = 0;
-        iDelay = 0;
-        break;
-    default:
-        break;
-    }
+    iDisplayedIndex = position;
+    emit displayedIndexChanged(position);
+}
+
+void SubtitleEngine::setTime(unsigned int time)
+{
+    syncTable();
+
+    if (iTable->isEmpty())
+        return;
+
+    iCursor.seek(time);
+    setDisplayedIndex(iCursor.displayed());
 }
 
-void SubtitleEngine::setEngineSubTime(unsigned int time)
+QString SubtitleEngine::getSubtitle(unsigned int time)
 {
-    switch (iState) {
+    if (!iParser)
+        return QString("no parser");
+
+    syncTable();
+
+    if (!iTable->size())
+        return QString("<subtitles end>");
+
+    if (time)
+        increaseTime(time);
+
+    switch(iCursor.state()) {
     case SUB_STATE_INIT:
     case SUB_STATE_INIT_DELAY:
-        iInitDelay = time;
-        break;
     case SUB_STATE_DELAY:
-        iDelay = time;
-        break;
+        return QString("");
     case SUB_STATE_DURATION:
-        iDuration = time;
-        break;
+        return iParser->getSubtitleText(iCursor.current());
     case SUB_STATE_END:
-        break;
+        return QString("<subtitles end>");
     default:
-        break;
+        return QString("");
     }
 }
 
-static unsigned int getUnsigned(int value, bool *add)
+/*
+ * Advance the playback by the time passed on the clock since the previous
+ * tick or resetClock() and return the subtitle to show. With an absolute clock
+ * the playback follows the clock position, jumping back when it went back.
+ */
+QString SubtitleEngine::tick()
 {
-    if (value < 0) {
-        *add = false;
+    qint64 now = iClock->now();
+    qint64 expired = now - iLastTick;
 
-        if (value == INT_MIN)
-            return static_cast<unsigned int>(static_cast<unsigned int>(INT_MAX) + 1u);
+    if (iClock->isAbsolute()) {
+        iLastTick = now;
 
-        return static_cast<unsigned int>(-value);
-    } else {
-        *add = true;
-        return static_cast<unsigned int>(value);
+        if (now < 0)
+            now = 0;
+        else if (now > UINT_MAX)
+            now = UINT_MAX;
+
+        if (now >= iCursor.time())
+            return getSubtitle(static_cast<unsigned int>(now) - iCursor.time());
+
+        setTime(static_cast<unsigned int>(now));
+        return getSubtitle(0);
     }
-}
 
-unsigned int SubtitleEngine::getSubtitleStart(Subtitle *subtitle)
-{
-    if (!subtitle)
-        return 0;
+    iLastTick = now;
 
-    if (iTimeOffsetAdd) {
-        return subtitle->start_time + iTimeOffsetUnsigned;
-    } else {
-        // In case the subtraction would undeflow.
-        if (subtitle->start_time <= iTimeOffsetUnsigned)
-            return 0;
+    if (expired < 0)
+        expired = 0;
+    else if (expired > UINT_MAX)
+        expired = UINT_MAX;
 
-        return subtitle->start_time - iTimeOffsetUnsigned;
-    }
+    return getSubtitle(static_cast<unsigned int>(expired));
 }
 
-unsigned int SubtitleEngine::getSubtitleStart(int position)
+void SubtitleEngine::resetClock()
 {
-    if (position < 0 || position >= iSubtitles.size())
-        return 0;
+    iLastTick = iClock->now();
+}
 
-    return getSubtitleStart(iSubtitles.at(position));
+void SubtitleEngine::setClock(SubtitleClock *clock)
+{
+    iClock = clock ? clock : &iMonotonicClock;
+    resetClock();
 }
 
-unsigned int SubtitleEngine::getSubtitleEnd(Subtitle *subtitle)
+/*
+ * Follow the position of a MPRIS2 media player instead of the own clock.
+ * Returns false if no player is found on the session bus.
+ */
+bool SubtitleEngine::setMediaPlayerSync(bool enabled)
 {
-    if (!subtitle)
-        return 0;
+    if (!enabled) {
+        MprisClock *clock = iMprisClock;
+
+        if (clock) {
+            // Cleared first, deleting emits detached()
+            iMprisClock = nullptr;
+            setClock(nullptr);
+            delete clock;
+        }
+        return true;
+    }
 
-    if (iTimeOffsetAdd) {
-        return subtitle->end_time + iTimeOffsetUnsigned;
-    } else {
-        // In case the subtraction would undeflow.
-        if (subtitle->end_time <= iTimeOffsetUnsigned)
-            return 0;
+    if (iMprisClock)
+        return true;
 
-        return subtitle->end_time - iTimeOffsetUnsigned;
+    iMprisClock = new MprisClock(this);
+    if (!iMprisClock->attach()) {
+        delete iMprisClock;
+        iMprisClock = nullptr;
+        return false;
     }
-}
 
-unsigned int SubtitleEngine::getSubtitleEnd(int position)
-{
-    if (position < 0 || position >= iSubtitles.size())
-        return 0;
+    connect(iMprisClock, &MprisClock::playingChanged,
+            this, &SubtitleEngine::mediaPlayerPlayingChanged);
+    connect(iMprisClock, &MprisClock::detached,
+            this, &SubtitleEngine::mprisDetached);
+
+    setClock(iMprisClock);
 
-    return getSubtitleEnd(iSubtitles.at(position));
+    return true;
 }
 
-unsigned int SubtitleEngine::calcCurrentDuration()
+bool SubtitleEngine::isMediaPlayerPlaying()
 {
-    Subtitle *current = getSubtitleNow();
-    if (!current)
-        return 0;
-
-    return getSubtitleEnd(current) - getSubtitleStart(current);
+    return iMprisClock && iMprisClock->isPlaying();
 }
 
-unsigned int SubtitleEngine::calcCurrentDelay()
+void SubtitleEngine::mprisDetached()
 {
-    Subtitle *current = getSubtitleNow();
-    if (!current)
-        return 0;
+    if (!iMprisClock)
+        return;
 
-    unsigned int start = getSubtitleStart(current);
-    if (start <= iPrevEndTime)
-        return 0;
+    qDebug() << "media player detached, using own clock";
 
-    return start - iPrevEndTime;
+    setClock(nullptr);
+    iMprisClock->deleteLater();
+    iMprisClock = nullptr;
+
+    emit mediaPlayerDetached();
 }
 
-int SubtitleEngine::findPosition(unsigned int time, int min, int max) {
-    unsigned int start_time;
-    unsigned int end_time;
-    int mid;
+unsigned int SubtitleEngine::getCurrentTime()
+{
+    return iCursor.time();
+}
 
-    if (min < 0)
-        min = 0;
+/*
+ * Position of the subtitle shown at the playback time with the current
+ * offset, -1 when none is. Only const queries of the table are used.
+ */
+int SubtitleEngine::cueAt(unsigned int time)
+{
+    int position;
 
-    if (max >= static_cast<int>(iSubtitles.size()))
-        max = static_cast<int>(iSubtitles.size()) - 1;
+    if (iCursor.isBeforeStart(time))
+        return -1;
 
-    if (min >= max)
-        return min;
+    if (iEditsPending)
+        position = iEditor.cueAt(iCursor.tableTime(time));
+    else
+        position = iTable->cueAt(iCursor.tableTime(time));
 
-    mid = min + (max - min) / 2;
-    start_time = getSubtitleStart(mid);
-    end_time = getSubtitleEnd(mid);
+    if (position < 0 || iCursor.offsetTime(cue(position).start_time) > time)
+        return -1;
 
-    if (start_time < time && end_time < time)
-        return findPosition(time, mid + 1, max);
-    else if (start_time < time && end_time > time)
-        return mid;
-    else
-        return findPosition(time, min, mid - 1);
+    return position;
 }
 
-void SubtitleEngine::setTime(unsigned int time)
+/*
+ * Subtitle at the given time without changing the playback state. Uses the
+ * bucket table of the cue table so the cost does not depend on the length.
+ */
+QString SubtitleEngine::getScrubText(unsigned int time)
 {
-    Subtitle *tmp = nullptr;
-    int position = 0;
-    int size;
+    Subtitle subtitle;
+    int position;
+    bool ended;
 
-    if (iSubtitles.isEmpty())
-        return;
+    if (!iParser)
+        return QString("no parser");
 
-    size = iSubtitles.size();
-    iCurrentTime = time;
+    syncTable();
 
-    if (iTimeOffset < 0 && time <= static_cast<unsigned int>(INT_MAX)) {
-        int signedTime = static_cast<int>(time);
+    if (iTable->isEmpty())
+        return QString("<subtitles end>");
 
-        if (signedTime + iTimeOffset < 0) {
-            iState = SUB_STATE_INIT_DELAY;
-            iInitDelay = -iTimeOffset - signedTime;
-            qDebug() << "set init delay with offset" << iTimeOffset << "to" << iInitDelay;
-            return;
-        }
+    position = cueAt(time);
+    if (position >= 0) {
+        subtitle = cue(position);
+        return iParser->getSubtitleText(&subtitle);
     }
 
-    if (time) {
-        position = findPosition(time, 0, size - 1);
-        if (position > 0)
-            /* Just to be sure in case the set time overlaps */
-            position--;
-    }
+    if (iCursor.isBeforeStart(time))
+        return QString("");
 
-    for (; position < size ; position++) {
-        tmp = iSubtitles.at(position);
-        unsigned int start_time = getSubtitleStart(tmp);
-        unsigned int end_time = getSubtitleEnd(tmp);
+    if (iEditsPending)
+        ended = iEditor.findPosition(iCursor.tableTime(time)) >= iEditor.size();
+    else
+        ended = iTable->findPosition(iCursor.tableTime(time)) >= iTable->size();
 
-        // delay
-        if (start_time > time) {
-            iState = SUB_STATE_DELAY;
-            setEngineSubTime(start_time - time);
-            iPrevEndTime = 0;
-            break;
-        }
+    return ended ? QString("<subtitles end>") : QString("");
+}
 
-        // duration
-        if (start_time <= time && end_time >= time) {
-            iState = SUB_STATE_DURATION;
-            setEngineSubTime(end_time - time);
-            iPrevEndTime = end_time;
-            break;
-        }
+// Playback time after the given one when the shown subtitle changes
+unsigned int SubtitleEngine::getNextChange(unsigned int time)
+{
+    unsigned int change;
 
-        /*if (start_time <= time && end_time > time &&
-                ((position + 1) < size && getSubtitleStart(position + 1) > time)) {
-            iState = SUB_STATE_DURATION;
-            setEngineSubTime(end_time - (time - start_time));
-            iPrevEndTime = end_time;
-            break;
-        }*/
-    }
+    syncTable();
+
+    if (iCursor.isBeforeStart(time))
+        return static_cast<unsigned int>(-iCursor.offset());
 
-    if (tmp)
-        iCurrentIndex = tmp->index - 1; // Subtitles start from 1
+    if (iEditsPending)
+        change = iEditor.nextChangeAfter(iCursor.tableTime(time));
     else
-        qDebug() << "not found, tmp null";
+        change = iTable->nextChangeAfter(iCursor.tableTime(time));
+    if (change == UINT_MAX)
+        return UINT_MAX;
 
-    return;
+    // Offset may map several table times to the same playback time
+    return qMax(iCursor.offsetTime(change), time + 1);
 }
 
-QString SubtitleEngine::getSubtitle(unsigned int time)
+/*
+ * Subtitles shown between the playback times as maps of the start and end
+ * times with the offset applied and the text.
+ */
+QVariantList SubtitleEngine::getSubtitlesInRange(unsigned int from, unsigned int to)
 {
+    QVariantList subtitles;
+    QVector<int> positions;
+
     if (!iParser)
-        return QString("no parser");
+        return subtitles;
 
-    if (!iSubtitles.size())
-        return QString("<subtitles end>");
+    syncTable();
 
-    if (time)
-        increaseTime(time);
+    if (iEditsPending)
+        positions = iEditor.cuesInRange(iCursor.tableTime(from),
+                                        iCursor.tableTime(to));
+    else
+        positions = iTable->cuesInRange(iCursor.tableTime(from),
+                                        iCursor.tableTime(to));
 
-    Subtitle* current = getSubtitleNow();
-    if (!current)
-        return QString("<subtitles end>");
+    for (int position : positions) {
+        Subtitle subtitle = cue(position);
+        QVariantMap map;
 
-    switch(iState) {
-    case SUB_STATE_INIT:
-    case SUB_STATE_INIT_DELAY:
-    case SUB_STATE_DELAY:
-        return QString("");
-    case SUB_STATE_DURATION:
-        return iParser->getSubtitleText(current);
-    case SUB_STATE_END:
-        return QString("<subtitles end>");
-    default:
-        return QString("");
+        map.insert(QStringLiteral("start"), iCursor.offsetTime(subtitle.start_time));
+        map.insert(QStringLiteral("end"), iCursor.offsetTime(subtitle.end_time));
+        map.insert(QStringLiteral("text"), iParser->getSubtitleText(&subtitle));
+        subtitles.append(map);
     }
+
+    return subtitles;
 }
 
-bool SubtitleEngine::setOffset(int offset)
+/*
+ * Request the subtitle for a slider position. Bursts of requests are
+ * coalesced and only the latest one is resolved, the result is delivered
+ * with scrubTextChanged().
+ */
+void SubtitleEngine::scrubTo(unsigned int time)
 {
-    int diff = iTimeOffset - offset;
-    iTimeOffset = offset;
+    iScrubTime = time;
 
-    iTimeOffsetUnsigned = getUnsigned(iTimeOffset, &iTimeOffsetAdd);
+    if (iScrubPending)
+        return;
 
-    // TODO possible int overflow...
-    if (iPrevEndTime < static_cast<unsigned int>(INT_MAX) &&
-                static_cast<int>(iPrevEndTime) + diff < 0)
-        iPrevEndTime = 0;
-    else if (iTimeOffsetAdd)
-        iPrevEndTime += iTimeOffsetUnsigned;
-    else if (iPrevEndTime)
-        iPrevEndTime -= iTimeOffsetUnsigned;
+    iScrubPending = true;
+    QMetaObject::invokeMethod(this, "processScrub", Qt::QueuedConnection);
+}
 
-    setTime(iCurrentTime);
+void SubtitleEngine::processScrub()
+{
+    if (!iScrubPending)
+        return;
+
+    iScrubPending = false;
+    emit scrubTextChanged(getScrubText(iScrubTime));
+}
+
+// Drop pending scrub requests and seek the playback to the final position
+void SubtitleEngine::endScrub(unsigned int time)
+{
+    iScrubPending = false;
+    setTime(time);
+}
+
+bool SubtitleEngine::setOffset(int offset)
+{
+    iCursor.setOffset(offset);
+    updateDensity();
+
+    setTime(iCursor.time());
+    emit offsetChanged();
 
     return true;
 }
 
+unsigned int SubtitleEngine::playbackTime(unsigned int tableTime)
+{
+    return iCursor.offsetTime(tableTime);
+}
+
+CueTableRef SubtitleEngine::getTable()
+{
+    syncTable();
+
+    return iTable;
+}
+
+QString SubtitleEngine::getFormat()
+{
+    return iFormat;
+}
+
+QVector<float> SubtitleEngine::getDensity()
+{
+    return iDensity;
+}
+
+void SubtitleEngine::updateDensity()
+{
+    iDensity = DensityTimeline::compute(*iTable, iCursor, iTotalTime,
+                                        DENSITY_BUCKETS);
+    emit densityChanged(++iDensityGeneration);
+}
+
+int SubtitleEngine::getDisplayedIndex()
+{
+    return iDisplayedIndex;
+}
+
 unsigned int SubtitleEngine::getTotalTime()
 {
+    syncTable();
+
     return iTotalTime;
 }
 
@@ -513,50 +746,652 @@ QString SubtitleEngine::getFallbackCodec()
     return iFallbackCodec;
 }
 
-void SubtitleEngine::freeSubtitles()
+// Written in the format it was read in, tracks of containers are not
+bool SubtitleEngine::canSaveSubtitle()
+{
+    return SubtitleWriter::isSupported(iFormat);
+}
+
+int SubtitleEngine::saveSubtitle(const QString filePath)
+{
+    SubtitleWriter *writer;
+    int err;
+
+    publishEdits();
+    syncTable();
+
+    if (iTable->isEmpty())
+        return -ENOENT;
+
+    writer = SubtitleWriter::createWriter(iFormat);
+    if (!writer) {
+        qWarning() << "no writer available for format" << iFormat;
+        return -ENOTSUP;
+    }
+
+    qDebug() << "save" << filePath << "with offset" << iCursor.offset();
+
+    err = writer->openFile(filePath);
+    if (!err)
+        err = writer->writeSubtitles(iTable->subtitles(), iCursor.offset(),
+                                     iParser ? iParser->getFps() : 0.0);
+
+    writer->closeFile();
+    delete writer;
+
+    return err;
+}
+
+// Ending of the loaded subtitle, also when read from a compressed file
+QString SubtitleEngine::getSubtitleSuffix()
+{
+    return Parser::subtitleSuffix(iPath);
+}
+
+// File picker filters of the types the parser engines read
+QStringList SubtitleEngine::getNameFilters()
 {
-    Subtitle *subtitle;
+    return ParserEngineFactory::instance().nameFilters();
+}
+
+/*
+ * Errors skipped when the current subtitle was loaded, as maps of the byte
+ * offset, line number and error description.
+ */
+QVariantList SubtitleEngine::getDiagnostics()
+{
+    QVariantList diagnostics;
+
+    for (const SubParseDiagnostic &diagnostic : iDiagnostics) {
+        QVariantMap map;
+
+        map.insert(QStringLiteral("offset"), diagnostic.offset);
+        map.insert(QStringLiteral("line"), diagnostic.line);
+        map.insert(QStringLiteral("error"), parseErrorToStr(diagnostic.error));
+        diagnostics.append(map);
+    }
+
+    return diagnostics;
+}
+
+// Subtitle tracks of the loaded container file
+QVariantList SubtitleEngine::getTracks()
+{
+    QVariantList tracks;
+
+    for (const SubTrack &track : iTracks) {
+        QVariantMap map;
+
+        map.insert(QStringLiteral("number"), track.number);
+        map.insert(QStringLiteral("codec"), track.codec);
+        map.insert(QStringLiteral("language"), track.language);
+        map.insert(QStringLiteral("name"), track.name);
+        map.insert(QStringLiteral("selected"), track.number == iTrack);
+        tracks.append(map);
+    }
+
+    return tracks;
+}
+
+/*
+ * Parse another track of the loaded container file, the playback continues
+ * from the current time.
+ */
+SubtitleEngine::SubtitleLoadStatus SubtitleEngine::selectTrack(int number)
+{
+    ParsedSubtitle parsed;
+    SubtitleLoadStatus status;
+    int err;
+
+    if (!iParser || iPath.isEmpty())
+        return SUBTITLE_LOAD_STATUS_FAILURE;
+
+    if (number == iTrack)
+        return SUBTITLE_LOAD_STATUS_OK;
 
-    if (iSubtitles.empty())
+    // Parser has not read the tracks when the file came from the cache
+    if (iParser->getTracks().isEmpty()) {
+        err = iParser->openSubtitle(iPath);
+        if (err) {
+            qWarning() << "cannot read tracks of" << iPath << strerror(-err);
+            return SUBTITLE_LOAD_STATUS_FAILURE;
+        }
+
+        iParser->closeSubtitle();
+    }
+
+    if (!iParser->selectTrack(number))
+        return SUBTITLE_LOAD_STATUS_NOT_SUPPORTED;
+
+    qDebug() << "select track" << number;
+
+    status = parseFile(iParser, iPath, iFallbackCodec, parsed);
+    switch (status) {
+    case SUBTITLE_LOAD_STATUS_OK:
+    case SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+    case SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        break;
+    default:
+        return status;
+    }
+
+    iDiagnostics = parsed.diagnostics;
+    iTracks = parsed.tracks;
+    iTrack = parsed.track;
+    iFormat = parsed.format;
+
+    // Text of the previous track is not needed back
+    iTextReleased = false;
+    iTextStored = true;
+    publishSubtitles(parsed.subtitles);
+    syncTable();
+    updateFingerprint();
+
+    return status;
+}
+
+/*
+ * Guess the FPS of frame based subtitles loaded without one. The length of
+ * the video in milliseconds is taken from the followed media player when not
+ * given, 0 if not known. The result map has the fps and certain, set when it
+ * can be used without asking.
+ */
+QVariantMap SubtitleEngine::suggestFps(unsigned int videoLength)
+{
+    QVariantMap result;
+    FpsEstimate estimate;
+    qint64 length = videoLength;
+
+    publishEdits();
+    syncTable();
+
+    if (!length && iMprisClock)
+        length = iMprisClock->length();
+
+    estimate = FpsEstimator::estimate(iTable->subtitles(), length);
+
+    qDebug() << "suggested FPS" << estimate.fps << "margin" << estimate.margin <<
+                "video length" << length;
+
+    result.insert(QStringLiteral("fps"), estimate.fps);
+    result.insert(QStringLiteral("certain"), estimate.certain);
+
+    return result;
+}
+
+/*
+ * Find the offset, and the frame rate conversion when searchScale is set,
+ * that matches the loaded subtitles to a correctly timed reference, e.g. the
+ * subtitles of another language. Nothing is applied, the result map has the
+ * offset in milliseconds, the scale and the confidence from 0.0 to 1.0. The
+ * map is empty when the reference can't be read.
+ */
+QVariantMap SubtitleEngine::alignTo(const QString &referencePath, bool searchScale)
+{
+    ParsedSubtitle parsed;
+    SubtitleLoadStatus status;
+    QVariantMap result;
+    AlignResult aligned;
+    Parser *parser;
+
+    publishEdits();
+    syncTable();
+
+    if (iTable->isEmpty())
+        return result;
+
+    parser = ParserEngineFactory::instance().getEngine(Parser::subtitleSuffix(referencePath));
+    if (!parser)
+        parser = ParserEngineFactory::instance().detectEngine(referencePath);
+    if (!parser) {
+        qWarning() << "no parser available for reference" << referencePath;
+        return result;
+    }
+
+    status = parseFile(parser, referencePath, iFallbackCodec, parsed);
+    delete parser;
+
+    switch (status) {
+    case SUBTITLE_LOAD_STATUS_OK:
+    case SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+    case SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        break;
+    default:
+        qWarning() << "reading reference failed with status" << status;
+        return result;
+    }
+
+    if (parsed.subtitles.isEmpty())
+        return result;
+
+    CueTable reference(parsed.subtitles);
+    aligned = SubtitleAligner(reference, *iTable).align(searchScale);
+
+    result.insert(QStringLiteral("offset"), aligned.offset);
+    result.insert(QStringLiteral("scale"), aligned.scale);
+    result.insert(QStringLiteral("confidence"), aligned.confidence);
+
+    return result;
+}
+
+// Multiply the subtitle times, e.g. to convert between frame rates
+void SubtitleEngine::scaleTime(double scale)
+{
+    if (scale <= 0.0 || scale == 1.0)
         return;
 
-    qDebug() << "free subtitle list";
+    qDebug() << "scaling time by" << scale;
+    publishEdits();
+    flushStream();
+
+    // Published table is immutable, recalculate a copy and replace it
+    SubtitleList subtitles = iTable->subtitles();
+    for (Subtitle &subtitle : subtitles) {
+        subtitle.start_time = static_cast<unsigned int>(subtitle.start_time * scale);
+        subtitle.end_time = static_cast<unsigned int>(subtitle.end_time * scale);
+    }
+    publishSubtitles(subtitles);
+    syncTable();
+    iTimeScale *= scale;
+
+    if (iStream)
+        iStreamSubtitles = subtitles;
+}
+
+/*
+ * Fingerprint the file just loaded and look up a correction confirmed for
+ * it earlier. Hashing is a single pass over the cues, much less than the
+ * parse.
+ */
+void SubtitleEngine::updateFingerprint()
+{
+    iFingerprint = FingerprintIndex::compute(*iTable);
+    iHasKnownCorrection = iFingerprints.lookup(iFingerprint, iKnownCorrection);
+    iTimeScale = 1.0;
+}
+
+/*
+ * Correction remembered for the loaded file as a map of the offset, the
+ * scale and the FPS of frame based files, empty when the file is not known.
+ */
+QVariantMap SubtitleEngine::getKnownCorrection()
+{
+    QVariantMap result;
+
+    if (!iHasKnownCorrection)
+        return result;
+
+    result.insert(QStringLiteral("offset"), iKnownCorrection.offset);
+    result.insert(QStringLiteral("scale"), iKnownCorrection.scale);
+    result.insert(QStringLiteral("fps"), iKnownCorrection.fps);
+
+    return result;
+}
+
+// Remember the offset, the scale and the FPS applied to the loaded file
+int SubtitleEngine::rememberCorrection(int offset)
+{
+    SyncCorrection correction;
+    int err;
+
+    if (iFingerprint.isEmpty())
+        return -ENOENT;
+
+    correction.offset = offset;
+    correction.scale = iTimeScale;
+    // Scale and offset of frame based files are only valid at the same FPS
+    correction.fps = iFormat == QStringLiteral("microdvd") && iParser ?
+                iParser->getFps() : 0.0;
+
+    err = iFingerprints.remember(iFingerprint, QFileInfo(iPath).fileName(),
+                                 correction);
+    if (err) {
+        qWarning() << "failed to remember sync correction" << err;
+        return err;
+    }
+
+    iKnownCorrection = correction;
+    iHasKnownCorrection = true;
+
+    return 0;
+}
+
+// Cached and indexed data is released to stay within, 0 for no limit
+void SubtitleEngine::setMemoryBudget(int megabytes)
+{
+    iMemory->setBudget(static_cast<qint64>(megabytes) * 1024 * 1024);
+}
+
+// Text can be dropped only when it is the same as in the loaded file
+qint64 SubtitleEngine::memoryCost()
+{
+    if (!iParser || !iTextStored || iTextReleased || iEditsPending)
+        return 0;
+
+    return iTable->textCost();
+}
+
+/*
+ * Drop the text of the cues at critical memory level and keep the times, so
+ * that the cursor and the queries keep working. Text is all or nothing, it is
+ * read back from the file on the next use of the table.
+ */
+qint64 SubtitleEngine::releaseMemory(qint64 bytes)
+{
+    SubtitleList subtitles;
+    qint64 cost = memoryCost();
+
+    Q_UNUSED(bytes);
+
+    if (!cost)
+        return 0;
+
+    subtitles = iTable->subtitles();
+    for (Subtitle &subtitle : subtitles)
+        subtitle.text = QString();
+
+    // Unedited copy in the editor would keep the text alive
+    iEditor.reset(SubtitleList());
+    iEditorTable.clear();
+
+    publishSubtitles(subtitles);
+    syncTable();
+    iTextReleased = true;
+
+    qDebug() << "released text of" << iPath << cost << "bytes";
+
+    return cost;
+}
+
+/*
+ * Read the text dropped on low memory back from the file, or from the cache
+ * if it was parsed again meanwhile. Positions are the same as long as the file
+ * is, times of the table are kept as they may have been scaled since.
+ */
+void SubtitleEngine::restoreText()
+{
+    ParsedSubtitle parsed;
+    SubtitleList subtitles;
+    SubtitleLoadStatus status = SUBTITLE_LOAD_STATUS_OK;
+
+    iTextReleased = false;
+
+    // Table published meanwhile, e.g. for another FPS, is the one to fill
+    syncTable();
+
+    if (!iCache->lookup(SubtitleCache::cacheKey(iPath, iFallbackCodec), parsed) ||
+            parsed.track != iTrack)
+        status = parseFile(iParser, iPath, iFallbackCodec, parsed);
+
+    switch (status) {
+    case SUBTITLE_LOAD_STATUS_OK:
+    case SUBTITLE_LOAD_STATUS_OK_NEED_FPS:
+    case SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS:
+        break;
+    default:
+        qWarning() << "cannot read text back from" << iPath << "status" << status;
+        iTextStored = false;
+        return;
+    }
 
-    if (iParser) {
-        foreach (subtitle, iSubtitles)
-            iParser->freeSubtitle(subtitle);
+    CueTable source(parsed.subtitles);
+
+    if (source.size() != iTable->size()) {
+        qWarning() << iPath << "has changed, using it as it is now";
+        publishSubtitles(parsed.subtitles);
+        return;
+    }
+
+    subtitles = iTable->subtitles();
+    for (int i = 0; i < subtitles.size(); i++)
+        subtitles[i].text = source.at(i).text;
+
+    publishSubtitles(subtitles);
+
+    qDebug() << "text read back from" << iPath;
+}
+
+/*
+ * Cues are edited in the editor tree, which playback and the queries by time
+ * read until the result is published as a new table. Building the table is
+ * O(n), it is done at most once per interval however fast the edits come,
+ * unless an edit moves cues to other positions.
+ */
+void SubtitleEngine::ensureEditor()
+{
+    // Editor is ahead of the table until the edits are published
+    if (iEditsPending)
+        return;
+
+    syncTable();
+
+    if (iEditorTable == iTable)
+        return;
+
+    iEditor.reset(iTable->subtitles());
+    iEditorTable = iTable;
+}
+
+bool SubtitleEngine::editDone(bool changed)
+{
+    if (!changed)
+        return false;
+
+    // Edited text is no longer the one in the file
+    iTextStored = false;
+    iEditsPending = true;
+
+    // Transcript rows are the positions of the table, edits moving cues to
+    // other positions are published right away
+    if (iEditor.hasMoved()) {
+        publishEdits();
+        return true;
     }
 
-    iSubtitles.clear();
+    // Cue may have moved in time, resolve the shown one again in the editor
+    iCursor.setEditor(&iEditor);
+    setTime(iCursor.time());
+
+    if (!iEditTimer.isActive())
+        iEditTimer.start();
+
+    return true;
+}
+
+// Cue of the editor while its edits are pending, of the table otherwise
+Subtitle SubtitleEngine::cue(int position)
+{
+    return iEditsPending ? iEditor.at(position) : iTable->at(position);
+}
+
+void SubtitleEngine::publishEdits()
+{
+    SubtitleList subtitles;
+    CueTableRef table;
+
+    iEditTimer.stop();
+
+    if (!iEditsPending)
+        return;
+
+    iEditsPending = false;
+
+    // Edits were made on a table replaced since, e.g. by loading a file
+    syncTable();
+    if (iEditorTable != iTable) {
+        qDebug() << "table replaced, edits dropped";
+        flushStream();
+        return;
+    }
+
+    // Cues streamed meanwhile are added to the editor and its undo versions
+    if (!iStreamPending.isEmpty()) {
+        iEditor.append(iStreamPending);
+        iStreamPending.clear();
+        iStreamTimer.stop();
+    }
+
+    // Cues come out in order, the table is built without sorting. Frames
+    // follow the edits so that the times calculated from them for another
+    // FPS keep the edits.
+    if (iParser && iFormat == QStringLiteral("microdvd"))
+        subtitles = iEditor.subtitles(iParser->getFps());
+    else
+        subtitles = iEditor.subtitles();
+
+    table = CueTableRef(new CueTable(subtitles));
+    iEditorTable = table;
+    iEditor.clearMoved();
+
+    iMailbox.publish(table);
+    syncTable();
+
+    if (iStream)
+        iStreamSubtitles = subtitles;
+}
+
+// Move the cues of the positions from and to by delta milliseconds
+bool SubtitleEngine::shiftCues(int from, int to, int delta)
+{
+    ensureEditor();
+
+    return editDone(iEditor.shift(from, to, delta));
+}
+
+// Scale the cues of the positions from and to from the start of the first
+bool SubtitleEngine::stretchCues(int from, int to, double scale)
+{
+    ensureEditor();
+
+    return editDone(iEditor.stretch(from, to, scale));
+}
+
+// Time is a playback time, as shown in the transcript
+bool SubtitleEngine::splitCue(int position, unsigned int time)
+{
+    ensureEditor();
+
+    return editDone(iEditor.split(position, iCursor.tableTime(time)));
+}
+
+// Join the cue with the one after it
+bool SubtitleEngine::mergeCues(int position)
+{
+    ensureEditor();
+
+    return editDone(iEditor.merge(position));
+}
+
+bool SubtitleEngine::setCueText(int position, const QString &text)
+{
+    ensureEditor();
+
+    return editDone(iEditor.setText(position, text));
+}
+
+bool SubtitleEngine::undoEdit()
+{
+    ensureEditor();
+
+    return editDone(iEditor.undo());
+}
+
+bool SubtitleEngine::canUndoEdit()
+{
+    ensureEditor();
+
+    return iEditor.canUndo();
+}
+
+void SubtitleEngine::freeSubtitles()
+{
+    // Stream feeds the parser, stop it first
+    delete iStream;
+    iStream = nullptr;
+    iStreamSubtitles.clear();
+    iStreamPending.clear();
+    iStreamTimer.stop();
+    iEditTimer.stop();
+
+    delete iParser;
+    iParser = nullptr;
+
+    // Nothing to read the released text back with
+    iTextStored = false;
+    iTextReleased = false;
+
+    if (iTable->isEmpty())
+        return;
+
+    qDebug() << "free subtitle list";
+
+    publishSubtitles(SubtitleList());
+    syncTable();
+    iEditor.reset(SubtitleList());
+    iEditorTable.clear();
+    iEditsPending = false;
+    iPath.clear();
+    iDiagnostics.clear();
+    iTracks.clear();
+    iTrack = -1;
+    iFormat.clear();
+    iFingerprint.clear();
+    iHasKnownCorrection = false;
 
     resetEngine();
 }
 
 void SubtitleEngine::resetEngine()
 {
-    iCurrentIndex = -1;
+    iDisplayedIndex = -1;
+    iScrubTime = 0;
+    iScrubPending = false;
     iParser = nullptr;
 
-    iCurrentTime = 0;
+    iCursor.reset();
     iTotalTime = 0;
-    iPrevEndTime = 0;
-    iDelay = 0;
-    iDuration = 0;
-    iState = SUB_STATE_INIT;
-    iTimeOffset = 0;
-    iTimeOffsetUnsigned = 0;
-    iTimeOffsetAdd = true;
 
     if (iFallbackCodec.isEmpty())
         iFallbackCodec = QString("Windows-1252");
 }
 
-Subtitle *SubtitleEngine::getSubtitleNow()
+void SubtitleEngine::publishSubtitles(const SubtitleList &subtitles)
+{
+    iMailbox.publish(CueTableRef(new CueTable(subtitles)));
+}
+
+/*
+ * Take the latest published table into use. The previous one stays valid for
+ * as long as someone else holds a reference to it.
+ */
+bool SubtitleEngine::syncTable()
 {
-    if (iCurrentIndex < 0 || iSubtitles.isEmpty() || iCurrentIndex > iSubtitles.size() - 1)
-        return nullptr;
+    CueTableRef table;
+
+    if (iTextReleased)
+        restoreText();
+
+    if (!iMailbox.take(table))
+        return false;
 
-    return iSubtitles.at(iCurrentIndex);
+    iTable = table;
+    iCursor.setTable(iTable);
+    iTotalTime = iTable->totalTime();
+    iDisplayedIndex = -1;
+    updateDensity();
+
+    iMemory->setResident(iTable->memoryCost() - memoryCost());
+    iMemory->trim();
+
+    emit tableChanged();
+
+    if (iTable->isEmpty())
+        return true;
+
+    // Indexes are not valid between tables, resolve position again
+    setTime(iCursor.time());
+
+    return true;
 }
 
 SubtitleEngine* SubtitleEngine::iEngine = nullptr;
@@ -566,6 +1401,34 @@ SubtitleEngine::SubtitleEngine(QObject *parent) :
 {
     qDebug() << "engine init";
 
+    iTable = CueTableRef(new CueTable(SubtitleList()));
+    iCache = new SubtitleCache(this);
+    iMemory = new MemoryBudget(this);
+    iMemory->addConsumer(iCache, MEMORY_RANK_SPECULATIVE);
+    iMemory->addConsumer(&iFingerprints, MEMORY_RANK_STORED);
+    iMemory->addConsumer(this, MEMORY_RANK_ACTIVE);
+    iClock = &iMonotonicClock;
+    iMprisClock = nullptr;
+    iStream = nullptr;
+    iTrack = -1;
+    iHasKnownCorrection = false;
+    iTimeScale = 1.0;
+    iEditsPending = false;
+    iTextStored = false;
+    iTextReleased = false;
+    iDensityGeneration = 0;
+    iLastTick = iClock->now();
+
+    iStreamTimer.setSingleShot(true);
+    iStreamTimer.setInterval(STREAM_PUBLISH_INTERVAL);
+    connect(&iStreamTimer, &QTimer::timeout,
+            this, &SubtitleEngine::flushStream);
+
+    iEditTimer.setSingleShot(true);
+    iEditTimer.setInterval(EDIT_PUBLISH_INTERVAL);
+    connect(&iEditTimer, &QTimer::timeout,
+            this, &SubtitleEngine::publishEdits);
+
     resetEngine();
 }
 
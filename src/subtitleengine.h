@@ -21,11 +21,23 @@
 #define SUBTITLEENGINE_H
 
 #include <QObject>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
 #include "types.h"
 #include "parser.h"
 #include "parserenginefactory.h"
+#include "subtitlecache.h"
+#include "memorybudget.h"
+#include "cuetable.h"
+#include "cueeditor.h"
+#include "playbackcursor.h"
+#include "fingerprintindex.h"
+#include "subtitleclock.h"
+#include "mprisclock.h"
+#include "subtitlestream.h"
 
-class SubtitleEngine : public QObject
+class SubtitleEngine : public QObject, public MemoryConsumer
 {
     Q_OBJECT
 public:
@@ -38,56 +50,155 @@ public:
         SUBTITLE_LOAD_STATUS_ACCESS_DENIED,
         SUBTITLE_LOAD_STATUS_NOT_SUPPORTED,
         SUBTITLE_LOAD_STATUS_PARSE_FAILURE,
-        SUBTITLE_LOAD_STATUS_FAILURE
+        SUBTITLE_LOAD_STATUS_FAILURE,
+        SUBTITLE_LOAD_STATUS_OK_WITH_ERRORS
     };
     Q_ENUM(SubtitleLoadStatus);
 
     Q_INVOKABLE SubtitleEngine::SubtitleLoadStatus loadSubtitle(QString str);
+    Q_INVOKABLE SubtitleEngine::SubtitleLoadStatus openStream(const QString &source,
+                                                              const QString &format);
     Q_INVOKABLE void unloadSubtitle();
     Q_INVOKABLE void updateFps(double fps);
     Q_INVOKABLE void increaseTime(unsigned int time);
     Q_INVOKABLE void setTime(unsigned int time);
     Q_INVOKABLE QString getSubtitle(unsigned int time_increase);
+    Q_INVOKABLE QString tick();
+    Q_INVOKABLE void resetClock();
+    Q_INVOKABLE bool setMediaPlayerSync(bool enabled);
+    Q_INVOKABLE bool isMediaPlayerPlaying();
+    Q_INVOKABLE unsigned int getCurrentTime();
+    Q_INVOKABLE void scrubTo(unsigned int time);
+    Q_INVOKABLE void endScrub(unsigned int time);
+    Q_INVOKABLE QString getScrubText(unsigned int time);
+    Q_INVOKABLE unsigned int getNextChange(unsigned int time);
+    Q_INVOKABLE QVariantList getSubtitlesInRange(unsigned int from, unsigned int to);
     Q_INVOKABLE bool setOffset(int offset);
     Q_INVOKABLE static SubtitleEngine* initEngine();
     Q_INVOKABLE unsigned int getTotalTime();
     Q_INVOKABLE int setFallbackCodec(const QString fallbackCodec);
     Q_INVOKABLE QString getFallbackCodec();
+    Q_INVOKABLE bool canSaveSubtitle();
+    Q_INVOKABLE int saveSubtitle(const QString filePath);
+    Q_INVOKABLE QString getSubtitleSuffix();
+    Q_INVOKABLE QStringList getNameFilters();
+    Q_INVOKABLE QVariantList getDiagnostics();
+    Q_INVOKABLE QVariantList getTracks();
+    Q_INVOKABLE SubtitleEngine::SubtitleLoadStatus selectTrack(int number);
+    Q_INVOKABLE QVariantMap alignTo(const QString &referencePath, bool searchScale);
+    Q_INVOKABLE void scaleTime(double scale);
+    Q_INVOKABLE QVariantMap suggestFps(unsigned int videoLength);
+    Q_INVOKABLE QVariantMap getKnownCorrection();
+    Q_INVOKABLE int rememberCorrection(int offset);
+    Q_INVOKABLE void setMemoryBudget(int megabytes);
+    Q_INVOKABLE bool shiftCues(int from, int to, int delta);
+    Q_INVOKABLE bool stretchCues(int from, int to, double scale);
+    Q_INVOKABLE bool splitCue(int position, unsigned int time);
+    Q_INVOKABLE bool mergeCues(int position);
+    Q_INVOKABLE bool setCueText(int position, const QString &text);
+    Q_INVOKABLE bool undoEdit();
+    Q_INVOKABLE bool canUndoEdit();
+
+    // Can be called from any thread, taken into use on the next engine call
+    void publishSubtitles(const SubtitleList &subtitles);
+    CueTableRef getTable();
+    // Format of the loaded subtitle as named by its parser
+    QString getFormat();
+    // Clock is not owned, nullptr restores the default monotonic clock
+    void setClock(SubtitleClock *clock);
+    int getDisplayedIndex();
+    QVector<float> getDensity();
+    // Time in the table as on the playback position, with the offset
+    unsigned int playbackTime(unsigned int tableTime);
+
+    // Text of the cues of an unedited file, read back on the next use
+    qint64 memoryCost();
+    qint64 releaseMemory(qint64 bytes);
+
+    static SubtitleLoadStatus parseFile(Parser *parser, const QString &file,
+                                        const QString &fallbackCodec,
+                                        ParsedSubtitle &parsed);
 
     ~SubtitleEngine();
 
+signals:
+    // Table in use was replaced, positions of the old one are not valid
+    void tableChanged();
+    // Position of the shown subtitle in the table, -1 when none is shown
+    void displayedIndexChanged(int position);
+    // Subtitle at the latest scrubTo() time
+    void scrubTextChanged(const QString &text);
+    // Playback state of the followed media player changed
+    void mediaPlayerPlayingChanged(bool playing);
+    // Followed media player went away, default clock is in use again
+    void mediaPlayerDetached();
+    // Subtitle density timeline was computed again
+    void densityChanged(int generation);
+    // Playback times of the cues moved
+    void offsetChanged();
+
+private slots:
+    void processScrub();
+    void mprisDetached();
+    void streamCuesReceived(const SubtitleList &cues);
+    void streamFinished();
+    void flushStream();
+    void publishEdits();
+
 private:
     void freeSubtitles(void);
+    bool syncTable();
     void setupSubtitles();
     void resetEngine();
-    Subtitle *getSubtitleNow();
-    int findPosition(unsigned int time, int min, int max);
-    void setEngineSubTime(unsigned int time);
-    unsigned int getSubtitleStart(Subtitle *subtitle);
-    unsigned int getSubtitleStart(int position);
-    unsigned int getSubtitleEnd(Subtitle *subtitle);
-    unsigned int getSubtitleEnd(int position);
-    unsigned int calcCurrentDuration();
-    unsigned int calcCurrentDelay();
+    void setDisplayedIndex(int position);
+    int cueAt(unsigned int time);
+    void updateDensity();
+    void updateFingerprint();
+    void ensureEditor();
+    bool editDone(bool changed);
+    Subtitle cue(int position);
+    void restoreText();
 
     static SubtitleEngine* iEngine;
 
     Parser* iParser;
+    SubtitleCache *iCache;
+    MemoryBudget *iMemory;
+    MonotonicClock iMonotonicClock;
+    SubtitleClock *iClock;
+    MprisClock *iMprisClock;
+    SubtitleStream *iStream;
+    SubtitleList iStreamSubtitles;
+    SubtitleList iStreamPending; // Received, not yet in the table
+    QTimer iStreamTimer;
+    qint64 iLastTick;
 
-    QList<Subtitle*> iSubtitles;
+    CueTableMailbox iMailbox;
+    CueTableRef iTable;
+    PlaybackCursor iCursor;
+    CueEditor iEditor;
+    CueTableRef iEditorTable;
+    bool iEditsPending; // Editor is ahead of the table, playback reads it
+    QTimer iEditTimer;
     QString iPath;
+    bool iTextStored;   // Text of the table can be read again from iPath
+    bool iTextReleased; // Table holds only the times, text is in iPath
+    SubParseDiagnostics iDiagnostics;
+    SubTrackList iTracks;
+    int iTrack;
+    QString iFormat;
+    FingerprintIndex iFingerprints;
+    Fingerprint iFingerprint;
+    SyncCorrection iKnownCorrection;
+    bool iHasKnownCorrection;
+    double iTimeScale;
     QString iFallbackCodec;
-    unsigned int iCurrentTime;
     unsigned int iTotalTime;
-    int iTimeOffset;
-    unsigned int iTimeOffsetUnsigned;
-    bool iTimeOffsetAdd;
-    unsigned int iPrevEndTime;
-    unsigned int iInitDelay;
-    unsigned int iDelay;
-    unsigned int iDuration;
-    SubState iState;
-    int iCurrentIndex;
+    QVector<float> iDensity;
+    int iDensityGeneration;
+    int iDisplayedIndex;
+    unsigned int iScrubTime;
+    bool iScrubPending;
 };
 
 #endif // SUBTITLEENGINE_H
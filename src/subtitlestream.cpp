@@ -0,0 +1,163 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "subtitlestream.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <QLocalSocket>
+#include <QSocketNotifier>
+#include <QtDebug>
+
+#define STREAM_CONNECT_TIMEOUT 3000
+#define STREAM_READ_SIZE 4096
+
+SubtitleStream::SubtitleStream(Parser *parser, QObject *parent) :
+    QObject(parent),
+    iParser(parser),
+    iSocket(nullptr),
+    iNotifier(nullptr),
+    iFd(-1)
+{
+    iParser->beginFeed(&iResult);
+}
+
+SubtitleStream::~SubtitleStream()
+{
+    close();
+}
+
+bool SubtitleStream::openLocalSocket(const QString &name)
+{
+    iSocket = new QLocalSocket(this);
+    connect(iSocket, &QLocalSocket::readyRead,
+            this, &SubtitleStream::readSocket);
+    connect(iSocket, &QLocalSocket::disconnected,
+            this, &SubtitleStream::endOfStream);
+
+    iSocket->connectToServer(name, QIODevice::ReadOnly);
+    if (!iSocket->waitForConnected(STREAM_CONNECT_TIMEOUT)) {
+        qWarning() << "cannot connect to" << name << iSocket->errorString();
+        close();
+        return false;
+    }
+
+    qDebug() << "reading subtitles from socket" << name;
+
+    return true;
+}
+
+bool SubtitleStream::openFd(int fd)
+{
+    if (fd < 0)
+        return false;
+
+    iFd = fd;
+    iNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(iNotifier, &QSocketNotifier::activated,
+            this, &SubtitleStream::readFd);
+
+    qDebug() << "reading subtitles from fd" << fd;
+
+    return true;
+}
+
+void SubtitleStream::close()
+{
+    if (iSocket) {
+        iSocket->disconnect(this);
+        iSocket->abort();
+        iSocket->deleteLater();
+        iSocket = nullptr;
+    }
+
+    if (iNotifier) {
+        iNotifier->setEnabled(false);
+        iNotifier->deleteLater();
+        iNotifier = nullptr;
+    }
+
+    // Descriptor belongs to the caller
+    iFd = -1;
+}
+
+// False when the stream could not be parsed and was closed
+bool SubtitleStream::feed(const QByteArray &bytes)
+{
+    SubtitleList cues;
+    bool ok = iParser->feed(bytes, cues, &iResult);
+
+    if (!cues.isEmpty())
+        emit cuesReceived(cues);
+
+    if (!ok) {
+        qWarning() << "cannot parse stream on line" << iResult.line;
+        close();
+        emit finished();
+        return false;
+    }
+
+    return true;
+}
+
+void SubtitleStream::readSocket()
+{
+    if (iSocket)
+        feed(iSocket->readAll());
+}
+
+void SubtitleStream::readFd()
+{
+    char buffer[STREAM_READ_SIZE];
+    ssize_t len;
+
+    // Notifier guarantees one read does not block
+    len = ::read(iFd, buffer, sizeof(buffer));
+
+    if (len > 0) {
+        feed(QByteArray(buffer, static_cast<int>(len)));
+        return;
+    }
+
+    if (len < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+
+    endOfStream();
+}
+
+void SubtitleStream::endOfStream()
+{
+    SubtitleList cues;
+
+    // Already finished if the rest cannot be parsed
+    if (iSocket && iSocket->bytesAvailable() && !feed(iSocket->readAll()))
+        return;
+
+    iParser->endFeed(cues, &iResult);
+
+    qDebug() << "stream ended," << iResult.cues << "subtitles parsed";
+
+    close();
+
+    if (!cues.isEmpty())
+        emit cuesReceived(cues);
+
+    emit finished();
+}
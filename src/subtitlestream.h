@@ -0,0 +1,66 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLESTREAM_H
+#define SUBTITLESTREAM_H
+
+#include <QObject>
+#include "types.h"
+#include "parser.h"
+
+class QLocalSocket;
+class QSocketNotifier;
+
+/*
+ * Feeds subtitles arriving from a local socket or a file descriptor, such as
+ * stdin or a pipe, to a parser in push mode. Only the partial line and cue
+ * are buffered, completed cues are passed on as they arrive.
+ */
+class SubtitleStream : public QObject
+{
+    Q_OBJECT
+public:
+    // Parser is not owned
+    SubtitleStream(Parser *parser, QObject *parent = nullptr);
+    ~SubtitleStream();
+
+    bool openLocalSocket(const QString &name);
+    bool openFd(int fd);
+    void close();
+
+signals:
+    void cuesReceived(const SubtitleList &cues);
+    void finished();
+
+private slots:
+    void readSocket();
+    void readFd();
+    void endOfStream();
+
+private:
+    bool feed(const QByteArray &bytes);
+
+    Parser *iParser;
+    QLocalSocket *iSocket;
+    QSocketNotifier *iNotifier;
+    int iFd;
+    SubParseResult iResult;
+};
+
+#endif // SUBTITLESTREAM_H
@@ -0,0 +1,362 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "subtitlewriter.h"
+#include "playbackcursor.h"
+
+#include <errno.h>
+#include <QtDebug>
+
+// Subtitles are collected to blocks of this size before writing
+#define WRITER_BLOCK_SIZE 65536
+#define WRITER_DEFAULT_FPS 25.0
+
+SubtitleWriter::SubtitleWriter()
+{
+    iFile = nullptr;
+    iFps = WRITER_DEFAULT_FPS;
+}
+
+SubtitleWriter::~SubtitleWriter()
+{
+    closeFile();
+}
+
+SubtitleWriter *SubtitleWriter::createWriter(const QString &format)
+{
+    if (format == QStringLiteral("srt"))
+        return new SrtWriter();
+
+    if (format == QStringLiteral("microdvd"))
+        return new MicroDVDWriter();
+
+    if (format == QStringLiteral("subviewer"))
+        return new SubViewerWriter();
+
+    return nullptr;
+}
+
+bool SubtitleWriter::isSupported(const QString &format)
+{
+    return format == QStringLiteral("srt") ||
+            format == QStringLiteral("microdvd") ||
+            format == QStringLiteral("subviewer");
+}
+
+int SubtitleWriter::openFile(const QString &filePath)
+{
+    closeFile();
+
+    iFile = new QFile(filePath);
+
+    // Own blocks are large enough, skip buffering in QFile
+    if (!iFile->open(QIODevice::WriteOnly | QIODevice::Truncate |
+                                            QIODevice::Unbuffered)) {
+        qDebug() << "cannot open" << filePath << "for writing";
+        delete iFile;
+        iFile = nullptr;
+        return -EACCES;
+    }
+
+    return 0;
+}
+
+int SubtitleWriter::writeSubtitles(const SubtitleList &subtitles, int offset,
+                                   double fps)
+{
+    QByteArray block;
+    int index = 0;
+
+    if (!iFile || !iFile->isOpen())
+        return -EBADF;
+
+    iFps = fps > 0.0 ? fps : WRITER_DEFAULT_FPS;
+
+    block.reserve(WRITER_BLOCK_SIZE + 1024);
+
+    // Text is UTF-8, without the BOM it would be read with the fallback codec
+    block.append("\xEF\xBB\xBF");
+    writeHeader(block);
+
+    for (const Subtitle &subtitle : subtitles) {
+        writeSubtitle(block, ++index,
+                      PlaybackCursor::applyOffset(subtitle.start_time, offset),
+                      PlaybackCursor::applyOffset(subtitle.end_time, offset),
+                      subtitle.text);
+
+        if (block.size() >= WRITER_BLOCK_SIZE && !flush(block))
+            return -EIO;
+    }
+
+    if (!flush(block))
+        return -EIO;
+
+    qDebug() << index << "subtitles written to" << iFile->fileName();
+
+    return 0;
+}
+
+void SubtitleWriter::closeFile()
+{
+    if (!iFile)
+        return;
+
+    if (iFile->isOpen())
+        iFile->close();
+
+    delete iFile;
+    iFile = nullptr;
+}
+
+bool SubtitleWriter::flush(QByteArray &block)
+{
+    qint64 written;
+
+    if (block.isEmpty())
+        return true;
+
+    written = iFile->write(block);
+    if (written != block.size()) {
+        qWarning() << "failed to write subtitles" << iFile->errorString();
+        return false;
+    }
+
+    // Reserved capacity is kept for the next block
+    block.resize(0);
+
+    return true;
+}
+
+void SubtitleWriter::writeHeader(QByteArray &block)
+{
+    Q_UNUSED(block);
+}
+
+void SubtitleWriter::appendNumber(QByteArray &block, unsigned int value,
+                                  int width)
+{
+    char buf[12];
+    int pos = sizeof(buf);
+
+    do {
+        buf[--pos] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (pos > 0 && (value || static_cast<int>(sizeof(buf)) - pos < width));
+
+    block.append(buf + pos, static_cast<int>(sizeof(buf)) - pos);
+}
+
+void SubtitleWriter::appendTimestamp(QByteArray &block, unsigned int ms,
+                                     char separator, bool hundredths)
+{
+    appendNumber(block, ms / 3600000, 2);
+    block.append(':');
+    appendNumber(block, (ms % 3600000) / 60000, 2);
+    block.append(':');
+    appendNumber(block, (ms % 60000) / 1000, 2);
+    block.append(separator);
+
+    if (hundredths)
+        appendNumber(block, (ms % 1000) / 10, 2);
+    else
+        appendNumber(block, ms % 1000, 3);
+}
+
+/*
+ * Text is kept with <br> as line separator and with <i>, <b> and <u> tags.
+ * Replace the separator with format specific one and drop the tags if the
+ * format does not support them. Runs between the tags are encoded straight
+ * to the block, leading and trailing space and separators are left out.
+ */
+void SubtitleWriter::appendText(QByteArray &block, const QString &text,
+                                const char *newline, bool stripTags)
+{
+    const QLatin1String br("<br>");
+    const QChar *data = text.constData();
+    int begin = 0;
+    int end = text.size();
+    int run;
+
+    while (begin < end) {
+        if (data[begin].isSpace())
+            begin++;
+        else if (text.midRef(begin, br.size()) == br)
+            begin += br.size();
+        else
+            break;
+    }
+
+    while (end > begin) {
+        if (data[end - 1].isSpace())
+            end--;
+        else if (end - begin >= br.size() &&
+                 text.midRef(end - br.size(), br.size()) == br)
+            end -= br.size();
+        else
+            break;
+    }
+
+    run = begin;
+
+    for (int i = begin; i < end; i++) {
+        int close;
+
+        if (data[i] != QLatin1Char('<'))
+            continue;
+
+        close = text.indexOf(QLatin1Char('>'), i);
+        if (close < 0 || close >= end)
+            break;
+
+        appendUtf8(block, data + run, i - run);
+
+        if (text.midRef(i + 1, close - i - 1) == QLatin1String("br"))
+            block.append(newline);
+        else if (!stripTags)
+            appendUtf8(block, data + i, close - i + 1);
+
+        i = close;
+        run = close + 1;
+    }
+
+    appendUtf8(block, data + run, end - run);
+}
+
+// Encode without the temporary QByteArray of QString::toUtf8()
+void SubtitleWriter::appendUtf8(QByteArray &block, const QChar *data, int len)
+{
+    for (int i = 0; i < len; i++) {
+        uint code = data[i].unicode();
+
+        if (code < 0x80) {
+            block.append(static_cast<char>(code));
+            continue;
+        }
+
+        if (code < 0x800) {
+            block.append(static_cast<char>(0xC0 | (code >> 6)));
+            block.append(static_cast<char>(0x80 | (code & 0x3F)));
+            continue;
+        }
+
+        if (data[i].isHighSurrogate() && i + 1 < len &&
+                data[i + 1].isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(data[i], data[i + 1]);
+            i++;
+            block.append(static_cast<char>(0xF0 | (code >> 18)));
+            block.append(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        } else {
+            // Unpaired surrogate is written as the replacement character
+            if (data[i].isSurrogate())
+                code = QChar::ReplacementCharacter;
+            block.append(static_cast<char>(0xE0 | (code >> 12)));
+        }
+
+        block.append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        block.append(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+unsigned int SubtitleWriter::msToFrame(unsigned int ms)
+{
+    return static_cast<unsigned int>(ms * iFps / 1000.0 + 0.5);
+}
+
+void SrtWriter::writeSubtitle(QByteArray &block, int index,
+                              unsigned int startTime, unsigned int endTime,
+                              const QString &text)
+{
+    appendNumber(block, static_cast<unsigned int>(index), 1);
+    block.append('\n');
+    appendTimestamp(block, startTime, ',', false);
+    block.append(" --> ");
+    appendTimestamp(block, endTime, ',', false);
+    block.append('\n');
+    appendText(block, text, "\n", false);
+    block.append("\n\n");
+}
+
+void MicroDVDWriter::writeHeader(QByteArray &block)
+{
+    block.append("{1}{1}");
+    block.append(QByteArray::number(iFps));
+    block.append('\n');
+}
+
+void MicroDVDWriter::writeSubtitle(QByteArray &block, int index,
+                                   unsigned int startTime,
+                                   unsigned int endTime, const QString &text)
+{
+    QByteArray codes;
+
+    Q_UNUSED(index);
+
+    if (text.contains(QStringLiteral("<i>")))
+        codes.append('i');
+    if (text.contains(QStringLiteral("<b>")))
+        codes.append('b');
+    if (text.contains(QStringLiteral("<u>")))
+        codes.append('u');
+
+    // Frame 1 is reserved for the FPS header
+    block.append('{');
+    appendNumber(block, qMax(msToFrame(startTime), 2u), 1);
+    block.append("}{");
+    appendNumber(block, qMax(msToFrame(endTime), 2u), 1);
+    block.append('}');
+
+    if (!codes.isEmpty()) {
+        block.append("{y:");
+        block.append(codes);
+        block.append('}');
+    }
+
+    appendText(block, text, "|", true);
+    block.append('\n');
+}
+
+void SubViewerWriter::writeHeader(QByteArray &block)
+{
+    block.append("[INFORMATION]\n"
+                 "[TITLE]\n"
+                 "[AUTHOR]\n"
+                 "[SOURCE]\n"
+                 "[PRG]SubSail\n"
+                 "[FILEPATH]\n"
+                 "[DELAY]0\n"
+                 "[CD TRACK]0\n"
+                 "[COMMENT]\n"
+                 "[END INFORMATION]\n"
+                 "[SUBTITLE]\n"
+                 "[COLF]&HFFFFFF,[STYLE]no,[SIZE]18,[FONT]Arial\n");
+}
+
+void SubViewerWriter::writeSubtitle(QByteArray &block, int index,
+                                    unsigned int startTime,
+                                    unsigned int endTime, const QString &text)
+{
+    Q_UNUSED(index);
+
+    appendTimestamp(block, startTime, '.', true);
+    block.append(',');
+    appendTimestamp(block, endTime, '.', true);
+    block.append('\n');
+    appendText(block, text, "[br]", true);
+    block.append("\n\n");
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTITLEWRITER_H
+#define SUBTITLEWRITER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include "types.h"
+
+class SubtitleWriter
+{
+public:
+    // Format names as given by Parser::getFormat()
+    static SubtitleWriter *createWriter(const QString &format);
+    static bool isSupported(const QString &format);
+
+    int openFile(const QString &filePath);
+    int writeSubtitles(const SubtitleList &subtitles, int offset, double fps);
+    void closeFile();
+
+    SubtitleWriter();
+    virtual ~SubtitleWriter();
+
+protected:
+    virtual void writeHeader(QByteArray &block);
+    virtual void writeSubtitle(QByteArray &block, int index,
+                               unsigned int startTime, unsigned int endTime,
+                               const QString &text) = 0;
+
+    void appendNumber(QByteArray &block, unsigned int value, int width);
+    void appendTimestamp(QByteArray &block, unsigned int ms,
+                         char separator, bool hundredths);
+    void appendText(QByteArray &block, const QString &text,
+                    const char *newline, bool stripTags);
+    void appendUtf8(QByteArray &block, const QChar *data, int len);
+    unsigned int msToFrame(unsigned int ms);
+
+    double iFps;
+
+private:
+    bool flush(QByteArray &block);
+
+    QFile *iFile;
+};
+
+class SrtWriter : public SubtitleWriter
+{
+protected:
+    void writeSubtitle(QByteArray &block, int index, unsigned int startTime,
+                       unsigned int endTime, const QString &text);
+};
+
+class MicroDVDWriter : public SubtitleWriter
+{
+protected:
+    void writeHeader(QByteArray &block);
+    void writeSubtitle(QByteArray &block, int index, unsigned int startTime,
+                       unsigned int endTime, const QString &text);
+};
+
+class SubViewerWriter : public SubtitleWriter
+{
+protected:
+    void writeHeader(QByteArray &block);
+    void writeSubtitle(QByteArray &block, int index, unsigned int startTime,
+                       unsigned int endTime, const QString &text);
+};
+
+#endif // SUBTITLEWRITER_H
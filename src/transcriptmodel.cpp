@@ -0,0 +1,137 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "transcriptmodel.h"
+#include "subtitleengine.h"
+
+TranscriptModel::TranscriptModel(SubtitleEngine *engine, QObject *parent) :
+    QAbstractListModel(parent),
+    iEngine(engine),
+    iCurrentIndex(-1)
+{
+    iTable = iEngine->getTable();
+    iCurrentIndex = iEngine->getDisplayedIndex();
+
+    connect(iEngine, &SubtitleEngine::tableChanged,
+            this, &TranscriptModel::resetTable);
+    connect(iEngine, &SubtitleEngine::displayedIndexChanged,
+            this, &TranscriptModel::updateCurrent);
+    connect(iEngine, &SubtitleEngine::offsetChanged,
+            this, &TranscriptModel::updateTimes);
+}
+
+int TranscriptModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !iTable)
+        return 0;
+
+    return iTable->size();
+}
+
+QVariant TranscriptModel::data(const QModelIndex &index, int role) const
+{
+    int row = index.row();
+
+    if (!iTable || row < 0 || row >= iTable->size())
+        return QVariant();
+
+    switch (role) {
+    case TextRole:
+        return iTable->at(row).text;
+    case StartTimeRole:
+        return iEngine->playbackTime(iTable->at(row).start_time);
+    case EndTimeRole:
+        return iEngine->playbackTime(iTable->at(row).end_time);
+    case CurrentRole:
+        return row == iCurrentIndex;
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> TranscriptModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+
+    roles[TextRole] = "text";
+    roles[StartTimeRole] = "startTime";
+    roles[EndTimeRole] = "endTime";
+    roles[CurrentRole] = "current";
+
+    return roles;
+}
+
+int TranscriptModel::currentIndex() const
+{
+    return iCurrentIndex;
+}
+
+void TranscriptModel::resetTable()
+{
+    CueTableRef table = iEngine->getTable();
+
+    // Edited cues keep the rows and the view keeps its place
+    if (iTable && table->size() == iTable->size()) {
+        iTable = table;
+        iCurrentIndex = -1;
+
+        if (rowCount() > 0)
+            emit dataChanged(index(0), index(rowCount() - 1));
+
+        emit currentIndexChanged();
+        return;
+    }
+
+    beginResetModel();
+    iTable = table;
+    iCurrentIndex = -1;
+    endResetModel();
+
+    emit currentIndexChanged();
+}
+
+void TranscriptModel::updateCurrent(int position)
+{
+    int previous = iCurrentIndex;
+    int first;
+    int last;
+
+    if (position == previous)
+        return;
+
+    iCurrentIndex = position;
+
+    // One change covering both the old and the new highlighted row
+    first = previous < 0 ? position : (position < 0 ? previous : qMin(previous, position));
+    last = qMax(previous, position);
+
+    if (first >= 0 && last < rowCount())
+        emit dataChanged(index(first), index(last), QVector<int>() << CurrentRole);
+
+    emit currentIndexChanged();
+}
+
+void TranscriptModel::updateTimes()
+{
+    if (rowCount() > 0)
+        emit dataChanged(index(0), index(rowCount() - 1),
+                         QVector<int>() << StartTimeRole << EndTimeRole);
+}
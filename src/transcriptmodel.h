@@ -0,0 +1,67 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSCRIPTMODEL_H
+#define TRANSCRIPTMODEL_H
+
+#include <QAbstractListModel>
+#include "cuetable.h"
+
+class SubtitleEngine;
+
+/*
+ * List model over the cue table of the engine. Rows are not copied, data is
+ * read from the table when a delegate asks for it. Times are playback times,
+ * with the offset as on the time slider.
+ */
+class TranscriptModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int currentIndex READ currentIndex NOTIFY currentIndexChanged)
+public:
+    enum TranscriptRoles {
+        TextRole = Qt::UserRole + 1,
+        StartTimeRole,
+        EndTimeRole,
+        CurrentRole
+    };
+
+    explicit TranscriptModel(SubtitleEngine *engine, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    int currentIndex() const;
+
+signals:
+    void currentIndexChanged();
+
+private slots:
+    void resetTable();
+    void updateCurrent(int position);
+    void updateTimes();
+
+private:
+    SubtitleEngine *iEngine;
+    CueTableRef iTable;
+    int iCurrentIndex;
+};
+
+#endif // TRANSCRIPTMODEL_H
@@ -21,6 +21,7 @@
 #define TYPES_H
 
 #include <QString>
+#include <QVector>
 
 // TODO: make c++ class
 typedef struct _Subtitle {
@@ -29,9 +30,28 @@ typedef struct _Subtitle {
     unsigned int end_time;   // In milliseconds
     unsigned int start_frame;
     unsigned int end_frame;
+    unsigned int flags;      // SubFlag values set when normalized
     QString text;
 } Subtitle;
 
+typedef QVector<Subtitle> SubtitleList;
+
+typedef struct _SubTrack {
+    int number;
+    QString codec;
+    QString language;
+    QString name;
+    bool isDefault;
+} SubTrack;
+
+typedef QVector<SubTrack> SubTrackList;
+
+enum SubFlag {
+    SUB_FLAG_NONE = 0,
+    SUB_FLAG_ZERO_LENGTH = 1 << 0,
+    SUB_FLAG_OVERLAP = 1 << 1
+};
+
 enum SubState {
     SUB_STATE_INIT = 0,
     SUB_STATE_INIT_DELAY,
@@ -49,4 +69,21 @@ enum SubParseError {
     SUB_PARSE_ERROR_NO_FILE
 };
 
+typedef struct _SubParseDiagnostic {
+    qint64 offset;            // Byte offset of the line in the file
+    int line;                 // Line number, first line is 1
+    enum SubParseError error;
+} SubParseDiagnostic;
+
+typedef QVector<SubParseDiagnostic> SubParseDiagnostics;
+
+typedef struct _SubParseResult {
+    enum SubParseError error; // Error that stopped parsing, NONE when ok
+    int cues;                 // Subtitles appended to the list
+    int skipped;              // Empty and ignored lines
+    int line;                 // Line number where error was detected
+    int errors;               // Errors recovered from or stopped at
+    SubParseDiagnostics diagnostics; // First errors, for reporting
+} SubParseResult;
+
 #endif // TYPES_H
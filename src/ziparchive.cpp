@@ -0,0 +1,186 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ziparchive.h"
+#include "parserenginefactory.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+#include <QtDebug>
+
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_COMMENT_MAX 65535
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_LOCAL_SIZE 30
+
+#define ZIP_FLAG_ENCRYPTED 0x0001
+#define ZIP_FLAG_UTF8 0x0800
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+static quint16 readU16(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+}
+
+static quint32 readU32(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+bool ZipArchive::readEntries(QIODevice *file, QVector<ZipEntry> &entries)
+{
+    QByteArray tail;
+    QByteArray directory;
+    qint64 tailStart;
+    quint32 directorySize;
+    quint32 directoryOffset;
+    int pos;
+
+    if (!file || file->size() < ZIP_EOCD_SIZE)
+        return false;
+
+    // End of central directory record is followed only by a comment
+    tailStart = qMax<qint64>(0, file->size() - ZIP_EOCD_SIZE - ZIP_COMMENT_MAX);
+    if (!file->seek(tailStart))
+        return false;
+
+    tail = file->readAll();
+    for (pos = tail.size() - ZIP_EOCD_SIZE; pos >= 0; pos--) {
+        if (readU32(tail.constData() + pos) == ZIP_EOCD_SIGNATURE)
+            break;
+    }
+
+    if (pos < 0) {
+        qDebug() << "zip end of central directory not found";
+        return false;
+    }
+
+    directorySize = readU32(tail.constData() + pos + 12);
+    directoryOffset = readU32(tail.constData() + pos + 16);
+
+    if (!file->seek(directoryOffset))
+        return false;
+
+    directory = file->read(directorySize);
+    if (directory.size() != static_cast<int>(directorySize))
+        return false;
+
+    pos = 0;
+    while (pos + ZIP_CENTRAL_SIZE <= directory.size()) {
+        const char *header = directory.constData() + pos;
+        quint16 flags = readU16(header + 8);
+        quint16 nameLength = readU16(header + 28);
+        quint16 extraLength = readU16(header + 30);
+        quint16 commentLength = readU16(header + 32);
+        QByteArray name;
+        ZipEntry entry;
+
+        if (readU32(header) != ZIP_CENTRAL_SIGNATURE)
+            break;
+
+        if (pos + ZIP_CENTRAL_SIZE + nameLength > directory.size())
+            break;
+
+        name = directory.mid(pos + ZIP_CENTRAL_SIZE, nameLength);
+
+        entry.name = flags & ZIP_FLAG_UTF8 ? QString::fromUtf8(name) :
+                                             QString::fromLocal8Bit(name);
+        entry.method = readU16(header + 10);
+        entry.compressedSize = readU32(header + 20);
+        entry.size = readU32(header + 24);
+        entry.localOffset = readU32(header + 42);
+
+        pos += ZIP_CENTRAL_SIZE + nameLength + extraLength + commentLength;
+
+        if (flags & ZIP_FLAG_ENCRYPTED ||
+                entry.compressedSize == 0xFFFFFFFF ||
+                entry.localOffset == 0xFFFFFFFF) {
+            qDebug() << "skipping unsupported zip entry" << entry.name;
+            continue;
+        }
+
+        if (entry.method != ZIP_METHOD_STORED &&
+                entry.method != ZIP_METHOD_DEFLATED) {
+            qDebug() << "skipping zip entry" << entry.name << "method" <<
+                        entry.method;
+            continue;
+        }
+
+        entries.append(entry);
+    }
+
+    return true;
+}
+
+bool ZipArchive::findSubtitle(QIODevice *file, ZipEntry &entry)
+{
+    QVector<ZipEntry> entries;
+
+    if (!readEntries(file, entries))
+        return false;
+
+    for (const ZipEntry &candidate : entries) {
+        if (candidate.name.endsWith(QLatin1Char('/')))
+            continue;
+
+        if (ParserEngineFactory::instance().isSupported(
+                    QFileInfo(candidate.name).suffix())) {
+            entry = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+InflateDevice *ZipArchive::openEntry(QIODevice *file, const ZipEntry &entry)
+{
+    QByteArray header;
+    InflateDevice *device;
+
+    if (!file->seek(entry.localOffset))
+        return nullptr;
+
+    header = file->read(ZIP_LOCAL_SIZE);
+    if (header.size() != ZIP_LOCAL_SIZE ||
+            readU32(header.constData()) != ZIP_LOCAL_SIGNATURE)
+        return nullptr;
+
+    // Local extra field can differ from the one in the central directory
+    if (!file->seek(entry.localOffset + ZIP_LOCAL_SIZE +
+                    readU16(header.constData() + 26) +
+                    readU16(header.constData() + 28)))
+        return nullptr;
+
+    device = new InflateDevice(file, entry.method == ZIP_METHOD_STORED ?
+                                   InflateDevice::FORMAT_STORED :
+                                   InflateDevice::FORMAT_RAW_DEFLATE,
+                               entry.compressedSize);
+
+    if (!device->open(QIODevice::ReadOnly)) {
+        delete device;
+        return nullptr;
+    }
+
+    return device;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <QString>
+#include <QVector>
+#include "inflatedevice.h"
+
+typedef struct _ZipEntry {
+    QString name;
+    quint16 method;
+    quint32 compressedSize;
+    quint32 size;
+    quint32 localOffset;
+} ZipEntry;
+
+/*
+ * Minimal reader of the central directory of zip archives. Only stored and
+ * deflated entries without encryption or zip64 extensions are listed.
+ */
+class ZipArchive
+{
+public:
+    static bool readEntries(QIODevice *file, QVector<ZipEntry> &entries);
+    // First entry with an ending a parser engine is registered for
+    static bool findSubtitle(QIODevice *file, ZipEntry &entry);
+    // Device decompressing the entry, source must stay open while reading
+    static InflateDevice *openEntry(QIODevice *file, const ZipEntry &entry);
+};
+
+#endif // ZIPARCHIVE_H
@@ -0,0 +1,22 @@
+# Player selection of the MPRIS clock against mock players on a private
+# session bus, built and run with:
+#   qmake tests/mprisclock/mprisclock.pro && dbus-run-session make check
+
+TARGET = tst_mprisclock
+
+TEMPLATE = app
+
+CONFIG += console c++11 testcase
+CONFIG -= app_bundle
+
+QT = core dbus testlib
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    tst_mprisclock.cpp \
+    ../../src/mprisclock.cpp
+
+HEADERS += \
+    ../../src/mprisclock.h \
+    ../../src/subtitleclock.h
@@ -0,0 +1,192 @@
+/*
+ * This file is part of SubSail application.
+ *
+ * Copyright (C) 2025 Jussi Laakkonen <jussi.laakkonen@jolla.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QThread>
+#include <QVariantMap>
+#include <QtTest>
+
+#include "mprisclock.h"
+
+#define MPRIS_SERVICE_PREFIX "org.mpris.MediaPlayer2."
+#define MPRIS_PATH "/org/mpris/MediaPlayer2"
+
+// Mock players are named after the test so no real player interferes
+#define MOCK_PLAYER_PREFIX "subsailtest"
+
+/*
+ * Player object exporting the MPRIS properties the clock reads. Every mock
+ * has its own bus connection since all players use the same object path.
+ */
+class MockPlayer : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.mpris.MediaPlayer2.Player")
+    Q_PROPERTY(QString PlaybackStatus READ playbackStatus)
+    Q_PROPERTY(QVariantMap Metadata READ metadata)
+    Q_PROPERTY(qlonglong Position READ position)
+    Q_PROPERTY(double Rate READ rate)
+public:
+    MockPlayer(const QString &status, const QString &url, qint64 length) :
+        iStatus(status)
+    {
+        iMetadata.insert(QStringLiteral("xesam:url"), url);
+        iMetadata.insert(QStringLiteral("mpris:length"), length * 1000);
+    }
+
+    QString playbackStatus() const { return iStatus; }
+    QVariantMap metadata() const { return iMetadata; }
+    qlonglong position() const { return 0; }
+    double rate() const { return 1.0; }
+
+private:
+    QString iStatus;
+    QVariantMap iMetadata;
+};
+
+class TestMprisClock : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+    void noPlayer();
+    void prefersPlaying();
+    void prefersVideo();
+    void fallsBackToAny();
+
+private:
+    void addPlayer(const QString &name, const QString &status,
+                   const QString &url, qint64 length);
+
+    // Blocking calls of the clock are answered while the test waits
+    QThread iThread;
+    QStringList iPlayers;
+};
+
+void TestMprisClock::initTestCase()
+{
+    QDBusConnectionInterface *bus = QDBusConnection::sessionBus().interface();
+
+    if (!bus)
+        QSKIP("no session bus, run the test under dbus-run-session");
+
+    for (const QString &service : bus->registeredServiceNames().value()) {
+        if (service.startsWith(QStringLiteral(MPRIS_SERVICE_PREFIX)))
+            QSKIP("a MPRIS player is already running on the session bus");
+    }
+
+    iThread.start();
+}
+
+void TestMprisClock::cleanupTestCase()
+{
+    iThread.quit();
+    iThread.wait();
+}
+
+void TestMprisClock::cleanup()
+{
+    for (const QString &name : iPlayers) {
+        QDBusConnection bus(name);
+        QObject *player = bus.objectRegisteredAt(QStringLiteral(MPRIS_PATH));
+
+        bus.unregisterObject(QStringLiteral(MPRIS_PATH));
+        QDBusConnection::disconnectFromBus(name);
+        if (player)
+            player->deleteLater();
+    }
+
+    iPlayers.clear();
+}
+
+void TestMprisClock::addPlayer(const QString &name, const QString &status,
+                               const QString &url, qint64 length)
+{
+    QString connection = QStringLiteral(MOCK_PLAYER_PREFIX) + name;
+    QDBusConnection bus = QDBusConnection::connectToBus(QDBusConnection::SessionBus,
+                                                        connection);
+    MockPlayer *player = new MockPlayer(status, url, length);
+
+    QVERIFY(bus.isConnected());
+
+    player->moveToThread(&iThread);
+    QVERIFY(bus.registerObject(QStringLiteral(MPRIS_PATH), player,
+                               QDBusConnection::ExportAllProperties));
+    QVERIFY(bus.registerService(QStringLiteral(MPRIS_SERVICE_PREFIX) + connection));
+
+    iPlayers.append(connection);
+}
+
+void TestMprisClock::noPlayer()
+{
+    MprisClock clock;
+
+    QVERIFY(!clock.attach());
+    QVERIFY(!clock.isAttached());
+}
+
+void TestMprisClock::prefersPlaying()
+{
+    MprisClock clock;
+
+    addPlayer(QStringLiteral("stopped"), QStringLiteral("Stopped"),
+              QStringLiteral("file:///home/user/Videos/movie.mkv"), 5000);
+    addPlayer(QStringLiteral("music"), QStringLiteral("Playing"),
+              QStringLiteral("file:///home/user/Music/song.mp3"), 3000);
+
+    QVERIFY(clock.attach());
+    QTRY_VERIFY(clock.isPlaying());
+    QCOMPARE(clock.length(), qint64(3000));
+}
+
+void TestMprisClock::prefersVideo()
+{
+    MprisClock clock;
+
+    addPlayer(QStringLiteral("music"), QStringLiteral("Paused"),
+              QStringLiteral("file:///home/user/Music/song.mp3"), 3000);
+    addPlayer(QStringLiteral("video"), QStringLiteral("Paused"),
+              QStringLiteral("file:///home/user/Videos/movie.mkv"), 5000);
+
+    QVERIFY(clock.attach());
+    QTRY_COMPARE(clock.length(), qint64(5000));
+    QVERIFY(!clock.isPlaying());
+}
+
+void TestMprisClock::fallsBackToAny()
+{
+    MprisClock clock;
+
+    addPlayer(QStringLiteral("radio"), QStringLiteral("Stopped"), QString(), 0);
+
+    QVERIFY(clock.attach());
+    QVERIFY(clock.isAttached());
+    QVERIFY(!clock.isPlaying());
+
+    // The clock follows the player until it leaves the bus
+    cleanup();
+    QTRY_VERIFY(!clock.isAttached());
+}
+
+QTEST_GUILESS_MAIN(TestMprisClock)
+
+#include "tst_mprisclock.moc"